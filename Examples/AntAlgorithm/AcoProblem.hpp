@@ -0,0 +1,45 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <random>
+#include <vector>
+#include "CandidateList.hpp"
+
+namespace swarm {
+    /**
+     * @brief What AntColony needs from a problem. A solution is built as a
+     * sequence of decisions: in every step the ant is in a context (a pheromone
+     * row, e.g. the current city) and picks a feasible component (a column, e.g.
+     * the next city). Candidates are tried first, all columns only when no
+     * candidate is feasible.
+     *
+     * - State: per-ant construction state with a `std::vector<int> solution`
+     *   member, created once per ant with make_state()
+     * - rows(), cols(): size of the pheromone model
+     * - heuristic(i, j): static desirability eta of column j in context i, >= 0
+     * - candidates(): preferred columns per row
+     * - start, complete, context, feasible, apply: the construction steps
+     * - improve(state): optional local search, returns true if the solution changed
+     * - cost(solution): objective to minimize, infinity for infeasible solutions
+     * - for_each_component(solution, f): calls f(i, j) for every pheromone entry the
+     *   solution reinforces
+     */
+    template<class P>
+    concept AcoProblem = requires(const P &problem, typename P::State &state, const typename P::State &const_state,
+                                  const std::vector<int> &solution, std::size_t j, std::mt19937 &rng) {
+        { problem.rows() } -> std::convertible_to<std::size_t>;
+        { problem.cols() } -> std::convertible_to<std::size_t>;
+        { problem.heuristic(j, j) } -> std::convertible_to<double>;
+        { problem.candidates() } -> std::same_as<const CandidateList &>;
+        { problem.make_state() } -> std::same_as<typename P::State>;
+        problem.start(state, rng);
+        { problem.complete(const_state) } -> std::convertible_to<bool>;
+        { problem.context(const_state) } -> std::convertible_to<std::size_t>;
+        { problem.feasible(const_state, j) } -> std::convertible_to<bool>;
+        problem.apply(state, j);
+        { problem.improve(state) } -> std::convertible_to<bool>;
+        { problem.cost(solution) } -> std::convertible_to<double>;
+        { const_state.solution } -> std::convertible_to<const std::vector<int> &>;
+        problem.for_each_component(solution, [](std::size_t, std::size_t) {});
+    };
+} // namespace swarm
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cppSwarmLib/Parallel.hpp>
+#include <cppSwarmLib/Swarm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include "AcoProblem.hpp"
+#include "AntColonyParams.hpp"
+#include "AntUnit.hpp"
+#include "PheromoneModel.hpp"
+
+namespace swarm {
+    /**
+     * @brief Ant colony optimization over any AcoProblem. The ants are swarm units
+     * built in parallel by SwarmParallelVectorContainer; the problem and the
+     * pheromone model are owned by the colony and shared by all ants.
+     *
+     * One iter() is one ACO iteration: every ant builds (and optionally improves)
+     * a solution, then the colony updates the best-so-far solution and the trails
+     * according to AntColonyParams::variant. Evaporation is lazy, so the update
+     * touches only candidate-list entries and deposits, split by row blocks over
+     * the same thread pool.
+     */
+    template<AcoProblem ProblemT>
+    class AntColony : public Swarm<SwarmParallelVectorContainer, AntColonyParams, IAntUnit<ProblemT>> {
+        using _Base = Swarm<SwarmParallelVectorContainer, AntColonyParams, IAntUnit<ProblemT>>;
+
+        // Deposits produced by one worker, binned by the worker that owns the row
+        struct DepositBuffer {
+            struct Deposit {
+                std::uint32_t i, j;
+                double amount;
+            };
+            std::vector<std::vector<Deposit>> blocks;
+        };
+
+        ProblemT _Problem;
+        PheromoneModel _Model;
+        std::vector<IAntUnit<ProblemT> *> _Ants;
+        std::vector<DepositBuffer> _Deposits; // one per worker
+
+        std::vector<int> _BestSolution;
+        double _BestCost = std::numeric_limits<double>::infinity();
+        int _IterationBest = -1;
+        int _Iteration = 0;
+        int _SinceImprovement = 0;
+        double _TauMin = 0.0;
+        double _TauMax = std::numeric_limits<double>::max();
+
+    public:
+        /**
+         * @param problem - moved into the colony
+         * @param p - parameters of the colony
+         * @param sz - number of ants
+         */
+        AntColony(ProblemT problem, const AntColonyParams &p = AntColonyParams(), std::size_t sz = 0) :
+            _Base(p, sz), _Problem(std::move(problem)),
+            // ACS has no global evaporation, its global update evaporates the best-so-far entries explicitly
+            _Model(_Problem, p.alpha, p.beta, p.variant == AcoVariant::AntColonySystem ? 0.0 : p.rho) {
+            _Base::_Units.set_threads(p.threads);
+        }
+
+        void init() final {
+            _Base::init();
+            _Ants.clear();
+            _Base::_Units.for_each([this](IAntUnit<ProblemT> &ant) { _Ants.push_back(&ant); });
+            const std::size_t workers = _Base::_Units.pool().size();
+            _Deposits.assign(workers, DepositBuffer{});
+            for (auto &buffer : _Deposits)
+                buffer.blocks.resize(workers);
+            _BestSolution.clear();
+            _BestCost = std::numeric_limits<double>::infinity();
+            _Iteration = 0;
+            _SinceImprovement = 0;
+            initialize_trails();
+        }
+
+        template<typename T = AntUnit<ProblemT>>
+        void init(bool create_reserve_units = true) {
+            if (create_reserve_units) {
+                auto count = _Base::_Units.reserved_size() - _Base::_Units.size();
+                for (std::size_t i = 0; i < count; ++i) {
+                    _Base::_Units.add_unit(SwarmUnitLink<IAntUnit<ProblemT>>(
+                            new T(_Base::_Params, _Problem, _Model, _Base::_Units.size())));
+                }
+            }
+            init();
+        }
+
+        void iter() final {
+            _Base::iter();
+            update_best();
+            update_trails();
+            // MMAS restart: the search stagnated, forget the trails but keep the best-so-far solution
+            if (_Base::_Params.variant == AcoVariant::MaxMinAntSystem && _Base::_Params.mmas_restart_after > 0 &&
+                _SinceImprovement >= _Base::_Params.mmas_restart_after) {
+                _Model.reset(_TauMax);
+                _SinceImprovement = 0;
+            }
+            ++_Iteration;
+        }
+
+        /**
+         * @brief best solution found so far, empty before the first iteration
+         */
+        const std::vector<int> &best_solution() const { return _BestSolution; }
+        /**
+         * @brief its cost, infinity if no ant built a feasible solution yet
+         */
+        double best_cost() const { return _BestCost; }
+        int iteration() const { return _Iteration; }
+        const ProblemT &problem() const { return _Problem; }
+        const PheromoneModel &pheromones() const { return _Model; }
+
+    private:
+        const AntColonyParams &params() const { return _Base::_Params; }
+
+        /**
+         * @brief Cost of the solution an ant builds from the heuristic alone, used to
+         * scale the initial trails
+         */
+        double greedy_cost() {
+            _Model.reset(1.0);
+            auto state = _Problem.make_state();
+            std::vector<double> weights(_Problem.candidates().size());
+            std::mt19937 rng(static_cast<std::mt19937::result_type>(params().seed));
+            AntConstructionRule rule;
+            rule.q0 = 1.0;
+            const double cost = construct_solution(_Problem, _Model, state, weights, rng, rule);
+            // Without a feasible greedy solution fall back to a unit cost per decision
+            return std::isinf(cost) || cost <= 0.0 ? static_cast<double>(_Problem.rows()) : cost;
+        }
+
+        void initialize_trails() {
+            const double reference = greedy_cost();
+            switch (params().variant) {
+            case AcoVariant::AntSystem:
+                _Model.reset(params().initial_pheromone > 0.0
+                                     ? params().initial_pheromone
+                                     : static_cast<double>(std::max<std::size_t>(1, _Ants.size())) / reference);
+                break;
+            case AcoVariant::MaxMinAntSystem:
+                // Start at the upper trail limit estimated from the greedy solution
+                update_trail_limits(reference);
+                _Model.reset(_TauMax);
+                break;
+            case AcoVariant::AntColonySystem:
+                _Model.reset(1.0 / (static_cast<double>(_Problem.rows()) * reference));
+                break;
+            }
+        }
+
+        /**
+         * @brief Iteration-best and best-so-far. Ants are scanned in index order so ties are
+         * resolved the same way regardless of the number of threads.
+         */
+        void update_best() {
+            _IterationBest = -1;
+            bool improved = false;
+            for (std::size_t i = 0; i < _Ants.size(); ++i) {
+                const double cost = _Ants[i]->getCost();
+                if (std::isinf(cost))
+                    continue;
+                if (_IterationBest < 0 || cost < _Ants[static_cast<std::size_t>(_IterationBest)]->getCost())
+                    _IterationBest = static_cast<int>(i);
+                if (cost < _BestCost) {
+                    _BestCost = cost;
+                    _BestSolution = _Ants[i]->getSolution();
+                    improved = true;
+                }
+            }
+            _SinceImprovement = improved ? 0 : _SinceImprovement + 1;
+            if (improved && params().variant == AcoVariant::MaxMinAntSystem)
+                update_trail_limits(_BestCost);
+        }
+
+        void update_trails() {
+            for (auto &buffer : _Deposits) {
+                for (auto &block : buffer.blocks)
+                    block.clear();
+            }
+            ThreadPool &pool = _Base::_Units.pool();
+
+            switch (params().variant) {
+            case AcoVariant::AntSystem:
+                // Every ant deposits 1 / cost, every worker bins the deposits of its block of ants
+                pool.parallel_for(_Ants.size(), [this](std::size_t begin, std::size_t end, std::size_t worker) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        const double cost = _Ants[i]->getCost();
+                        if (!std::isinf(cost))
+                            bin(_Deposits[worker], _Ants[i]->getSolution(), 1.0 / cost);
+                    }
+                });
+                // Elitist deposit on the best-so-far solution
+                if (!std::isinf(_BestCost))
+                    bin(_Deposits.back(), _BestSolution, 1.0 / _BestCost);
+                apply_deposits();
+                break;
+
+            case AcoVariant::MaxMinAntSystem: {
+                // Only one ant deposits: mostly the iteration-best, periodically the best-so-far
+                const bool use_best_so_far =
+                        _IterationBest < 0 || (params().mmas_best_so_far_every > 0 &&
+                                               (_Iteration + 1) % params().mmas_best_so_far_every == 0);
+                if (use_best_so_far && !std::isinf(_BestCost)) {
+                    bin(_Deposits.back(), _BestSolution, 1.0 / _BestCost);
+                } else if (_IterationBest >= 0) {
+                    const IAntUnit<ProblemT> &ant = *_Ants[static_cast<std::size_t>(_IterationBest)];
+                    bin(_Deposits.back(), ant.getSolution(), 1.0 / ant.getCost());
+                }
+                apply_deposits();
+                break;
+            }
+
+            case AcoVariant::AntColonySystem:
+                // Global update only on the best-so-far solution, evaporation included
+                if (!std::isinf(_BestCost)) {
+                    const double rho = params().rho;
+                    const double deposit = rho / _BestCost;
+                    _Problem.for_each_component(_BestSolution, [&](std::size_t i, std::size_t j) {
+                        _Model.set(i, j, (1.0 - rho) * _Model.trails()(i, j) + deposit);
+                    });
+                }
+                break;
+            }
+        }
+
+        /**
+         * @brief Max-Min Ant System trail limits from the best cost (Stützle & Hoos): tau_min
+         * such that the best solution is built with probability p_best on converged trails
+         */
+        void update_trail_limits(double best_cost) {
+            const double n = static_cast<double>(_Problem.rows());
+            _TauMax = 1.0 / (params().rho * best_cost);
+            const double p_dec = std::pow(params().mmas_p_best, 1.0 / n);
+            const double avg_choices = std::max(1.0, static_cast<double>(_Problem.cols()) / 2.0 - 1.0);
+            _TauMin = std::min(_TauMax, _TauMax * (1.0 - p_dec) / (avg_choices * p_dec));
+            _Model.trails().set_limits(_TauMin, _TauMax);
+        }
+
+        void bin(DepositBuffer &buffer, const std::vector<int> &solution, double amount) const {
+            const std::size_t workers = buffer.blocks.size();
+            const std::size_t rows = _Problem.rows();
+            _Problem.for_each_component(solution, [&](std::size_t i, std::size_t j) {
+                buffer.blocks[ThreadPool::block_of(rows, workers, i)].push_back(
+                        {static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(j), amount});
+            });
+        }
+
+        /**
+         * @brief Evaporate (lazily), then every worker refreshes the candidate entries of
+         * its rows and adds the deposits binned for them by all workers, in worker order.
+         * No two workers touch the same row.
+         */
+        void apply_deposits() {
+            _Model.trails().next_iteration();
+            ThreadPool &pool = _Base::_Units.pool();
+            const std::size_t workers = pool.size();
+            pool.run([&](std::size_t worker) {
+                const auto [row_begin, row_end] = ThreadPool::block(_Problem.rows(), workers, worker);
+                _Model.refresh(_Problem.candidates(), row_begin, row_end);
+                for (const auto &buffer : _Deposits) {
+                    for (const auto &deposit : buffer.blocks[worker])
+                        _Model.deposit(deposit.i, deposit.j, deposit.amount);
+                }
+            });
+        }
+    };
+} // namespace swarm
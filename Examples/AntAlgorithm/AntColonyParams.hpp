@@ -0,0 +1,46 @@
+#pragma once
+#include <cppSwarmLib/Params.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+namespace swarm {
+    /**
+     * @brief Pheromone update rule of AntColony
+     */
+    enum class AcoVariant {
+        AntSystem,       // Every ant deposits, plus an elitist deposit on the best-so-far solution
+        MaxMinAntSystem, // One ant deposits (iteration-best or best-so-far), trails bounded to [tau_min, tau_max], restarts
+        AntColonySystem  // Pseudo-random proportional rule, local update while building, global update on best-so-far
+    };
+
+    /**
+     * @brief The params of the ant colony
+     */
+    struct AntColonyParams : public IParams {
+        double alpha = 1.0; // Pheromone influence
+        double beta = 2.0;  // Heuristic influence
+        double rho = 0.1;   // Evaporation rate
+        AcoVariant variant = AcoVariant::AntSystem;
+        bool local_search = false; // Improve every solution with the problem's local search
+        // Initial trail of Ant System, 0 - ants / cost of a greedy solution
+        double initial_pheromone = 0.0;
+
+        // MMAS: probability of constructing the best solution once the trails have converged, sets tau_min / tau_max
+        double mmas_p_best = 0.05;
+        // MMAS: the best-so-far solution deposits instead of the iteration-best one every this many iterations
+        int mmas_best_so_far_every = 5;
+        // MMAS: trails are reset to tau_max after this many iterations without improvement, 0 - never
+        int mmas_restart_after = 100;
+
+        // ACS: probability of taking the best candidate instead of sampling
+        double acs_q0 = 0.9;
+        // ACS: local pheromone update rate
+        double acs_xi = 0.1;
+
+        std::size_t threads = 0; // Number of worker threads, 0 - one per hardware thread
+        // Runs with the same seed are identical for any thread count, except ACS whose local updates depend on
+        // the order the ants run in
+        std::uint64_t seed = std::random_device{}();
+    };
+} // namespace swarm
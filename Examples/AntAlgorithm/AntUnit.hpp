@@ -0,0 +1,191 @@
+#pragma once
+#include <cmath>
+#include <cppSwarmLib/Params.hpp>
+#include <cppSwarmLib/SwarmUnit.hpp>
+#include <cppSwarmLib/UnitComponent/IExecutorC.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+#include "AcoProblem.hpp"
+#include "AntColonyParams.hpp"
+#include "PheromoneModel.hpp"
+
+namespace swarm {
+    template<AcoProblem ProblemT>
+    class AntUnit;
+
+    /**
+     * @brief How an ant picks the next component
+     */
+    struct AntConstructionRule {
+        double q0 = 0.0;           // probability of taking the best candidate instead of sampling
+        bool local_update = false; // Ant Colony System local update on every step
+        double xi = 0.1;           // local update rate
+    };
+
+    /**
+     * @brief Build one solution into state.solution. Candidates of the current
+     * context are sampled proportionally to their choice values; when none of
+     * them is feasible the feasible column with the largest exact choice value
+     * is taken.
+     *
+     * @param weights - scratch buffer, at least candidates().size() long
+     * @return cost of the solution, infinity on a dead end
+     */
+    template<AcoProblem ProblemT>
+    double construct_solution(const ProblemT &problem, PheromoneModel &model, typename ProblemT::State &state,
+                              std::vector<double> &weights, std::mt19937 &rng, const AntConstructionRule &rule) {
+        const CandidateList &candidates = problem.candidates();
+        problem.start(state, rng);
+        while (!problem.complete(state)) {
+            const std::size_t context = problem.context(state);
+            const std::uint32_t *candidate_row = candidates[context];
+            const std::size_t count = candidates.count(context);
+            double total = 0.0;
+            std::size_t best = 0;
+            for (std::size_t c = 0; c < count; ++c) {
+                const double weight = problem.feasible(state, candidate_row[c]) ? model.choice(context, candidate_row[c])
+                                                                                : 0.0;
+                weights[c] = weight;
+                total += weight;
+                if (weight > weights[best])
+                    best = c;
+            }
+
+            std::size_t next = std::numeric_limits<std::size_t>::max();
+            if (total > 0.0) {
+                if (rule.q0 > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < rule.q0) {
+                    next = candidate_row[best];
+                } else {
+                    double r = std::uniform_real_distribution<double>(0.0, total)(rng);
+                    std::size_t c = 0;
+                    for (; c + 1 < count; ++c) {
+                        r -= weights[c];
+                        if (r < 0.0 && weights[c] > 0.0)
+                            break;
+                    }
+                    // Rounding may leave us on an infeasible candidate at the end of the wheel
+                    while (weights[c] <= 0.0)
+                        --c;
+                    next = candidate_row[c];
+                }
+            } else {
+                double best_value = -1.0;
+                for (std::size_t j = 0; j < problem.cols(); ++j) {
+                    if (!problem.feasible(state, j))
+                        continue;
+                    const double value = model.exact_choice(context, j);
+                    if (value > best_value) {
+                        best_value = value;
+                        next = j;
+                    }
+                }
+                if (next == std::numeric_limits<std::size_t>::max())
+                    return std::numeric_limits<double>::infinity();
+            }
+
+            if (rule.local_update)
+                model.local_update(context, next, rule.xi);
+            problem.apply(state, next);
+        }
+        return problem.cost(state.solution);
+    }
+
+    /**
+     * @brief Interface of an ant of AntColony
+     */
+    template<AcoProblem ProblemT>
+    class IAntUnit : public ISwarmUnit {
+    public:
+        /**
+         * @brief solution built in the last iteration
+         */
+        virtual const std::vector<int> &getSolution() const = 0;
+        /**
+         * @brief its cost, infinity if the ant got stuck
+         */
+        virtual double getCost() const = 0;
+    };
+
+    template<typename UT>
+    class AntExecutor : public IExecutorUnitC<EmptyParams, UT> {
+    public:
+        void init() override {}
+        void iter() override {}
+        AntExecutor(UT *u) : IExecutorUnitC<EmptyParams, UT>(u) {}
+    };
+
+    /**
+     * @brief Builds the ant's solution every iteration and improves it with the
+     * problem's local search if enabled
+     */
+    template<AcoProblem ProblemT>
+    class AntExecutor<AntUnit<ProblemT>> : public IExecutorUnitC<EmptyParams, AntUnit<ProblemT>> {
+    public:
+        void init() override {
+            AntUnit<ProblemT> &u = *this->_U;
+            u._State.emplace(u._Problem.make_state());
+            u._Weights.assign(u._Problem.candidates().size(), 0.0);
+            u._Cost = std::numeric_limits<double>::infinity();
+        }
+        void iter() override {
+            AntUnit<ProblemT> &u = *this->_U;
+            const AntColonyParams &p = u._params.g;
+            AntConstructionRule rule;
+            if (p.variant == AcoVariant::AntColonySystem) {
+                rule.q0 = p.acs_q0;
+                rule.local_update = true;
+                rule.xi = p.acs_xi;
+            }
+            u._Cost = construct_solution(u._Problem, u._Model, *u._State, u._Weights, u._Rng, rule);
+            if (p.local_search && !std::isinf(u._Cost) && u._Problem.improve(*u._State))
+                u._Cost = u._Problem.cost(u._State->solution);
+        }
+        AntExecutor(AntUnit<ProblemT> *u) : IExecutorUnitC<EmptyParams, AntUnit<ProblemT>>(u) {}
+        friend AntUnit<ProblemT>;
+    };
+
+    /**
+     * @brief Ant of AntColony. Reads the shared pheromone model (and writes it only
+     * through the atomic ACS local update), draws from its own random stream, so
+     * solutions depend on the seed and the ant index but not on the thread that
+     * builds them.
+     */
+    template<AcoProblem ProblemT>
+    class AntUnit : public BasicSwarmUnit<AntUnit<ProblemT>, LinkToGlobalParams<AntColonyParams>, EmptyTaskManagerC,
+                                          EmptyCommunicationC, AntExecutor>,
+                    public virtual IAntUnit<ProblemT> {
+        const ProblemT &_Problem;
+        PheromoneModel &_Model;
+        std::optional<typename ProblemT::State> _State;
+        std::vector<double> _Weights;
+        std::mt19937 _Rng;
+        double _Cost = std::numeric_limits<double>::infinity();
+
+    public:
+        using _Base = BasicSwarmUnit<AntUnit<ProblemT>, LinkToGlobalParams<AntColonyParams>, EmptyTaskManagerC,
+                                     EmptyCommunicationC, AntExecutor>;
+        /**
+         * @param p - parameters of the colony
+         * @param problem, model - shared by all ants of the colony
+         * @param index - selects the random stream of the ant together with p.seed
+         */
+        AntUnit(const AntColonyParams &p, const ProblemT &problem, PheromoneModel &model, std::size_t index) :
+            _Base(LinkToGlobalParams<AntColonyParams>(p)), _Problem(problem), _Model(model) {
+            std::seed_seq seq{static_cast<std::uint32_t>(p.seed), static_cast<std::uint32_t>(p.seed >> 32),
+                              static_cast<std::uint32_t>(index)};
+            _Rng.seed(seq);
+        }
+
+        const std::vector<int> &getSolution() const override { return _State->solution; }
+        double getCost() const override { return _Cost; }
+
+        void init() override { _Base::init(); }
+        void iter() override { _Base::iter(); }
+
+        friend class AntExecutor<AntUnit<ProblemT>>;
+    };
+} // namespace swarm
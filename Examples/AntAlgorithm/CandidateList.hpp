@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cppSwarmLib/CSRGraph.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "DenseMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief Nearest-neighbor candidate lists: for every city the indices of its
+     * (up to) k closest reachable cities, sorted by distance. Stored flat, one
+     * row of k entries per city, so a construction step reads one short row.
+     */
+    class CandidateList {
+        std::size_t _k = 0;
+        std::vector<std::uint32_t> _neighbors; // n * k, row i - candidates of city i
+        std::vector<std::uint32_t> _counts;    // number of valid entries in row i
+
+    public:
+        CandidateList() = default;
+        /**
+         * @brief Build the lists from a distance matrix, infinite distances are
+         * not edges and never become candidates
+         *
+         * @param distances - square distance matrix
+         * @param k - maximum number of candidates per city
+         */
+        CandidateList(const DenseMatrix<double> &distances, std::size_t k) :
+            _k(std::min(k, distances.rows() > 0 ? distances.rows() - 1 : 0)),
+            _neighbors(distances.rows() * _k),
+            _counts(distances.rows(), 0) {
+            const std::size_t n = distances.rows();
+            std::vector<std::uint32_t> order;
+            order.reserve(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                const double *distance_row = distances.row(i);
+                order.clear();
+                for (std::size_t j = 0; j < n; ++j) {
+                    if (j != i && !std::isinf(distance_row[j]))
+                        order.push_back(static_cast<std::uint32_t>(j));
+                }
+                auto closer = [distance_row](std::uint32_t a, std::uint32_t b) {
+                    return distance_row[a] < distance_row[b] || (!(distance_row[b] < distance_row[a]) && a < b);
+                };
+                const std::size_t count = std::min(_k, order.size());
+                std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(count), order.end(),
+                                  closer);
+                std::copy_n(order.begin(), count, _neighbors.begin() + static_cast<std::ptrdiff_t>(i * _k));
+                _counts[i] = static_cast<std::uint32_t>(count);
+            }
+        }
+
+        /**
+         * @brief Build the lists from the out-edges of a sparse graph, O(edges) instead of O(n^2)
+         *
+         * @param graph - graph over the cities
+         * @param k - maximum number of candidates per city
+         */
+        CandidateList(const CSRGraph<double> &graph, std::size_t k) :
+            _k(std::min(k, graph.num_vertices() > 0 ? graph.num_vertices() - 1 : 0)),
+            _neighbors(graph.num_vertices() * _k),
+            _counts(graph.num_vertices(), 0) {
+            std::vector<std::uint32_t> order;
+            for (std::size_t i = 0; i < graph.num_vertices(); ++i) {
+                const auto targets = graph.neighbors(i);
+                const auto weights = graph.weights(i);
+                order.resize(targets.size());
+                std::iota(order.begin(), order.end(), 0u);
+                // Self loops and infinite weights are not candidates
+                std::erase_if(order, [&](std::uint32_t e) { return targets[e] == i || std::isinf(weights[e]); });
+                const std::size_t count = std::min(_k, order.size());
+                std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(count), order.end(),
+                                  [&weights](std::uint32_t a, std::uint32_t b) {
+                                      return weights[a] < weights[b] || (!(weights[b] < weights[a]) && a < b);
+                                  });
+                for (std::size_t c = 0; c < count; ++c)
+                    _neighbors[i * _k + c] = targets[order[c]];
+                _counts[i] = static_cast<std::uint32_t>(count);
+            }
+        }
+
+        /**
+         * @brief Lists that hold every column for every row, for problems without a
+         * natural neighborhood (assignment, coloring)
+         */
+        static CandidateList all(std::size_t rows, std::size_t cols) {
+            CandidateList list;
+            list._k = cols;
+            list._neighbors.resize(rows * cols);
+            list._counts.assign(rows, static_cast<std::uint32_t>(cols));
+            for (std::size_t i = 0; i < rows; ++i) {
+                std::iota(list._neighbors.begin() + static_cast<std::ptrdiff_t>(i * cols),
+                          list._neighbors.begin() + static_cast<std::ptrdiff_t>((i + 1) * cols), 0u);
+            }
+            return list;
+        }
+
+        /**
+         * @brief maximum number of candidates per city
+         */
+        std::size_t size() const { return _k; }
+        std::size_t count(std::size_t city) const { return _counts[city]; }
+        const std::uint32_t *operator[](std::size_t city) const { return _neighbors.data() + city * _k; }
+    };
+} // namespace swarm
@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cppSwarmLib/AlignedAllocator.hpp>
+#include <cstddef>
+
+namespace swarm {
+    /**
+     * @brief Flat row-major matrix. Every row starts on a cache line boundary
+     * (the stride is padded up to a whole number of cache lines), so a row scan
+     * is one sequential, aligned stream and an element lookup is a single load.
+     *
+     * @tparam T - trivially copyable element type
+     */
+    template<typename T>
+    class DenseMatrix {
+        static constexpr std::size_t RowAlign = std::max<std::size_t>(1, CacheLineSize / sizeof(T));
+
+        std::size_t _rows = 0;
+        std::size_t _cols = 0;
+        std::size_t _stride = 0;
+        AlignedVector<T> _data;
+
+    public:
+        DenseMatrix() = default;
+        DenseMatrix(std::size_t rows, std::size_t cols, const T &value = T()) :
+            _rows(rows), _cols(cols), _stride((cols + RowAlign - 1) / RowAlign * RowAlign),
+            _data(rows * _stride, value) {}
+
+        std::size_t rows() const { return _rows; }
+        std::size_t cols() const { return _cols; }
+        /**
+         * @brief distance in elements between the starts of two rows, >= cols()
+         */
+        std::size_t stride() const { return _stride; }
+
+        T &operator()(std::size_t i, std::size_t j) { return _data[i * _stride + j]; }
+        const T &operator()(std::size_t i, std::size_t j) const { return _data[i * _stride + j]; }
+
+        T *row(std::size_t i) { return _data.data() + i * _stride; }
+        const T *row(std::size_t i) const { return _data.data() + i * _stride; }
+
+        T *data() { return _data.data(); }
+        const T *data() const { return _data.data(); }
+
+        void fill(const T &value) { std::fill(_data.begin(), _data.end(), value); }
+    };
+} // namespace swarm
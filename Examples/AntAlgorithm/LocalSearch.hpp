@@ -0,0 +1,228 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CandidateList.hpp"
+#include "DenseMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief 2-opt and Or-opt local search for symmetric TSP tours. Moves are
+     * only looked for between a city and its candidate-list neighbors, and a
+     * city whose neighborhood gave no improving move is skipped (don't-look
+     * bit) until one of its tour edges changes.
+     *
+     * Keeps its scratch buffers between calls, so use one object per thread.
+     */
+    class TourLocalSearch {
+        const DenseMatrix<double> &_distances;
+        const CandidateList &_candidates;
+        std::size_t _n;
+        std::vector<std::size_t> _tour;   // open tour, _tour[_pos[c]] == c
+        std::vector<std::size_t> _pos;
+        std::vector<unsigned char> _dont_look;
+        std::vector<std::size_t> _block;  // scratch for Or-opt block moves
+
+        static constexpr double Epsilon = 1e-9;
+
+    public:
+        TourLocalSearch(const DenseMatrix<double> &distances, const CandidateList &candidates) :
+            _distances(distances), _candidates(candidates), _n(distances.rows()), _pos(_n), _dont_look(_n) {
+            _tour.reserve(_n);
+            _block.reserve(_n);
+        }
+
+        /**
+         * @brief Improve a closed tour (first city repeated at the end) in place
+         *
+         * @param tour - closed tour over all cities
+         * @param use_or_opt - also apply Or-opt segment moves (segments of 1 to 3 cities)
+         * @return true if the tour was changed
+         */
+        bool improve(std::vector<int> &tour, bool use_or_opt) {
+            if (_n < 8 || tour.size() != _n + 1)
+                return false;
+            _tour.resize(_n);
+            for (std::size_t i = 0; i < _n; ++i) {
+                _tour[i] = static_cast<std::size_t>(tour[i]);
+                _pos[_tour[i]] = i;
+            }
+            std::fill(_dont_look.begin(), _dont_look.end(), 0);
+
+            bool changed = false;
+            bool improved = true;
+            while (improved) {
+                improved = false;
+                for (std::size_t i = 0; i < _n; ++i) {
+                    const std::size_t city = _tour[i];
+                    if (_dont_look[city])
+                        continue;
+                    if (two_opt_move(city) || (use_or_opt && or_opt_move(city))) {
+                        improved = true;
+                        changed = true;
+                    } else {
+                        _dont_look[city] = 1;
+                    }
+                }
+            }
+            if (changed) {
+                for (std::size_t i = 0; i < _n; ++i)
+                    tour[i] = static_cast<int>(_tour[i]);
+                tour.back() = tour.front();
+            }
+            return changed;
+        }
+
+    private:
+        double d(std::size_t a, std::size_t b) const { return _distances(a, b); }
+        std::size_t succ(std::size_t city) const { return _tour[(_pos[city] + 1) % _n]; }
+        std::size_t pred(std::size_t city) const { return _tour[(_pos[city] + _n - 1) % _n]; }
+        void wake(std::size_t city) { _dont_look[city] = 0; }
+
+        /**
+         * @brief First improving 2-opt move that replaces a tour edge at `a` with an edge to a candidate
+         */
+        bool two_opt_move(std::size_t a) {
+            const std::uint32_t *neighbors = _candidates[a];
+            const std::size_t count = _candidates.count(a);
+            for (int direction = 0; direction < 2; ++direction) {
+                const bool forward = direction == 0;
+                const std::size_t b = forward ? succ(a) : pred(a);
+                double d_ab = d(a, b);
+                for (std::size_t k = 0; k < count; ++k) {
+                    const std::size_t c = neighbors[k];
+                    double d_ac = d(a, c);
+                    if (d_ac >= d_ab)
+                        break; // Candidates are sorted, no further gain possible
+                    const std::size_t e = forward ? succ(c) : pred(c);
+                    if (c == b || e == a)
+                        continue;
+                    double delta = d_ac + d(b, e) - d_ab - d(c, e);
+                    if (delta < -Epsilon) {
+                        // forward: edges (a,b),(c,e) -> (a,c),(b,e); backward: (b,a),(e,c) -> (e,b),(c,a)
+                        if (forward)
+                            reverse(_pos[b], _pos[c]);
+                        else
+                            reverse(_pos[a], _pos[e]);
+                        wake(a);
+                        wake(b);
+                        wake(c);
+                        wake(e);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Reverse the tour path between positions from and to (inclusive, going forward). The shorter
+         * of the path and its complement is reversed, which gives the same cycle.
+         */
+        void reverse(std::size_t from, std::size_t to) {
+            std::size_t length = (to + _n - from) % _n + 1;
+            if (2 * length > _n) {
+                std::size_t new_from = (to + 1) % _n;
+                to = (from + _n - 1) % _n;
+                from = new_from;
+                length = _n - length;
+            }
+            for (std::size_t k = 0; k < length / 2; ++k) {
+                std::size_t i = (from + k) % _n;
+                std::size_t j = (to + _n - k) % _n;
+                std::swap(_tour[i], _tour[j]);
+                _pos[_tour[i]] = i;
+                _pos[_tour[j]] = j;
+            }
+        }
+
+        /**
+         * @brief First improving move of a segment of 1..3 cities starting at `first` to the edge next to one
+         * of the candidates of its end cities, in either orientation
+         */
+        bool or_opt_move(std::size_t first) {
+            for (std::size_t length = 1; length <= 3; ++length) {
+                const std::size_t first_pos = _pos[first];
+                const std::size_t last = _tour[(first_pos + length - 1) % _n];
+                const std::size_t p = pred(first);
+                const std::size_t nx = succ(last);
+                double removal_gain = d(p, first) + d(last, nx) - d(p, nx);
+                if (removal_gain <= Epsilon)
+                    continue;
+                for (int end = 0; end < 2; ++end) {
+                    const std::size_t pivot = end == 0 ? first : last;
+                    const std::uint32_t *neighbors = _candidates[pivot];
+                    const std::size_t count = _candidates.count(pivot);
+                    for (std::size_t k = 0; k < count; ++k) {
+                        const std::size_t c = neighbors[k];
+                        if (d(pivot, c) >= removal_gain)
+                            break;
+                        // Insertion edges (c, succ c) and (pred c, c)
+                        for (int side = 0; side < 2; ++side) {
+                            const std::size_t x = side == 0 ? c : pred(c);
+                            const std::size_t y = succ(x);
+                            if (in_segment(x, first_pos, length) || in_segment(y, first_pos, length))
+                                continue;
+                            double d_xy = d(x, y);
+                            double forward_cost = d(x, first) + d(last, y) - d_xy;
+                            double reversed_cost = d(x, last) + d(first, y) - d_xy;
+                            bool reversed = reversed_cost < forward_cost;
+                            if (std::min(forward_cost, reversed_cost) < removal_gain - Epsilon) {
+                                move_segment(first_pos, length, x, reversed);
+                                wake(p);
+                                wake(nx);
+                                wake(first);
+                                wake(last);
+                                wake(x);
+                                wake(y);
+                                return true;
+                            }
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        bool in_segment(std::size_t city, std::size_t first_pos, std::size_t length) const {
+            return (_pos[city] + _n - first_pos) % _n < length;
+        }
+
+        /**
+         * @brief Move the segment of `length` cities at first_pos between x and succ(x). With the segment S,
+         * the path A from its successor to x and the path B from succ(x) to its predecessor, the cycle
+         * S A B becomes A S B; the cheaper of rotating (S A) or (B S) is done.
+         */
+        void move_segment(std::size_t first_pos, std::size_t length, std::size_t x, bool reversed) {
+            std::size_t a_length = (_pos[x] + _n - first_pos) % _n + 1 - length;
+            std::size_t b_length = _n - length - a_length;
+            std::size_t start, total, shift;
+            std::size_t segment_offset; // position of the segment inside the rotated block afterwards
+            if (a_length <= b_length) {
+                start = first_pos; // (S A) -> (A S)
+                total = length + a_length;
+                shift = length;
+                segment_offset = a_length;
+            } else {
+                start = (first_pos + _n - b_length) % _n; // (B S) -> (S B)
+                total = b_length + length;
+                shift = b_length;
+                segment_offset = 0;
+            }
+            _block.resize(total);
+            for (std::size_t k = 0; k < total; ++k)
+                _block[k] = _tour[(start + k) % _n];
+            std::rotate(_block.begin(), _block.begin() + static_cast<std::ptrdiff_t>(shift), _block.end());
+            if (reversed) {
+                auto segment_begin = _block.begin() + static_cast<std::ptrdiff_t>(segment_offset);
+                std::reverse(segment_begin, segment_begin + static_cast<std::ptrdiff_t>(length));
+            }
+            for (std::size_t k = 0; k < total; ++k) {
+                std::size_t i = (start + k) % _n;
+                _tour[i] = _block[k];
+                _pos[_tour[i]] = i;
+            }
+        }
+    };
+} // namespace swarm
@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "DenseMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief Pheromone trails with lazy evaporation. Every entry remembers the
+     * iteration it was last written in; its current value is the stored one
+     * times (1 - rho)^age, clamped to [tau_min, tau_max]. Evaporating the whole
+     * matrix is one counter increment, and the per-iteration work is only the
+     * entries that are actually read back (refresh) or deposited on.
+     *
+     * Trail values are accessed with relaxed atomics so ACS local updates may run
+     * while other ants read; stamps and limits only change between iterations.
+     */
+    class PheromoneMatrix {
+        static constexpr std::size_t DecayTableSize = 1024;
+
+        DenseMatrix<double> _tau;          // value at iteration _stamp(i, j)
+        DenseMatrix<std::uint32_t> _stamp; // iteration of the last write
+        std::vector<double> _decay_pow;    // (1 - rho)^age for small ages
+        double _decay = 1.0;
+        double _tau_min = 0.0;
+        double _tau_max = std::numeric_limits<double>::max();
+        std::uint32_t _now = 0;
+
+    public:
+        PheromoneMatrix() = default;
+        /**
+         * @param rows - number of decision contexts (the current city for TSP)
+         * @param cols - number of choosable solution components (the next city for TSP)
+         * @param evaporation_rate - rho, 0 disables evaporation
+         */
+        PheromoneMatrix(std::size_t rows, std::size_t cols, double evaporation_rate) :
+            _tau(rows, cols, 0.0), _stamp(rows, cols, 0), _decay_pow(DecayTableSize), _decay(1.0 - evaporation_rate) {
+            double p = 1.0;
+            for (auto &v : _decay_pow) {
+                v = p;
+                p *= _decay;
+            }
+        }
+
+        std::size_t rows() const { return _tau.rows(); }
+        std::size_t cols() const { return _tau.cols(); }
+        std::uint32_t iteration() const { return _now; }
+
+        /**
+         * @brief Set every trail to level. O(rows * cols), used for initialization and restarts.
+         */
+        void reset(double level) {
+            _tau.fill(level);
+            _stamp.fill(_now);
+        }
+
+        /**
+         * @brief Evaporate every trail by one step
+         */
+        void next_iteration() { ++_now; }
+
+        void set_limits(double tau_min, double tau_max) {
+            _tau_min = tau_min;
+            _tau_max = tau_max;
+        }
+
+        /**
+         * @brief current trail on (i, j)
+         */
+        double operator()(std::size_t i, std::size_t j) const {
+            const double stored =
+                    std::atomic_ref<double>(const_cast<double &>(_tau(i, j))).load(std::memory_order_relaxed);
+            return std::clamp(stored * decay_pow(_now - _stamp(i, j)), _tau_min, _tau_max);
+        }
+
+        /**
+         * @brief Materialize the current trail on (i, j) so later reads need no decay
+         * @return the current trail
+         */
+        double refresh(std::size_t i, std::size_t j) {
+            const double value = (*this)(i, j);
+            _tau(i, j) = value;
+            _stamp(i, j) = _now;
+            return value;
+        }
+
+        /**
+         * @brief Add amount to the current trail on (i, j)
+         * @return the new trail
+         */
+        double deposit(std::size_t i, std::size_t j, double amount) {
+            const double value = std::min((*this)(i, j) + amount, _tau_max);
+            _tau(i, j) = value;
+            _stamp(i, j) = _now;
+            return value;
+        }
+
+        /**
+         * @brief Overwrite the trail on (i, j)
+         */
+        void set(std::size_t i, std::size_t j, double value) {
+            _tau(i, j) = value;
+            _stamp(i, j) = _now;
+        }
+
+        /**
+         * @brief Ant Colony System local update tau = (1 - xi) * tau + xi * tau0. Safe to call from ants
+         * building tours concurrently; only meaningful without global evaporation (rho = 0), since the
+         * stamp is left untouched.
+         * @return the new trail
+         */
+        double local_update(std::size_t i, std::size_t j, double xi, double tau0) {
+            std::atomic_ref<double> tau(_tau(i, j));
+            const double value = (1.0 - xi) * tau.load(std::memory_order_relaxed) + xi * tau0;
+            tau.store(value, std::memory_order_relaxed);
+            return value;
+        }
+
+    private:
+        double decay_pow(std::uint32_t age) const {
+            return age < DecayTableSize ? _decay_pow[age] : std::pow(_decay, static_cast<double>(age));
+        }
+    };
+} // namespace swarm
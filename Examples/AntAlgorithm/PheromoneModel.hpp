@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "CandidateList.hpp"
+#include "DenseMatrix.hpp"
+#include "PheromoneMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief Pheromone model shared by all ants of a colony: the (lazily
+     * evaporated) trails, the static heuristic eta^beta and the choice values
+     * tau^alpha * eta^beta the ants sample from. Rows are decision contexts and
+     * columns solution components, as defined by the problem.
+     *
+     * choice() is kept current on candidate-list entries and on every entry that
+     * was written; entries outside the candidate lists are read exactly with
+     * exact_choice().
+     */
+    class PheromoneModel {
+        PheromoneMatrix _trails;
+        DenseMatrix<double> _heuristic; // eta^beta
+        DenseMatrix<double> _choice;    // tau^alpha * eta^beta
+        double _alpha = 1.0;
+        bool _unit_alpha = true; // tau^alpha is tau, skip pow
+        double _initial = 0.0;
+
+    public:
+        PheromoneModel() = default;
+        /**
+         * @param problem - provides rows(), cols() and the heuristic eta(i, j)
+         * @param alpha - pheromone influence
+         * @param beta - heuristic influence
+         * @param evaporation_rate - rho of the lazy global evaporation, 0 disables it
+         */
+        template<class ProblemT>
+        PheromoneModel(const ProblemT &problem, double alpha, double beta, double evaporation_rate) :
+            _trails(problem.rows(), problem.cols(), evaporation_rate),
+            _heuristic(problem.rows(), problem.cols(), 0.0),
+            _choice(problem.rows(), problem.cols(), 0.0),
+            _alpha(alpha), _unit_alpha(!(alpha < 1.0 || alpha > 1.0)) {
+            for (std::size_t i = 0; i < problem.rows(); ++i) {
+                double *heuristic_row = _heuristic.row(i);
+                for (std::size_t j = 0; j < problem.cols(); ++j)
+                    heuristic_row[j] = std::pow(problem.heuristic(i, j), beta);
+            }
+        }
+
+        std::size_t rows() const { return _trails.rows(); }
+        std::size_t cols() const { return _trails.cols(); }
+        PheromoneMatrix &trails() { return _trails; }
+        const PheromoneMatrix &trails() const { return _trails; }
+        /**
+         * @brief level of the last reset(), tau0 of the Ant Colony System local update
+         */
+        double initial() const { return _initial; }
+
+        /**
+         * @brief Set every trail to level and recompute all choice values
+         */
+        void reset(double level) {
+            _initial = level;
+            _trails.reset(level);
+            for (std::size_t i = 0; i < rows(); ++i) {
+                for (std::size_t j = 0; j < cols(); ++j)
+                    _choice(i, j) = value(level, i, j);
+            }
+        }
+
+        /**
+         * @brief current choice value of (i, j), valid on candidate-list and
+         * written entries. Safe to read while ants apply local updates.
+         */
+        double choice(std::size_t i, std::size_t j) const {
+            return std::atomic_ref<double>(const_cast<double &>(_choice(i, j))).load(std::memory_order_relaxed);
+        }
+        /**
+         * @brief choice value of (i, j) computed from the current trail
+         */
+        double exact_choice(std::size_t i, std::size_t j) const { return value(_trails(i, j), i, j); }
+
+        /**
+         * @brief Bring the trails of the candidate entries of rows [row_begin, row_end) up to
+         * date after next_iteration(); rows may be refreshed by different threads
+         */
+        void refresh(const CandidateList &candidates, std::size_t row_begin, std::size_t row_end) {
+            for (std::size_t i = row_begin; i < row_end; ++i) {
+                const std::uint32_t *candidate_row = candidates[i];
+                const std::size_t count = candidates.count(i);
+                for (std::size_t c = 0; c < count; ++c) {
+                    const std::uint32_t j = candidate_row[c];
+                    _choice(i, j) = value(_trails.refresh(i, j), i, j);
+                }
+            }
+        }
+
+        void deposit(std::size_t i, std::size_t j, double amount) {
+            _choice(i, j) = value(_trails.deposit(i, j, amount), i, j);
+        }
+        void set(std::size_t i, std::size_t j, double tau) {
+            _trails.set(i, j, tau);
+            _choice(i, j) = value(tau, i, j);
+        }
+        /**
+         * @brief Ant Colony System local update towards initial(), safe to call concurrently
+         */
+        void local_update(std::size_t i, std::size_t j, double xi) {
+            const double tau = _trails.local_update(i, j, xi, _initial);
+            std::atomic_ref<double>(_choice(i, j)).store(value(tau, i, j), std::memory_order_relaxed);
+        }
+
+    private:
+        double value(double tau, std::size_t i, std::size_t j) const {
+            return (_unit_alpha ? tau : std::pow(tau, _alpha)) * _heuristic(i, j);
+        }
+    };
+} // namespace swarm
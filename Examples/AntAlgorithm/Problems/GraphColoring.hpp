@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../CandidateList.hpp"
+
+namespace swarm {
+    /**
+     * @brief Graph coloring: give every vertex a color different from its
+     * neighbors, minimizing the number of colors used. The solution is the color
+     * of every vertex, pheromone is kept per (vertex, color). Vertices are colored
+     * in order of decreasing degree; the heuristic prefers low colors, so a
+     * solution always exists with max degree + 1 colors.
+     */
+    class GraphColoring {
+        std::vector<std::vector<std::uint32_t>> _adjacency;
+        std::size_t _colors = 1;
+        std::vector<std::size_t> _order; // vertex colored in step s
+        CandidateList _candidates;
+
+    public:
+        struct State {
+            std::vector<int> solution;         // color of every vertex, -1 while uncolored
+            std::vector<std::uint32_t> blocked; // vertex * colors + c: neighbors colored c
+            std::size_t step = 0;
+        };
+
+        /**
+         * @param adjacency - neighbors of every vertex, both directions listed
+         */
+        explicit GraphColoring(std::vector<std::vector<std::uint32_t>> adjacency) :
+            _adjacency(std::move(adjacency)), _order(_adjacency.size()) {
+            for (const auto &neighbors : _adjacency)
+                _colors = std::max(_colors, neighbors.size() + 1);
+            _candidates = CandidateList::all(size(), _colors);
+            std::iota(_order.begin(), _order.end(), std::size_t{0});
+            std::stable_sort(_order.begin(), _order.end(), [this](std::size_t a, std::size_t b) {
+                return _adjacency[a].size() > _adjacency[b].size();
+            });
+        }
+
+        std::size_t size() const { return _adjacency.size(); }
+        /**
+         * @brief number of colors ants may use, max degree + 1
+         */
+        std::size_t colors() const { return _colors; }
+        const std::vector<std::vector<std::uint32_t>> &adjacency() const { return _adjacency; }
+
+        std::size_t rows() const { return size(); }
+        std::size_t cols() const { return _colors; }
+        double heuristic(std::size_t, std::size_t color) const { return 1.0 / static_cast<double>(color + 1); }
+        const CandidateList &candidates() const { return _candidates; }
+
+        State make_state() const {
+            State state;
+            state.solution.assign(size(), -1);
+            state.blocked.assign(size() * _colors, 0);
+            return state;
+        }
+        void start(State &state, std::mt19937 &) const {
+            std::fill(state.solution.begin(), state.solution.end(), -1);
+            std::fill(state.blocked.begin(), state.blocked.end(), 0);
+            state.step = 0;
+        }
+        bool complete(const State &state) const { return state.step == size(); }
+        std::size_t context(const State &state) const { return _order[state.step]; }
+        bool feasible(const State &state, std::size_t color) const {
+            return state.blocked[context(state) * _colors + color] == 0;
+        }
+        void apply(State &state, std::size_t color) const {
+            const std::size_t vertex = context(state);
+            state.solution[vertex] = static_cast<int>(color);
+            for (std::uint32_t neighbor : _adjacency[vertex])
+                ++state.blocked[neighbor * _colors + color];
+            ++state.step;
+        }
+        bool improve(State &) const { return false; }
+
+        /**
+         * @brief number of distinct colors, infinity for an improper coloring
+         */
+        double cost(const std::vector<int> &solution) const {
+            std::vector<unsigned char> used(_colors, 0);
+            for (std::size_t v = 0; v < size(); ++v) {
+                const int color = solution[v];
+                if (color < 0 || static_cast<std::size_t>(color) >= _colors)
+                    return std::numeric_limits<double>::infinity();
+                for (std::uint32_t neighbor : _adjacency[v]) {
+                    if (solution[neighbor] == color)
+                        return std::numeric_limits<double>::infinity();
+                }
+                used[static_cast<std::size_t>(color)] = 1;
+            }
+            return static_cast<double>(std::count(used.begin(), used.end(), 1));
+        }
+        template<class F>
+        void for_each_component(const std::vector<int> &solution, F &&f) const {
+            for (std::size_t v = 0; v < solution.size(); ++v)
+                f(v, static_cast<std::size_t>(solution[v]));
+        }
+    };
+} // namespace swarm
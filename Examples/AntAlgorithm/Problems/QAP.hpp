@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../CandidateList.hpp"
+#include "../DenseMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief Quadratic assignment problem: place n facilities on n locations
+     * minimizing sum flow(i, j) * distance(p(i), p(j)). The solution is the
+     * location of every facility, pheromone is kept per (facility, location).
+     * Facilities are assigned in order of decreasing flow potential. There is no
+     * useful static heuristic (beta is usually 0), local search is best-improvement
+     * 2-exchange.
+     */
+    class QAP {
+        DenseMatrix<double> _flows;
+        DenseMatrix<double> _distances;
+        std::vector<std::size_t> _order; // facility assigned in step s
+        CandidateList _candidates;
+
+    public:
+        struct State {
+            std::vector<int> solution;       // location of every facility, -1 while unassigned
+            std::vector<unsigned char> used; // locations taken
+            std::size_t step = 0;
+        };
+
+        /**
+         * @param flows - n x n flows between facilities
+         * @param distances - n x n distances between locations
+         */
+        QAP(DenseMatrix<double> flows, DenseMatrix<double> distances) :
+            _flows(std::move(flows)), _distances(std::move(distances)), _order(_flows.rows()),
+            _candidates(CandidateList::all(_flows.rows(), _flows.rows())) {
+            const std::size_t n = size();
+            std::vector<double> potential(n, 0.0);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < n; ++j)
+                    potential[i] += _flows(i, j) + _flows(j, i);
+            }
+            std::iota(_order.begin(), _order.end(), std::size_t{0});
+            std::stable_sort(_order.begin(), _order.end(),
+                             [&potential](std::size_t a, std::size_t b) { return potential[a] > potential[b]; });
+        }
+
+        std::size_t size() const { return _flows.rows(); }
+        const DenseMatrix<double> &flows() const { return _flows; }
+        const DenseMatrix<double> &distances() const { return _distances; }
+
+        std::size_t rows() const { return size(); }
+        std::size_t cols() const { return size(); }
+        double heuristic(std::size_t, std::size_t) const { return 1.0; }
+        const CandidateList &candidates() const { return _candidates; }
+
+        State make_state() const {
+            State state;
+            state.solution.assign(size(), -1);
+            state.used.assign(size(), 0);
+            return state;
+        }
+        void start(State &state, std::mt19937 &) const {
+            std::fill(state.solution.begin(), state.solution.end(), -1);
+            std::fill(state.used.begin(), state.used.end(), 0);
+            state.step = 0;
+        }
+        bool complete(const State &state) const { return state.step == size(); }
+        std::size_t context(const State &state) const { return _order[state.step]; }
+        bool feasible(const State &state, std::size_t location) const { return !state.used[location]; }
+        void apply(State &state, std::size_t location) const {
+            state.solution[_order[state.step]] = static_cast<int>(location);
+            state.used[location] = 1;
+            ++state.step;
+        }
+
+        double cost(const std::vector<int> &solution) const {
+            double total = 0.0;
+            for (std::size_t i = 0; i < size(); ++i) {
+                const double *flow_row = _flows.row(i);
+                const double *distance_row = _distances.row(static_cast<std::size_t>(solution[i]));
+                for (std::size_t j = 0; j < size(); ++j)
+                    total += flow_row[j] * distance_row[solution[j]];
+            }
+            return total;
+        }
+
+        /**
+         * @brief Cost change of exchanging the locations of facilities r and s, O(n)
+         */
+        double swap_delta(const std::vector<int> &p, std::size_t r, std::size_t s) const {
+            const auto pr = static_cast<std::size_t>(p[r]);
+            const auto ps = static_cast<std::size_t>(p[s]);
+            double delta = _flows(r, r) * (_distances(ps, ps) - _distances(pr, pr)) +
+                           _flows(r, s) * (_distances(ps, pr) - _distances(pr, ps)) +
+                           _flows(s, r) * (_distances(pr, ps) - _distances(ps, pr)) +
+                           _flows(s, s) * (_distances(pr, pr) - _distances(ps, ps));
+            for (std::size_t k = 0; k < size(); ++k) {
+                if (k == r || k == s)
+                    continue;
+                const auto pk = static_cast<std::size_t>(p[k]);
+                delta += _flows(k, r) * (_distances(pk, ps) - _distances(pk, pr)) +
+                         _flows(k, s) * (_distances(pk, pr) - _distances(pk, ps)) +
+                         _flows(r, k) * (_distances(ps, pk) - _distances(pr, pk)) +
+                         _flows(s, k) * (_distances(pr, pk) - _distances(ps, pk));
+            }
+            return delta;
+        }
+
+        bool improve(State &state) const {
+            constexpr double Epsilon = 1e-9;
+            std::vector<int> &p = state.solution;
+            bool changed = false;
+            for (;;) {
+                double best = -Epsilon;
+                std::size_t best_r = 0, best_s = 0;
+                for (std::size_t r = 0; r < size(); ++r) {
+                    for (std::size_t s = r + 1; s < size(); ++s) {
+                        const double delta = swap_delta(p, r, s);
+                        if (delta < best) {
+                            best = delta;
+                            best_r = r;
+                            best_s = s;
+                        }
+                    }
+                }
+                if (best_r == best_s)
+                    return changed;
+                std::swap(p[best_r], p[best_s]);
+                changed = true;
+            }
+        }
+
+        template<class F>
+        void for_each_component(const std::vector<int> &solution, F &&f) const {
+            for (std::size_t i = 0; i < solution.size(); ++i)
+                f(i, static_cast<std::size_t>(solution[i]));
+        }
+    };
+} // namespace swarm
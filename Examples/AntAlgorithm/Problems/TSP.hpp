@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cppSwarmLib/CSRGraph.hpp>
+#include <cppSwarmLib/TSPLIB.hpp>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../CandidateList.hpp"
+#include "../DenseMatrix.hpp"
+#include "../LocalSearch.hpp"
+
+namespace swarm {
+    /**
+     * @brief Traveling salesman problem, symmetric or asymmetric. The solution is
+     * a closed tour (first city repeated at the end), pheromone is kept per
+     * directed edge. Symmetric instances deposit on both directions of an edge and
+     * use 2-opt / Or-opt as local search; asymmetric ones have no local search.
+     */
+    class TSP {
+        DenseMatrix<double> _distances; // infinity where there is no edge
+        CandidateList _candidates;
+        bool _symmetric = true;
+        bool _or_opt = true;
+
+    public:
+        struct State {
+            std::vector<int> solution;
+            std::vector<unsigned char> visited;
+            std::optional<TourLocalSearch> local_search;
+        };
+
+        /**
+         * @param distances - square matrix, infinity where there is no edge
+         * @param candidates_per_city - nearest neighbors considered per construction step
+         * @param or_opt - local search also applies Or-opt moves after 2-opt
+         */
+        explicit TSP(DenseMatrix<double> distances, std::size_t candidates_per_city = 20, bool or_opt = true) :
+            _distances(std::move(distances)), _candidates(_distances, candidates_per_city), _or_opt(or_opt) {
+            detect_symmetry();
+        }
+        /**
+         * @param graph - cities and roads, missing edges get infinite distance; candidates are taken
+         * from the out-edges
+         */
+        explicit TSP(const CSRGraph<double> &graph, std::size_t candidates_per_city = 20, bool or_opt = true) :
+            _distances(graph.num_vertices(), graph.num_vertices(), std::numeric_limits<double>::infinity()),
+            _candidates(graph, candidates_per_city), _or_opt(or_opt) {
+            for (std::size_t u = 0; u < graph.num_vertices(); ++u) {
+                const auto targets = graph.neighbors(u);
+                const auto weights = graph.weights(u);
+                for (std::size_t e = 0; e < targets.size(); ++e)
+                    _distances(u, targets[e]) = weights[e];
+            }
+            detect_symmetry();
+        }
+        /**
+         * @param instance - TSPLIB TSP or ATSP instance, expanded to a full distance matrix
+         */
+        explicit TSP(const TSPLIBInstance &instance, std::size_t candidates_per_city = 20, bool or_opt = true) :
+            TSP(matrix_of(instance), candidates_per_city, or_opt) {}
+        // States keep references to the distances and candidate lists: move the problem into place
+        // before creating them
+        TSP(const TSP &) = delete;
+        TSP &operator=(const TSP &) = delete;
+        TSP(TSP &&) = default;
+
+        /**
+         * @brief every pair of cities is connected with equal costs both ways
+         */
+        bool symmetric() const { return _symmetric; }
+        const DenseMatrix<double> &distances() const { return _distances; }
+        std::size_t size() const { return _distances.rows(); }
+
+        std::size_t rows() const { return size(); }
+        std::size_t cols() const { return size(); }
+        double heuristic(std::size_t i, std::size_t j) const {
+            const double d = _distances(i, j);
+            return d > 1e-9 && !std::isinf(d) ? 1.0 / d : 0.0;
+        }
+        const CandidateList &candidates() const { return _candidates; }
+
+        State make_state() const {
+            State state;
+            state.solution.reserve(size() + 1);
+            state.visited.assign(size(), 0);
+            if (_symmetric)
+                state.local_search.emplace(_distances, _candidates);
+            return state;
+        }
+        void start(State &state, std::mt19937 &rng) const {
+            const int city = std::uniform_int_distribution<int>(0, static_cast<int>(size()) - 1)(rng);
+            std::fill(state.visited.begin(), state.visited.end(), 0);
+            state.solution.assign(1, city);
+            state.visited[static_cast<std::size_t>(city)] = 1;
+        }
+        bool complete(const State &state) const { return state.solution.size() == size() + 1; }
+        std::size_t context(const State &state) const { return static_cast<std::size_t>(state.solution.back()); }
+        bool feasible(const State &state, std::size_t city) const {
+            const auto current = static_cast<std::size_t>(state.solution.back());
+            if (std::isinf(_distances(current, city)))
+                return false;
+            // All cities visited: only the way back to the start is left
+            if (state.solution.size() == size())
+                return city == static_cast<std::size_t>(state.solution.front());
+            return !state.visited[city];
+        }
+        void apply(State &state, std::size_t city) const {
+            state.visited[city] = 1;
+            state.solution.push_back(static_cast<int>(city));
+        }
+        bool improve(State &state) const {
+            return state.local_search && state.local_search->improve(state.solution, _or_opt);
+        }
+
+        double cost(const std::vector<int> &tour) const {
+            if (tour.size() != size() + 1 || tour.back() != tour.front())
+                return std::numeric_limits<double>::infinity();
+            double total = 0.0;
+            for (std::size_t i = 0; i + 1 < tour.size(); ++i)
+                total += _distances(static_cast<std::size_t>(tour[i]), static_cast<std::size_t>(tour[i + 1]));
+            return total;
+        }
+        template<class F>
+        void for_each_component(const std::vector<int> &tour, F &&f) const {
+            for (std::size_t i = 0; i + 1 < tour.size(); ++i) {
+                const auto u = static_cast<std::size_t>(tour[i]);
+                const auto v = static_cast<std::size_t>(tour[i + 1]);
+                f(u, v);
+                if (_symmetric)
+                    f(v, u);
+            }
+        }
+
+    private:
+        static DenseMatrix<double> matrix_of(const TSPLIBInstance &instance) {
+            DenseMatrix<double> distances(instance.dimension, instance.dimension);
+            instance.fill_matrix(distances.data(), distances.stride());
+            return distances;
+        }
+
+        void detect_symmetry() {
+            const std::size_t n = _distances.rows();
+            for (std::size_t i = 0; i < n && _symmetric; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    const double d = _distances(i, j);
+                    const double back = _distances(j, i);
+                    if (std::isinf(d) || d < back || back < d) {
+                        _symmetric = false;
+                        break;
+                    }
+                }
+            }
+        }
+    };
+} // namespace swarm
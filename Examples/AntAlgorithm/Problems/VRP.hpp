@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cppSwarmLib/TSPLIB.hpp>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../CandidateList.hpp"
+#include "../DenseMatrix.hpp"
+
+namespace swarm {
+    /**
+     * @brief Capacitated vehicle routing problem. Node 0 is the depot, every
+     * other node a customer with a demand. The solution is one giant tour that
+     * starts and ends at the depot and returns there whenever a vehicle is
+     * finished, e.g. 0 3 1 0 2 4 0; the number of vehicles is not limited.
+     * An ant may go back to the depot from any customer, the pheromone decides
+     * when that pays off.
+     */
+    class CVRP {
+        DenseMatrix<double> _distances; // infinity where there is no edge
+        std::vector<double> _demands;
+        double _capacity;
+        CandidateList _candidates;
+        bool _symmetric = true;
+
+    public:
+        struct State {
+            std::vector<int> solution;
+            std::vector<unsigned char> visited;
+            double load = 0.0;       // of the current vehicle
+            std::size_t served = 0;  // number of customers visited
+        };
+
+        /**
+         * @param distances - square matrix over depot (0) and customers
+         * @param demands - demand per node, demands[0] is ignored
+         * @param capacity - vehicle capacity
+         * @param candidates_per_node - nearest neighbors considered per construction step
+         */
+        CVRP(DenseMatrix<double> distances, std::vector<double> demands, double capacity,
+             std::size_t candidates_per_node = 20) :
+            _distances(std::move(distances)), _demands(std::move(demands)), _capacity(capacity),
+            _candidates(_distances, candidates_per_node) {
+            _demands.resize(_distances.rows(), 0.0);
+            _demands[0] = 0.0;
+            const std::size_t n = _distances.rows();
+            for (std::size_t i = 0; i < n && _symmetric; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    if (_distances(i, j) < _distances(j, i) || _distances(j, i) < _distances(i, j)) {
+                        _symmetric = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @param instance - TSPLIB CVRP instance with its depot at node 1 (index 0)
+         * @throw std::invalid_argument if the instance has no demands or another depot
+         */
+        explicit CVRP(const TSPLIBInstance &instance, std::size_t candidates_per_node = 20) :
+            CVRP(matrix_of(instance), instance.demands, instance.capacity, candidates_per_node) {}
+
+        std::size_t size() const { return _distances.rows(); }
+        const DenseMatrix<double> &distances() const { return _distances; }
+        const std::vector<double> &demands() const { return _demands; }
+        double capacity() const { return _capacity; }
+
+        std::size_t rows() const { return size(); }
+        std::size_t cols() const { return size(); }
+        double heuristic(std::size_t i, std::size_t j) const {
+            const double d = _distances(i, j);
+            return d > 1e-9 && !std::isinf(d) ? 1.0 / d : 0.0;
+        }
+        const CandidateList &candidates() const { return _candidates; }
+
+        State make_state() const {
+            State state;
+            state.solution.reserve(2 * size());
+            state.visited.assign(size(), 0);
+            return state;
+        }
+        void start(State &state, std::mt19937 &) const {
+            std::fill(state.visited.begin(), state.visited.end(), 0);
+            state.solution.assign(1, 0);
+            state.load = 0.0;
+            state.served = 0;
+        }
+        bool complete(const State &state) const {
+            return state.served + 1 >= size() && state.solution.back() == 0 && state.solution.size() > 1;
+        }
+        std::size_t context(const State &state) const { return static_cast<std::size_t>(state.solution.back()); }
+        bool feasible(const State &state, std::size_t node) const {
+            const auto current = static_cast<std::size_t>(state.solution.back());
+            if (std::isinf(_distances(current, node)))
+                return false;
+            if (node == 0)
+                return current != 0;
+            return !state.visited[node] && state.load + _demands[node] <= _capacity;
+        }
+        void apply(State &state, std::size_t node) const {
+            state.solution.push_back(static_cast<int>(node));
+            if (node == 0) {
+                state.load = 0.0;
+                return;
+            }
+            state.visited[node] = 1;
+            state.load += _demands[node];
+            ++state.served;
+        }
+        bool improve(State &) const { return false; }
+
+        /**
+         * @brief total distance, infinity unless every customer is served exactly once
+         * within capacity
+         */
+        double cost(const std::vector<int> &solution) const {
+            constexpr double Infeasible = std::numeric_limits<double>::infinity();
+            if (solution.size() < 2 || solution.front() != 0 || solution.back() != 0)
+                return Infeasible;
+            std::vector<unsigned char> seen(size(), 0);
+            std::size_t served = 0;
+            double load = 0.0;
+            double total = 0.0;
+            for (std::size_t i = 1; i < solution.size(); ++i) {
+                const auto node = static_cast<std::size_t>(solution[i]);
+                total += _distances(static_cast<std::size_t>(solution[i - 1]), node);
+                if (node == 0) {
+                    load = 0.0;
+                    continue;
+                }
+                if (seen[node])
+                    return Infeasible;
+                seen[node] = 1;
+                ++served;
+                load += _demands[node];
+                if (load > _capacity)
+                    return Infeasible;
+            }
+            return served + 1 == size() ? total : Infeasible;
+        }
+        template<class F>
+        void for_each_component(const std::vector<int> &solution, F &&f) const {
+            for (std::size_t i = 0; i + 1 < solution.size(); ++i) {
+                const auto u = static_cast<std::size_t>(solution[i]);
+                const auto v = static_cast<std::size_t>(solution[i + 1]);
+                f(u, v);
+                if (_symmetric)
+                    f(v, u);
+            }
+        }
+
+    private:
+        static DenseMatrix<double> matrix_of(const TSPLIBInstance &instance) {
+            if (instance.demands.size() != instance.dimension)
+                throw std::invalid_argument("CVRP: TSPLIB instance without DEMAND_SECTION");
+            if (!instance.depots.empty() && (instance.depots.size() != 1 || instance.depots[0] != 0))
+                throw std::invalid_argument("CVRP: the depot must be the first node");
+            DenseMatrix<double> distances(instance.dimension, instance.dimension);
+            instance.fill_matrix(distances.data(), distances.stride());
+            return distances;
+        }
+    };
+} // namespace swarm
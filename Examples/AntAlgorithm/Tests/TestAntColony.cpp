@@ -0,0 +1,179 @@
+#include <cppSwarmLib/AntAlgorithm/AntColony.hpp>
+#include <cppSwarmLib/AntAlgorithm/Problems/GraphColoring.hpp>
+#include <cppSwarmLib/AntAlgorithm/Problems/QAP.hpp>
+#include <cppSwarmLib/AntAlgorithm/Problems/TSP.hpp>
+#include <cppSwarmLib/AntAlgorithm/Problems/VRP.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace swarm;
+
+namespace {
+    // Cities on a circle, the optimal tour follows the circle
+    DenseMatrix<double> circle(std::size_t n) {
+        DenseMatrix<double> d(n, n, std::numeric_limits<double>::infinity());
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                if (i != j) {
+                    const double angle = 2.0 * M_PI * (static_cast<double>(j) - static_cast<double>(i)) / static_cast<double>(n);
+                    d(i, j) = 2.0 * std::abs(std::sin(angle / 2.0));
+                }
+            }
+        }
+        return d;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(AntColonyTSPTest) {
+    constexpr std::size_t n = 30;
+    const double optimum = 2.0 * n * std::sin(M_PI / n);
+    for (auto variant : {AcoVariant::AntSystem, AcoVariant::MaxMinAntSystem, AcoVariant::AntColonySystem}) {
+        AntColonyParams p;
+        p.variant = variant;
+        p.local_search = true;
+        p.seed = 1;
+        p.threads = 2;
+        AntColony<TSP> colony(TSP(circle(n), 10), p, 10);
+        colony.init<AntUnit<TSP>>();
+        for (int i = 0; i < 20; ++i)
+            colony.iter();
+        BOOST_CHECK_CLOSE(colony.best_cost(), optimum, 1e-6);
+        BOOST_CHECK_CLOSE(colony.problem().cost(colony.best_solution()), colony.best_cost(), 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AntColonyDeterminismTest) {
+    // The trails themselves, bit for bit: the order of the deposits must not depend on the threads
+    for (auto variant : {AcoVariant::AntSystem, AcoVariant::MaxMinAntSystem}) {
+        AntColonyParams p;
+        p.variant = variant;
+        p.seed = 7;
+        std::vector<int> solutions[2];
+        std::vector<std::uint64_t> trails[2];
+        for (std::size_t threads : {std::size_t{1}, std::size_t{4}}) {
+            p.threads = threads;
+            AntColony<TSP> colony(TSP(circle(60), 8), p, 16);
+            colony.init<AntUnit<TSP>>();
+            for (int i = 0; i < 50; ++i)
+                colony.iter();
+            const std::size_t run = threads == 1 ? 0 : 1;
+            solutions[run] = colony.best_solution();
+            const PheromoneMatrix &tau = colony.pheromones().trails();
+            for (std::size_t i = 0; i < tau.rows(); ++i) {
+                for (std::size_t j = 0; j < tau.cols(); ++j)
+                    trails[run].push_back(std::bit_cast<std::uint64_t>(tau(i, j)));
+            }
+        }
+        BOOST_CHECK(solutions[0] == solutions[1]);
+        BOOST_CHECK(trails[0] == trails[1]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AntColonyATSPTest) {
+    // Along the circle one way is three times cheaper than the other
+    constexpr std::size_t n = 20;
+    DenseMatrix<double> d = circle(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            if (i != j && (j + n - i) % n > n / 2)
+                d(i, j) *= 3.0;
+        }
+    }
+    const double optimum = 2.0 * n * std::sin(M_PI / n);
+    AntColonyParams p;
+    p.variant = AcoVariant::MaxMinAntSystem;
+    p.seed = 2;
+    p.threads = 2;
+    AntColony<TSP> colony(TSP(std::move(d), 10), p, 10);
+    BOOST_CHECK(!colony.problem().symmetric());
+    colony.init<AntUnit<TSP>>();
+    for (int i = 0; i < 100; ++i)
+        colony.iter();
+    BOOST_CHECK_CLOSE(colony.best_cost(), optimum, 1e-6);
+    BOOST_CHECK_CLOSE(colony.problem().cost(colony.best_solution()), colony.best_cost(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(AntColonyCVRPTest) {
+    // Depot in the center of a ring of customers
+    constexpr std::size_t n = 13;
+    std::vector<double> x{0.0}, y{0.0}, demands{0.0};
+    for (std::size_t i = 1; i < n; ++i) {
+        const double angle = 2.0 * M_PI * static_cast<double>(i) / static_cast<double>(n - 1);
+        x.push_back(10.0 * std::cos(angle));
+        y.push_back(10.0 * std::sin(angle));
+        demands.push_back(static_cast<double>(1 + i % 3));
+    }
+    DenseMatrix<double> d(n, n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j)
+            d(i, j) = std::hypot(x[i] - x[j], y[i] - y[j]);
+    }
+    constexpr double capacity = 7.0;
+    AntColonyParams p;
+    p.seed = 4;
+    p.threads = 2;
+    AntColony<CVRP> colony(CVRP(std::move(d), demands, capacity, 6), p, 10);
+    colony.init<AntUnit<CVRP>>();
+    for (int i = 0; i < 30; ++i)
+        colony.iter();
+    BOOST_REQUIRE(!std::isinf(colony.best_cost()));
+    BOOST_CHECK_CLOSE(colony.problem().cost(colony.best_solution()), colony.best_cost(), 1e-9);
+    // Every customer once, no vehicle over capacity
+    const std::vector<int> &routes = colony.best_solution();
+    BOOST_CHECK_EQUAL(routes.front(), 0);
+    BOOST_CHECK_EQUAL(routes.back(), 0);
+    std::vector<int> served(n, 0);
+    double load = 0.0;
+    for (const int node : routes) {
+        if (node == 0) {
+            load = 0.0;
+            continue;
+        }
+        ++served[static_cast<std::size_t>(node)];
+        load += demands[static_cast<std::size_t>(node)];
+        BOOST_CHECK_LE(load, capacity);
+    }
+    BOOST_CHECK(std::all_of(served.begin() + 1, served.end(), [](int count) { return count == 1; }));
+}
+
+BOOST_AUTO_TEST_CASE(QAPSwapDeltaTest) {
+    constexpr std::size_t n = 7;
+    DenseMatrix<double> flows(n, n), distances(n, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            flows(i, j) = static_cast<double>((i * 7 + j * 3) % 5);
+            distances(i, j) = static_cast<double>((i * 2 + j * 5) % 7);
+        }
+    }
+    QAP qap(std::move(flows), std::move(distances));
+    std::vector<int> p{3, 0, 6, 1, 5, 2, 4};
+    for (std::size_t r = 0; r < n; ++r) {
+        for (std::size_t s = r + 1; s < n; ++s) {
+            auto swapped = p;
+            std::swap(swapped[r], swapped[s]);
+            BOOST_CHECK_SMALL(qap.cost(swapped) - qap.cost(p) - qap.swap_delta(p, r, s), 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GraphColoringTest) {
+    // Even cycle: 2 colors
+    constexpr std::uint32_t n = 12;
+    std::vector<std::vector<std::uint32_t>> adjacency(n);
+    for (std::uint32_t v = 0; v < n; ++v) {
+        adjacency[v].push_back((v + 1) % n);
+        adjacency[(v + 1) % n].push_back(v);
+    }
+    AntColonyParams p;
+    p.seed = 3;
+    AntColony<GraphColoring> colony(GraphColoring(std::move(adjacency)), p, 8);
+    colony.init<AntUnit<GraphColoring>>();
+    for (int i = 0; i < 20; ++i)
+        colony.iter();
+    BOOST_CHECK_EQUAL(colony.best_cost(), 2.0);
+}
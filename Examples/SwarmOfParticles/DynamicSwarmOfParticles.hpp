@@ -0,0 +1,253 @@
+#pragma once
+#include <algorithm>
+#include <cppSwarmLib/AlignedAllocator.hpp>
+#include <cppSwarmLib/Params.hpp>
+#include <cppSwarmLib/Random.hpp>
+#include <cppSwarmLib/Swarm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace swarm {
+    /**
+     * @brief The params of the swarm of particles whose dimension is known at run time
+     */
+    struct DynamicSOPParams : public IParams {
+        std::vector<std::pair<double, double>> Limits; // One per dimension, sets the dimension
+        double omega = 0.729;
+        double phi_p = 0.149445;
+        double phi_g = 0.149445;
+
+        std::size_t threads = 1; // Number of worker threads, 0 - one per hardware thread
+        // Runs with the same seed are bit-identical for any thread count
+        std::uint64_t seed = std::random_device{}();
+    };
+
+    /**
+     * @brief Scalar of DynamicSwarmOfParticles with float positions, velocities and best positions, and double
+     * objective values
+     */
+    struct MixedPrecision {};
+
+    /**
+     * @brief The types a scalar parameter of DynamicSwarmOfParticles stands for: State for the positions,
+     * velocities and best positions, Value for the objective and best values
+     */
+    template<class Scalar>
+    struct ParticleScalars {
+        static_assert(std::is_floating_point_v<Scalar>, "Scalar must be a floating point type or MixedPrecision");
+        using State = Scalar;
+        using Value = Scalar;
+    };
+    template<>
+    struct ParticleScalars<MixedPrecision> {
+        using State = float;
+        using Value = double;
+    };
+
+    namespace detail {
+        /**
+         * @brief Rows of one particle in the swarm's arrays
+         */
+        template<class T>
+        struct ParticleRows {
+            T *pos;
+            T *vel;
+            const T *best_pos; // personal best
+        };
+
+        /**
+         * @brief One PSO move of a particle. Dim > 0 fixes the dimension at compile time, so the loops are
+         * unrolled and vectorized; Dim = 0 is the fallback for any dimension. The random numbers are drawn
+         * first, in the same order for every Dim, so both give the same particle trajectories. All arithmetic is
+         * in T, so float state moves twice as many lanes per instruction as double.
+         */
+        template<std::size_t Dim, class T = double>
+        void move_particle(std::size_t dim, ParticleRows<T> p, const T *global_best, const std::pair<T, T> *limits,
+                           const DynamicSOPParams &params, RandomStream &rng, T *scratch) {
+            const std::size_t n = Dim ? Dim : dim;
+            const T omega = static_cast<T>(params.omega), phi_p = static_cast<T>(params.phi_p),
+                    phi_g = static_cast<T>(params.phi_g);
+            T fixed[Dim ? 2 * Dim : 1];
+            T *r = Dim ? fixed : scratch; // rp of dimension i at 2i, rg at 2i + 1
+            if constexpr (std::is_same_v<T, float>) {
+                // A float needs 24 random bits, one draw gives rp and rg
+                for (std::size_t i = 0; i < n; ++i) {
+                    const std::uint64_t bits = rng();
+                    r[2 * i] = static_cast<float>(bits >> 40) * 0x1.0p-24f;
+                    r[2 * i + 1] = static_cast<float>((bits >> 8) & 0xffffff) * 0x1.0p-24f;
+                }
+            } else {
+                for (std::size_t i = 0; i < 2 * n; ++i)
+                    r[i] = static_cast<T>(rng.rnd());
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                const T v = omega * p.vel[i] + phi_p * r[2 * i] * (p.best_pos[i] - p.pos[i]) +
+                            phi_g * r[2 * i + 1] * (global_best[i] - p.pos[i]);
+                p.vel[i] = v;
+                p.pos[i] = std::min(std::max(p.pos[i] + v, limits[i].first), limits[i].second);
+            }
+        }
+
+        template<class T>
+        using ParticleKernel = void (*)(std::size_t, ParticleRows<T>, const T *, const std::pair<T, T> *,
+                                        const DynamicSOPParams &, RandomStream &, T *);
+
+        /**
+         * @brief The kernel compiled for the dimension, move_particle<0> for the other dimensions
+         */
+        template<class T = double>
+        ParticleKernel<T> particle_kernel(std::size_t dim) {
+            switch (dim) {
+                case 2: return &move_particle<2, T>;
+                case 3: return &move_particle<3, T>;
+                case 10: return &move_particle<10, T>;
+                case 30: return &move_particle<30, T>;
+                case 50: return &move_particle<50, T>;
+                case 100: return &move_particle<100, T>;
+                default: return &move_particle<0, T>;
+            }
+        }
+    } // namespace detail
+
+    template<class Compare, class Scalar>
+    class DynamicSwarmOfParticles;
+
+    /**
+     * @brief Particle of DynamicSwarmOfParticles. Its state lives in rows of the swarm's contiguous arrays; like
+     * ParticlUnit it reads the global best of the previous step and writes only its own rows.
+     */
+    template<class Compare = std::less<double>, class Scalar = double>
+    class DynamicParticlUnit : public ISwarmUnit {
+        using State = typename ParticleScalars<Scalar>::State;
+        using Value = typename ParticleScalars<Scalar>::Value;
+        DynamicSwarmOfParticles<Compare, Scalar> &_Swarm;
+        std::size_t _Index;
+        RandomStream _Rng;
+        std::vector<State> _Scratch; // random numbers of the fallback kernel
+
+    public:
+        DynamicParticlUnit(DynamicSwarmOfParticles<Compare, Scalar> &swarm, std::size_t index) :
+            _Swarm(swarm), _Index(index), _Rng(swarm._Params.seed, index) {}
+
+        void init() override {
+            DynamicSwarmOfParticles<Compare, Scalar> &s = _Swarm;
+            State *pos = s.row(s._Pos, _Index), *vel = s.row(s._Vel, _Index);
+            const auto &limits = s._Params.Limits;
+            for (std::size_t i = 0; i < s._Dim; ++i)
+                pos[i] = static_cast<State>(_Rng.rnd(limits[i].first, limits[i].second));
+            for (std::size_t i = 0; i < s._Dim; ++i)
+                vel[i] = static_cast<State>(_Rng.rnd(limits[i].first, limits[i].second));
+            if (!s.specialized())
+                _Scratch.resize(2 * s._Dim);
+            std::copy(pos, pos + s._Dim, s.row(s._BestPos, _Index));
+            s._BestVal[_Index] = s.Func(std::span<const State>(pos, s._Dim));
+        }
+        void iter() override {
+            DynamicSwarmOfParticles<Compare, Scalar> &s = _Swarm;
+            State *pos = s.row(s._Pos, _Index);
+            const Value value = s.Func(std::span<const State>(pos, s._Dim));
+            if (s._Comp(value, s._BestVal[_Index])) {
+                s._BestVal[_Index] = value;
+                std::copy(pos, pos + s._Dim, s.row(s._BestPos, _Index));
+            }
+            s._Kernel(s._Dim, {pos, s.row(s._Vel, _Index), s.row(s._BestPos, _Index)}, s._GlobalBestPos.data(),
+                      s._Limits.data(), s._Params, _Rng, _Scratch.data());
+        }
+    };
+
+    /**
+     * @brief Particle swarm optimization with the dimension given at run time, for running problems of many sizes
+     * from one binary. The particle moves go to a kernel compiled for the dimension when there is one (2, 3, 10,
+     * 30, 50, 100) and to a generic one otherwise. Positions, velocities and personal bests are stored row by row
+     * in contiguous arrays; steps are synchronous as in SwarmOfParticles.
+     *
+     * @tparam Scalar - double, float, or MixedPrecision: float state, which halves the memory traffic of the
+     * update and doubles its SIMD width, with the objective and the best values kept in double
+     */
+    template<class Compare = std::less<double>, class Scalar = double>
+    class DynamicSwarmOfParticles
+        : public Swarm<SwarmParallelVectorContainer, DynamicSOPParams, DynamicParticlUnit<Compare, Scalar>> {
+        using _Base = Swarm<SwarmParallelVectorContainer, DynamicSOPParams, DynamicParticlUnit<Compare, Scalar>>;
+
+    public:
+        using State = typename ParticleScalars<Scalar>::State;
+        using Value = typename ParticleScalars<Scalar>::Value;
+
+    private:
+        using Array = std::vector<State, AlignedAllocator<State>>;
+
+        std::size_t _Dim;
+        detail::ParticleKernel<State> _Kernel;
+        Compare _Comp{};
+        std::vector<std::pair<State, State>> _Limits;
+        Array _Pos, _Vel, _BestPos;
+        std::vector<Value> _BestVal;
+        std::vector<State> _GlobalBestPos;
+        Value _GlobalBestVal{};
+
+        State *row(Array &a, std::size_t index) { return a.data() + index * _Dim; }
+
+    public:
+        std::function<Value(std::span<const State>)> Func;
+
+        /**
+         * @param func - function to optimize
+         * @param p - parameters, p.Limits sets the dimension
+         * @param count - number of particles
+         */
+        DynamicSwarmOfParticles(std::function<Value(std::span<const State>)> func, const DynamicSOPParams &p,
+                                std::size_t count) :
+            _Base(p, count), _Dim(p.Limits.size()), _Kernel(detail::particle_kernel<State>(_Dim)),
+            _Pos(count * _Dim), _Vel(count * _Dim), _BestPos(count * _Dim), _BestVal(count), _GlobalBestPos(_Dim),
+            Func(std::move(func)) {
+            if (_Dim == 0)
+                throw std::invalid_argument("DynamicSwarmOfParticles: no dimensions");
+            for (const auto &[low, high] : p.Limits)
+                _Limits.emplace_back(static_cast<State>(low), static_cast<State>(high));
+            _Base::_Units.set_threads(p.threads);
+            for (std::size_t i = 0; i < count; ++i)
+                _Base::_Units.add_unit(SwarmUnitLink<DynamicParticlUnit<Compare, Scalar>>(
+                        new DynamicParticlUnit<Compare, Scalar>(*this, i)));
+        }
+
+        void init() final {
+            _Base::init();
+            update_best();
+        }
+        void iter() final {
+            _Base::iter();
+            update_best();
+        }
+
+        std::size_t dim() const { return _Dim; }
+        /**
+         * @brief whether the particles move with a kernel compiled for the dimension
+         */
+        bool specialized() const { return _Kernel != &detail::move_particle<0, State>; }
+        std::span<const State> best_position() const { return _GlobalBestPos; }
+        Value best_value() const { return _GlobalBestVal; }
+
+    private:
+        /**
+         * @brief The step barrier: the best of the personal bests, the first particle wins ties
+         */
+        void update_best() {
+            if (_BestVal.empty())
+                return;
+            std::size_t best = 0;
+            for (std::size_t i = 1; i < _BestVal.size(); ++i)
+                if (_Comp(_BestVal[i], _BestVal[best]))
+                    best = i;
+            _GlobalBestVal = _BestVal[best];
+            std::copy(row(_BestPos, best), row(_BestPos, best) + _Dim, _GlobalBestPos.begin());
+        }
+        friend class DynamicParticlUnit<Compare, Scalar>;
+    };
+} // namespace swarm
@@ -1,6 +1,8 @@
 #pragma once
 #include <cppSwarmLib/Params.hpp>
 #include <cppSwarmLib/Swarm.hpp>
+#include <cstdint>
+#include <random>
 #include "StopCriteria.hpp"
 #include "SwarmOfParticles.hpp"
 #include "UnitParticl.hpp"
@@ -24,13 +26,23 @@ namespace swarm {
         double phi_p = 0.149445;
         double phi_g = 0.149445;
 
+        std::size_t threads = 1; // Number of worker threads, 0 - one per hardware thread
+        // Runs with the same seed are bit-identical for any thread count
+        std::uint64_t seed = std::random_device{}();
+        bool verbose = false; // Print every particle on init and iter, meant for single-threaded runs
+
+        // Global best, updated by the swarm at the end of every step
         std::array<double, Dim> BestPos{};
         double BestVal{};
     };
 
+    /**
+     * @brief Particle swarm optimization. Steps are synchronous: the particles move in parallel towards the global
+     * best of the previous step, which the swarm updates once all of them are done.
+     */
     template<std::size_t Dim>
-    class SwarmOfParticles : public Swarm<SwarmVectorContainer, SOPParams<Dim>, IParticlUnit<Dim>> {
-        using _Base = Swarm<SwarmVectorContainer, SOPParams<Dim>, IParticlUnit<Dim>>;
+    class SwarmOfParticles : public Swarm<SwarmParallelVectorContainer, SOPParams<Dim>, IParticlUnit<Dim>> {
+        using _Base = Swarm<SwarmParallelVectorContainer, SOPParams<Dim>, IParticlUnit<Dim>>;
         const StopCriteria<Dim> &_stop_criteria;
         bool stopped;
 
@@ -39,25 +51,49 @@ namespace swarm {
         SwarmOfParticles(std::function<double(const std::array<double, Dim> &)> func,
                          const SOPParams<Dim> &p = SOPParams<Dim>(), std::size_t sz = 0,
                          const StopCriteria<Dim> &stop_criteria = StopCriteria<Dim>()) :
-            Func(func), _stop_criteria(stop_criteria), _Base(p, sz) {}
-        void init() final { _Base::init(); }
+            _Base(p, sz), _stop_criteria(stop_criteria), Func(func) {
+            _Base::_Units.set_threads(p.threads);
+        }
+        void init() final {
+            _Base::init();
+            update_best();
+        }
 
         template<typename T>
         void init(bool create_reserve_units = true) {
             if (create_reserve_units) {
-                auto count = _Base::_Units.reserved_size() - _Base::_Units.size();
-                for (std::size_t i = 0; i < count; ++i) {
-                    _Base::_Units.add_unit(SwarmUnitLink<IParticlUnit<Dim>>(
-                            new T(_Base::_Params, Func, _Base::_Params.BestPos, _Base::_Params.BestVal)));
+                // The index of a particle selects its random stream
+                for (std::size_t i = _Base::_Units.size(); i < _Base::_Units.reserved_size(); ++i) {
+                    _Base::_Units.add_unit(SwarmUnitLink<IParticlUnit<Dim>>(new T(_Base::_Params, Func, i)));
                 }
             }
             init();
         }
         void iter() final {
             _Base::iter();
+            update_best();
             stopped = _stop_criteria(*this);
         }
         bool is_stoped() const { return stopped; }
+        const std::array<double, Dim> &best_position() const { return _Base::_Params.BestPos; }
+        double best_value() const { return _Base::_Params.BestVal; }
+
+    private:
+        /**
+         * @brief The step barrier: the best of the personal bests becomes the global best. Particles are scanned in
+         * insertion order and the first one wins ties, so the result does not depend on the number of threads.
+         */
+        void update_best() {
+            IParticlUnit<Dim> *best = nullptr;
+            _Base::_Units.for_each([&best](IParticlUnit<Dim> &u) {
+                if (!best || u.isBetter(u.getMaxVal(), best->getMaxVal()))
+                    best = &u;
+            });
+            if (best) {
+                _Base::_Params.BestPos = best->getPositionMaxVal();
+                _Base::_Params.BestVal = best->getMaxVal();
+            }
+        }
         friend struct StopCriteria<Dim>;
         friend struct FindBestCriteria<Dim>;
     };
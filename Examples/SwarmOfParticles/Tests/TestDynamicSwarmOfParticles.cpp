@@ -0,0 +1,149 @@
+#include <cppSwarmLib/SwarmOfParticles/DynamicSwarmOfParticles.hpp>
+#include <cppSwarmLib/SwarmOfParticles/SwarmOfParticles.hpp>
+#include <boost/test/unit_test.hpp>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+
+using namespace swarm;
+
+namespace {
+    double sphere(std::span<const double> x) { return std::inner_product(x.begin(), x.end(), x.begin(), 0.0); }
+
+    DynamicSOPParams params(std::size_t dim, std::uint64_t seed) {
+        DynamicSOPParams p;
+        p.Limits.assign(dim, {-10.0, 10.0});
+        p.seed = seed;
+        return p;
+    }
+
+    // The same run with the dimension fixed at compile time
+    template<std::size_t Dim>
+    std::pair<double, std::array<double, Dim>> fixed_run(std::uint64_t seed, std::size_t count, int steps) {
+        SOPParams<Dim> p;
+        p.Limits.fill({-10.0, 10.0});
+        p.seed = seed;
+        const StopCriteria<Dim> never;
+        SwarmOfParticles<Dim> sw([](const std::array<double, Dim> &x) { return sphere(x); }, p, count, never);
+        sw.template init<ParticlUnit<Dim>>(true);
+        for (int i = 0; i < steps; ++i)
+            sw.iter();
+        return {sw.best_value(), sw.best_position()};
+    }
+
+    template<std::size_t Dim>
+    void check_matches_fixed(bool specialized) {
+        DynamicSwarmOfParticles<> sw(sphere, params(Dim, 5), 30);
+        BOOST_CHECK_EQUAL(sw.dim(), Dim);
+        BOOST_CHECK_EQUAL(sw.specialized(), specialized);
+        sw.init();
+        for (int i = 0; i < 50; ++i)
+            sw.iter();
+        const auto [best, position] = fixed_run<Dim>(5, 30, 50);
+        const auto bits = [](double d) { return std::bit_cast<std::uint64_t>(d); };
+        BOOST_CHECK_EQUAL(bits(sw.best_value()), bits(best));
+        for (std::size_t i = 0; i < Dim; ++i)
+            BOOST_CHECK_EQUAL(bits(sw.best_position()[i]), bits(position[i]));
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(DynamicSwarmOfParticlesKernelTest)
+{
+    // Same random numbers and arithmetic as SwarmOfParticles<Dim>, through both kernels
+    check_matches_fixed<2>(true);
+    check_matches_fixed<10>(true);
+    check_matches_fixed<7>(false);
+    for (std::size_t dim : {3u, 30u, 50u, 100u})
+        BOOST_CHECK(DynamicSwarmOfParticles<>(sphere, params(dim, 1), 1).specialized());
+    BOOST_CHECK(!DynamicSwarmOfParticles<>(sphere, params(4, 1), 1).specialized());
+    BOOST_CHECK_THROW(DynamicSwarmOfParticles<>(sphere, params(0, 1), 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(DynamicSwarmOfParticlesTest)
+{
+    for (std::size_t dim : {3u, 10u}) {
+        DynamicSOPParams p = params(dim, 11);
+        p.threads = 3;
+        p.phi_p = p.phi_g = 1.49445; // Clerc's constriction coefficients
+        DynamicSwarmOfParticles<> sw(sphere, p, 50);
+        sw.init();
+        const double first = sw.best_value();
+        for (int i = 0; i < 300; ++i)
+            sw.iter();
+        BOOST_CHECK_LT(sw.best_value(), first / 100);
+        BOOST_CHECK_CLOSE(sphere(sw.best_position()), sw.best_value(), 1e-9);
+    }
+    // Maximizing, the optimum is on the corner of the limits
+    DynamicSwarmOfParticles<std::greater<double>> far(sphere, params(5, 3), 20);
+    far.init();
+    for (int i = 0; i < 100; ++i)
+        far.iter();
+    BOOST_CHECK_CLOSE(far.best_value(), 500.0, 1e-6);
+}
+
+namespace {
+    // Distance of the best position from the optimum of a shifted sphere (plus offset), and the best value
+    template<class Scalar>
+    std::pair<double, double> shifted_run(double offset, std::size_t threads) {
+        using Swarm = DynamicSwarmOfParticles<std::less<double>, Scalar>;
+        using State = typename Swarm::State;
+        using Value = typename Swarm::Value;
+        const auto optimum = [](std::size_t i) { return 0.1 * static_cast<double>(i) + 0.3; };
+        DynamicSOPParams p = params(10, 11);
+        p.phi_p = p.phi_g = 1.49445;
+        p.threads = threads;
+        Swarm sw(
+                [offset, optimum](std::span<const State> x) {
+                    auto value = static_cast<Value>(offset);
+                    for (std::size_t i = 0; i < x.size(); ++i) {
+                        const Value d = static_cast<Value>(x[i]) - static_cast<Value>(optimum(i));
+                        value += d * d;
+                    }
+                    return value;
+                },
+                p, 50);
+        sw.init();
+        for (int i = 0; i < 400; ++i)
+            sw.iter();
+        double distance = 0;
+        for (std::size_t i = 0; i < sw.dim(); ++i) {
+            const double d = static_cast<double>(sw.best_position()[i]) - optimum(i);
+            distance += d * d;
+        }
+        return {distance, static_cast<double>(sw.best_value())};
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(DynamicSwarmOfParticlesPrecisionTest)
+{
+    using FloatSwarm = DynamicSwarmOfParticles<std::less<double>, float>;
+    using MixedSwarm = DynamicSwarmOfParticles<std::less<double>, MixedPrecision>;
+    static_assert(std::is_same_v<FloatSwarm::Value, float>);
+    static_assert(std::is_same_v<MixedSwarm::State, float> && std::is_same_v<MixedSwarm::Value, double>);
+    BOOST_CHECK(FloatSwarm([](std::span<const float> x) { return x[0]; }, params(30, 1), 1).specialized());
+
+    // Against the double baseline: single precision positions are enough to find the optimum to ~1e-7
+    const auto [distance, value] = shifted_run<double>(0.0, 1);
+    BOOST_CHECK_LT(distance, 1e-12);
+    for (const auto &[name, run] : {std::pair{"float", shifted_run<float>(0.0, 1)},
+                                    std::pair{"mixed", shifted_run<MixedPrecision>(0.0, 1)}}) {
+        BOOST_TEST_CONTEXT(name) {
+            BOOST_CHECK_LT(run.first, 1e-10);
+            BOOST_CHECK_SMALL(run.second - value, 1e-10);
+        }
+    }
+
+    // With a large objective, float values can no longer tell the points near the optimum apart; double
+    // values can, and mixed precision converges as far as the double baseline
+    const double baseline = shifted_run<double>(1e4, 1).first;
+    const double mixed = shifted_run<MixedPrecision>(1e4, 1).first;
+    BOOST_CHECK_LT(baseline, 1e-9);
+    BOOST_CHECK_LT(mixed, 1e-9);
+    BOOST_CHECK_GT(shifted_run<float>(1e4, 1).first, 1e-6);
+
+    // Reproducible for any thread count in every precision
+    const auto bits = [](double d) { return std::bit_cast<std::uint64_t>(d); };
+    BOOST_CHECK_EQUAL(bits(shifted_run<float>(0.0, 3).first), bits(shifted_run<float>(0.0, 1).first));
+    BOOST_CHECK_EQUAL(bits(shifted_run<MixedPrecision>(1e4, 3).first), bits(mixed));
+}
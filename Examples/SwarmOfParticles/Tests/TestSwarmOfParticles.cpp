@@ -1,7 +1,53 @@
 #include <cppSwarmLib/SwarmOfParticles/SwarmOfParticles.hpp>
 #include <boost/test/unit_test.hpp>
+#include <bit>
+#include <cstdint>
+
+using namespace swarm;
+
+namespace {
+    constexpr std::size_t Dim = 3;
+
+    double sphere(const std::array<double, Dim> &x) { return x[0] * x[0] + x[1] * x[1] + x[2] * x[2]; }
+
+    struct Run {
+        double first;
+        double best;
+        std::array<double, Dim> position;
+    };
+
+    Run run(std::size_t threads, std::uint64_t seed) {
+        SOPParams<Dim> p;
+        p.Limits.fill({-10.0, 10.0});
+        p.threads = threads;
+        p.seed = seed;
+        const StopCriteria<Dim> never;
+        SwarmOfParticles<Dim> sw(sphere, p, 40, never);
+        sw.init<ParticlUnit<Dim>>(true);
+        const double first = sw.best_value();
+        for (int i = 0; i < 100; ++i)
+            sw.iter();
+        return {first, sw.best_value(), sw.best_position()};
+    }
+} // namespace
 
 BOOST_AUTO_TEST_CASE(SwarmOfParticlesTest)
 {
+    const Run serial = run(1, 17);
+    BOOST_CHECK_LT(serial.best, serial.first);
+    BOOST_CHECK_LT(serial.best, 1e-2);
+    BOOST_CHECK_CLOSE(sphere(serial.position), serial.best, 1e-9);
+}
 
-}
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(SwarmOfParticlesDeterminismTest)
+{
+    const auto bits = [](double d) { return std::bit_cast<std::uint64_t>(d); };
+    const Run serial = run(1, 17);
+    for (const std::size_t threads : {std::size_t{2}, std::size_t{3}}) {
+        const Run parallel = run(threads, 17);
+        BOOST_CHECK_EQUAL(bits(parallel.best), bits(serial.best));
+        for (std::size_t i = 0; i < Dim; ++i)
+            BOOST_CHECK_EQUAL(bits(parallel.position[i]), bits(serial.position[i]));
+    }
+    BOOST_CHECK_NE(bits(run(1, 18).best), bits(serial.best));
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <array>
 #include <cppSwarmLib/Params.hpp>
+#include <cppSwarmLib/Random.hpp>
 #include <cppSwarmLib/SwarmOfParticles/SwarmOfParticles.hpp>
 #include <cppSwarmLib/SwarmUnit.hpp>
 #include <cppSwarmLib/UnitComponent/IExecutorC.hpp>
@@ -21,6 +22,10 @@ namespace swarm {
         virtual double getCurValue() = 0;
         virtual const std::array<double, Dim> &getPositionMaxVal() = 0;
         virtual double getMaxVal() = 0;
+        /**
+         * @brief whether value a is better than b for the particle
+         */
+        virtual bool isBetter(double a, double b) const = 0;
     };
     template<typename UT>
     class ParticlExecutor : public IExecutorUnitC<EmptyParams, UT> {
@@ -30,21 +35,22 @@ namespace swarm {
         ParticlExecutor(UT *u) : IExecutorUnitC<EmptyParams, UT>(u) {}
     };
 
-    template<std::size_t Dim>
-    class ParticlExecutor<ParticlUnit<Dim>> : public IExecutorUnitC<EmptyParams, ParticlUnit<Dim>> {
+    template<std::size_t Dim, class Compare>
+    class ParticlExecutor<ParticlUnit<Dim, Compare>> : public IExecutorUnitC<EmptyParams, ParticlUnit<Dim, Compare>> {
+        using UnitT = ParticlUnit<Dim, Compare>;
 
-        inline double rnd(double min, double max) const { return SwarmStaticRandom::rnd(min, max); }
+        inline double rnd(double min, double max) const { return this->_U->_Rng.rnd(min, max); }
 
     public:
         void _setRandomPosition() {
-            for (auto i = 0; i < Dim; ++i) {
-                ParticlUnit<Dim> &u = *this->_U;
+            for (std::size_t i = 0; i < Dim; ++i) {
+                UnitT &u = *this->_U;
                 u._Cur_pos[i] = rnd(u._params->Limits[i].first, u._params->Limits[i].second);
             }
         }
         void _setRandomVel() {
-            for (auto i = 0; i < Dim; ++i) {
-                ParticlUnit<Dim> &u = *this->_U;
+            for (std::size_t i = 0; i < Dim; ++i) {
+                UnitT &u = *this->_U;
                 u._Vel[i] = rnd(u._params->Limits[i].first, u._params->Limits[i].second);
             }
         }
@@ -54,13 +60,18 @@ namespace swarm {
             _setRandomVel();
         }
         void iter() override {}
-        ParticlExecutor(ParticlUnit<Dim> *u) : IExecutorUnitC<EmptyParams, ParticlUnit<Dim>>(u) {}
-        friend ParticlUnit<Dim>;
+        ParticlExecutor(UnitT *u) : IExecutorUnitC<EmptyParams, UnitT>(u) {}
+        friend UnitT;
     };
 
+    /**
+     * @brief Particle of SwarmOfParticles. Reads the global best of the previous step from the params and updates
+     * only its own state, the swarm reduces the personal bests at the end of the step. With its own random stream
+     * the particle moves the same way whatever thread runs it.
+     */
     template<std::size_t Dim, class Compare>
-    class ParticlUnit : public BasicSwarmUnit<ParticlUnit<Dim>, LinkToGlobalParams<SOPParams<Dim>>, EmptyTaskManagerC,
-                                              EmptyCommunicationC, ParticlExecutor>,
+    class ParticlUnit : public BasicSwarmUnit<ParticlUnit<Dim, Compare>, LinkToGlobalParams<SOPParams<Dim>>,
+                                              EmptyTaskManagerC, EmptyCommunicationC, ParticlExecutor>,
                         public virtual IParticlUnit<Dim> {
 #define prms _Base::_params
         std::array<double, Dim> _Cur_pos{};
@@ -71,31 +82,38 @@ namespace swarm {
         std::array<double, Dim> _PositionMaxVal{};
 
         Compare _Comp{};
-        std::array<double, Dim> &BestPos;
-        double &BestVal;
+        RandomStream _Rng;
 
     public:
-        using _Base = BasicSwarmUnit<ParticlUnit<Dim>, LinkToGlobalParams<SOPParams<Dim>>, EmptyTaskManagerC,
+        using _Base = BasicSwarmUnit<ParticlUnit<Dim, Compare>, LinkToGlobalParams<SOPParams<Dim>>, EmptyTaskManagerC,
                                      EmptyCommunicationC, ParticlExecutor>;
+        /**
+         * @param p - parameters of the swarm, holding the global best
+         * @param func - function to optimize
+         * @param index - selects the random stream of the particle together with p.seed
+         */
         ParticlUnit(const SOPParams<Dim> &p, std::function<double(const std::array<double, Dim> &)> func,
-                    std::array<double, Dim> &BestPos, double &BestVal) :
-            _Func(func), BestPos(BestPos), BestVal(BestVal),
-            BasicSwarmUnit<ParticlUnit<Dim>, LinkToGlobalParams<SOPParams<Dim>>, EmptyTaskManagerC, EmptyCommunicationC,
-                           ParticlExecutor>(LinkToGlobalParams<SOPParams<Dim>>(p)) {}
+                    std::size_t index = 0) :
+            _Base(LinkToGlobalParams<SOPParams<Dim>>(p)), _Func(func), _Rng(p.seed, index) {}
 
         const std::array<double, Dim> &getPosition() override { return _Cur_pos; }
         double getCurValue() override { return _Func(_Cur_pos); }
         const std::array<double, Dim> &getPositionMaxVal() override { return _PositionMaxVal; }
         double getMaxVal() override { return _MaxVal; }
+        bool isBetter(double a, double b) const override { return _Comp(a, b); }
 
         void init() override { /*  random spawn*/
             _Base::init();
-            log("init");
+            _MaxVal = _Func(_Cur_pos);
+            _PositionMaxVal = _Cur_pos;
+            if (prms->verbose)
+                log("init");
         }
         void iter() override {
             update_max(_Func(_Cur_pos));
             update_pos();
-            log("iter");
+            if (prms->verbose)
+                log("iter");
         }
 
     private:
@@ -104,36 +122,32 @@ namespace swarm {
                 _PositionMaxVal = _Cur_pos;
                 _MaxVal = curx;
             }
-            if (_Comp(curx, BestVal)) {
-                BestPos = _Cur_pos;
-                BestVal = _MaxVal;
-            }
         }
         void update_pos() {
             std::array<double, Dim> rp;
             std::array<double, Dim> rg;
-            for (auto i = 0; i < Dim; ++i) {
+            for (std::size_t i = 0; i < Dim; ++i) {
                 rp[i] = rnd();
                 rg[i] = rnd();
             }
             _Vel = prms->omega * _Vel + (prms->phi_p * rp * (_PositionMaxVal - _Cur_pos)) +
-                   (prms->phi_g * rg * (BestPos - _Cur_pos));
+                   (prms->phi_g * rg * (prms->BestPos - _Cur_pos));
             _Cur_pos = clamp(_Cur_pos + _Vel, prms->Limits);
         }
-        inline double rnd(double min = 0, double max = 1) const { return SwarmStaticRandom::rnd(min, max); }
+        inline double rnd(double min = 0, double max = 1) { return _Rng.rnd(min, max); }
         void log(const std::string &mes) const {
             std::cout << mes << " :";
             std::cout.precision(3);
-            for (auto i = 0; i < Dim; ++i) {
+            for (std::size_t i = 0; i < Dim; ++i) {
                 std::cout << " : " << std::setw(8) << _Cur_pos[i];
             }
             std::cout << " -> " << _Func(_Cur_pos) << "\t( " << _MaxVal << " )\t";
-            for (auto i = 0; i < Dim; ++i) {
+            for (std::size_t i = 0; i < Dim; ++i) {
                 std::cout << " : " << std::setw(8) << _Vel[i];
             }
             std::cout << std::endl;
         }
-        friend class ParticlExecutor<ParticlUnit<Dim>>;
+        friend class ParticlExecutor<ParticlUnit<Dim, Compare>>;
     };
 
 } // namespace swarm
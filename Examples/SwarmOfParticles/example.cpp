@@ -11,6 +11,7 @@ int main() {
     auto p = swarm::SOPParams<Dim>();
     p.Limits[0] = {-100.0, 100.0};
     p.Limits[1] = {-100.0, 100.0};
+    p.verbose = true;
 
     auto f = [](const std::array<double, Dim> &a) { return std::sin(a[0]) + std::cos(a[1]); };
     swarm::SwarmOfParticles<Dim> sw(f, p, 25, swarm::FindBestCriteria<Dim>(2));
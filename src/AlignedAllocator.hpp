@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+namespace swarm {
+/**
+ * @brief Size of the cache line the library aligns its flat buffers to
+ */
+static constexpr std::size_t CacheLineSize = 64;
+
+/**
+ * @brief Allocator returning storage aligned to Alignment bytes. Used by the
+ * flat numeric buffers so every buffer starts on a cache line boundary.
+ *
+ * @tparam T
+ * @tparam Alignment - power of two, >= alignof(T)
+ */
+template <class T, std::size_t Alignment = CacheLineSize>
+struct AlignedAllocator {
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+  static_assert(Alignment >= alignof(T), "Alignment must be >= alignof(T)");
+
+  using value_type = T;
+  template <class U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() noexcept = default;
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_array_new_length();
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T *p, std::size_t) noexcept {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+
+  template <class U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return true;
+  }
+};
+
+/**
+ * @brief std::vector whose storage starts on a cache line boundary
+ */
+template <class T> using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+} // namespace swarm
@@ -0,0 +1,182 @@
+#pragma once
+#include "Parallel.hpp"
+#include "SwarmService.hpp"
+#include "Tasks/ITask.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+namespace swarm {
+template <class SwarmUnitT> class BatchedExecutorC;
+
+/**
+ * @brief Executes the current level 0 tasks of all units at the end of each
+ * step, in batches by task type. A kernel registered for a task type TaskT is
+ * an object with
+ *
+ *   using Batch = ...;  // struct of arrays with resize(n)
+ *   void gather(const TaskT &, Batch &, std::size_t i);
+ *   void run(Batch &, std::size_t begin, std::size_t end);
+ *   bool scatter(TaskT &, const Batch &, std::size_t i); // true if done
+ *
+ * gather copies the inputs of a task (and of its unit) into row i, run is
+ * the loop over rows the compiler can vectorize, scatter writes row i back.
+ * Finished tasks are removed through their unit's task manager.
+ *
+ * Units hand their tasks over through BatchedExecutorC. Attach the executor
+ * to the swarm; with a pool the batches are processed in parallel blocks, so
+ * kernels must only touch the task, the unit and the row they are given.
+ */
+template <class SwarmUnitT> class BatchExecutor : public ISwarmService {
+public:
+  using Task = IBaseTask<SwarmUnitT>;
+  static constexpr std::uint32_t NoKernel = ~std::uint32_t(0);
+  /**
+   * @brief What a unit hands over for the step
+   */
+  struct Submission {
+    std::uint32_t kernel = NoKernel;
+    Task *task = nullptr;
+    BatchedExecutorC<SwarmUnitT> *owner = nullptr; // nullptr - free slot
+  };
+
+private:
+  struct IKernel {
+    virtual ~IKernel() = default;
+    virtual void execute(std::span<Task *const> tasks, std::vector<char> &done,
+                         ThreadPool *pool) = 0;
+  };
+  template <class TaskT, class KernelT> struct Kernel : IKernel {
+    KernelT kernel;
+    typename KernelT::Batch batch;
+    explicit Kernel(KernelT k) : kernel(std::move(k)) {}
+    void execute(std::span<Task *const> tasks, std::vector<char> &done,
+                 ThreadPool *pool) override {
+      batch.resize(tasks.size());
+      auto block = [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i)
+          kernel.gather(static_cast<const TaskT &>(*tasks[i]), batch, i);
+        kernel.run(batch, begin, end);
+        for (std::size_t i = begin; i < end; ++i)
+          done[i] = kernel.scatter(static_cast<TaskT &>(*tasks[i]), batch, i);
+      };
+      if (pool)
+        pool->parallel_for(tasks.size(), block);
+      else if (!tasks.empty())
+        block(0, tasks.size(), 0);
+    }
+  };
+  std::vector<std::unique_ptr<IKernel>> _kernels;
+  std::unordered_map<std::type_index, std::uint32_t> _kernelOf;
+  std::deque<Submission> _sources; // stable addresses
+  std::vector<Submission *> _freeSources;
+  ThreadPool *_pool;
+  std::vector<std::vector<Task *>> _batches; // by kernel
+  std::vector<char> _done;
+  std::size_t _executed = 0;
+
+public:
+  /**
+   * @param pool - runs the batches, e.g. the pool of the swarm's container;
+   * nullptr - the calling thread
+   */
+  explicit BatchExecutor(ThreadPool *pool = nullptr) : _pool(pool) {}
+  BatchExecutor(const BatchExecutor &) = delete;
+  BatchExecutor &operator=(const BatchExecutor &) = delete;
+  ~BatchExecutor() {
+    // Executors of units that outlive the batch must not touch it
+    for (Submission &s : _sources)
+      if (s.owner)
+        s.owner->detach();
+  }
+  void set_pool(ThreadPool *pool) { _pool = pool; }
+
+  /**
+   * @brief Register the kernel of level 0 tasks of type TaskT, before the
+   * swarm runs
+   */
+  template <class TaskT, class KernelT> void add_kernel(KernelT kernel) {
+    static_assert(std::is_base_of<Task, TaskT>::value,
+                  "TaskT must be derived from IBaseTask");
+    static_assert(TaskT::Level == 0, "only level 0 tasks are executed");
+    const auto id = static_cast<std::uint32_t>(_kernels.size());
+    _kernels.push_back(std::make_unique<Kernel<TaskT, KernelT>>(std::move(kernel)));
+    _kernelOf[typeid(TaskT)] = id;
+    _batches.resize(_kernels.size());
+  }
+  /**
+   * @brief Kernel of the task's type, NoKernel if there is none
+   */
+  std::uint32_t kernel_of(const Task &task) const {
+    const auto it = _kernelOf.find(typeid(task));
+    return it == _kernelOf.end() ? NoKernel : it->second;
+  }
+
+  /**
+   * @brief A slot for the executor of a unit to submit its task in; the task
+   * is taken at the end of every step, in slot order, and the slot cleared.
+   * Slots of disconnected executors are reused, so despawned units leave
+   * nothing behind.
+   */
+  Submission &connect(BatchedExecutorC<SwarmUnitT> &owner) {
+    Submission *s;
+    if (_freeSources.empty()) {
+      s = &_sources.emplace_back();
+    } else {
+      s = _freeSources.back();
+      _freeSources.pop_back();
+    }
+    s->owner = &owner;
+    return *s;
+  }
+  /**
+   * @brief Give the slot back, between steps
+   */
+  void disconnect(Submission &s) {
+    s = Submission();
+    _freeSources.push_back(&s);
+  }
+  /**
+   * @brief number of connected executors
+   */
+  std::size_t connected() const { return _sources.size() - _freeSources.size(); }
+
+  /**
+   * @brief Tasks executed by the last end_step()
+   */
+  std::size_t executed() const { return _executed; }
+
+  void end_step() override {
+    for (auto &batch : _batches)
+      batch.clear();
+    for (Submission &s : _sources)
+      if (s.task) {
+        _batches[s.kernel].push_back(s.task);
+        s.task = nullptr;
+      }
+    _executed = 0;
+    for (std::size_t k = 0; k < _kernels.size(); ++k) {
+      const auto &tasks = _batches[k];
+      _done.assign(tasks.size(), 0);
+      _kernels[k]->execute(tasks, _done, _pool);
+      auto finish = [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i)
+          if (_done[i])
+            tasks[i]->unit()->task_manager().finish_current_task();
+      };
+      if (_pool)
+        _pool->parallel_for(tasks.size(), finish);
+      else
+        finish(0, tasks.size(), 0);
+      _executed += tasks.size();
+    }
+  }
+};
+} // namespace swarm
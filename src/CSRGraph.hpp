@@ -0,0 +1,228 @@
+#pragma once
+#include "SpatialIndex.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+namespace swarm {
+namespace detail {
+// Found by ADL; CSRGraph's own num_vertices() would hide it inside the class
+template <class G> std::size_t boost_num_vertices(const G &g) {
+  return static_cast<std::size_t>(num_vertices(g));
+}
+} // namespace detail
+
+/**
+ * @brief Directed graph in compressed sparse row form. The out-edges of vertex
+ * u are targets[offsets[u] .. offsets[u + 1]), sorted by target, with their
+ * weights in a parallel array, so walking the neighbors of a vertex is one
+ * sequential read. Costs 8 bytes per vertex and 4 + sizeof(WeightT) per edge.
+ *
+ * @tparam WeightT - edge weight type
+ */
+template <class WeightT = double> class CSRGraph {
+public:
+  using VertexId = std::uint32_t;
+  struct Edge {
+    VertexId source;
+    VertexId target;
+    WeightT weight;
+  };
+  /**
+   * @brief weight() of a missing edge
+   */
+  static constexpr WeightT NoEdge =
+      std::numeric_limits<WeightT>::has_infinity
+          ? std::numeric_limits<WeightT>::infinity()
+          : std::numeric_limits<WeightT>::max();
+
+private:
+  std::vector<std::size_t> _offsets{0};
+  std::vector<VertexId> _targets;
+  std::vector<WeightT> _weights;
+
+public:
+  CSRGraph() = default;
+  /**
+   * @brief Build from an edge list. Parallel edges are merged keeping the
+   * smallest weight.
+   *
+   * @param vertices - number of vertices, every endpoint must be below it
+   */
+  CSRGraph(std::size_t vertices, const std::vector<Edge> &edges)
+      : _offsets(vertices + 1, 0) {
+    for (const auto &e : edges) {
+      if (e.source >= vertices || e.target >= vertices)
+        throw std::out_of_range("CSRGraph: edge endpoint out of range");
+      ++_offsets[e.source + 1];
+    }
+    for (std::size_t u = 0; u < vertices; ++u)
+      _offsets[u + 1] += _offsets[u];
+    _targets.resize(edges.size());
+    _weights.resize(edges.size());
+    std::vector<std::size_t> fill(_offsets.begin(), _offsets.end() - 1);
+    for (const auto &e : edges) {
+      const std::size_t slot = fill[e.source]++;
+      _targets[slot] = e.target;
+      _weights[slot] = e.weight;
+    }
+    finish_rows();
+  }
+
+  /**
+   * @brief Convert a Boost graph in two passes over its out-edges, without an
+   * intermediate edge list
+   *
+   * @param g - graph with vertex indices 0 .. num_vertices(g) - 1 (vecS)
+   * @param weights - edge weight property map, e.g. get(boost::edge_weight, g)
+   */
+  template <class BoostGraph, class WeightMap>
+  static CSRGraph from_boost(const BoostGraph &g, const WeightMap &weights) {
+    CSRGraph graph;
+    const std::size_t n = detail::boost_num_vertices(g);
+    graph._offsets.assign(n + 1, 0);
+    for (std::size_t u = 0; u < n; ++u) {
+      const auto [begin, end] = out_edges(u, g);
+      const auto degree = static_cast<std::size_t>(std::distance(begin, end));
+      graph._offsets[u + 1] = graph._offsets[u] + degree;
+    }
+    graph._targets.resize(graph._offsets[n]);
+    graph._weights.resize(graph._offsets[n]);
+    for (std::size_t u = 0; u < n; ++u) {
+      std::size_t slot = graph._offsets[u];
+      const auto [begin, end] = out_edges(u, g);
+      for (auto it = begin; it != end; ++it, ++slot) {
+        graph._targets[slot] = static_cast<VertexId>(target(*it, g));
+        graph._weights[slot] = static_cast<WeightT>(get(weights, *it));
+      }
+    }
+    graph.finish_rows();
+    return graph;
+  }
+
+  std::size_t num_vertices() const { return _offsets.size() - 1; }
+  std::size_t num_edges() const { return _targets.size(); }
+  std::size_t degree(std::size_t u) const {
+    return _offsets[u + 1] - _offsets[u];
+  }
+  /**
+   * @brief targets of the out-edges of u, ascending
+   */
+  std::span<const VertexId> neighbors(std::size_t u) const {
+    return {_targets.data() + _offsets[u], degree(u)};
+  }
+  /**
+   * @brief weights of the out-edges of u, parallel to neighbors(u)
+   */
+  std::span<const WeightT> weights(std::size_t u) const {
+    return {_weights.data() + _offsets[u], degree(u)};
+  }
+  /**
+   * @brief weight of edge (u, v), NoEdge if there is none. O(log degree(u)).
+   */
+  WeightT weight(std::size_t u, std::size_t v) const {
+    const auto row = neighbors(u);
+    const auto it = std::lower_bound(row.begin(), row.end(), v);
+    if (it == row.end() || *it != v)
+      return NoEdge;
+    return _weights[_offsets[u] + static_cast<std::size_t>(it - row.begin())];
+  }
+  bool has_edge(std::size_t u, std::size_t v) const {
+    const auto row = neighbors(u);
+    return std::binary_search(row.begin(), row.end(), v);
+  }
+
+  const std::vector<std::size_t> &offsets() const { return _offsets; }
+  const std::vector<VertexId> &targets() const { return _targets; }
+  const std::vector<WeightT> &edge_weights() const { return _weights; }
+  /**
+   * @brief bytes held by the three arrays
+   */
+  std::size_t memory_bytes() const {
+    return _offsets.capacity() * sizeof(std::size_t) +
+           _targets.capacity() * sizeof(VertexId) +
+           _weights.capacity() * sizeof(WeightT);
+  }
+
+private:
+  /**
+   * @brief Sort every row by target and merge parallel edges, compacting the
+   * arrays in place
+   */
+  void finish_rows() {
+    std::vector<std::pair<VertexId, WeightT>> row;
+    std::size_t out = 0;
+    for (std::size_t u = 0; u + 1 < _offsets.size(); ++u) {
+      row.clear();
+      for (std::size_t e = _offsets[u]; e < _offsets[u + 1]; ++e)
+        row.emplace_back(_targets[e], _weights[e]);
+      std::sort(row.begin(), row.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first || (a.first == b.first && a.second < b.second);
+      });
+      _offsets[u] = out;
+      for (std::size_t k = 0; k < row.size(); ++k) {
+        if (k > 0 && row[k].first == row[k - 1].first)
+          continue;
+        _targets[out] = row[k].first;
+        _weights[out] = row[k].second;
+        ++out;
+      }
+    }
+    _offsets.back() = out;
+    _targets.resize(out);
+    _weights.resize(out);
+    _targets.shrink_to_fit();
+    _weights.shrink_to_fit();
+  }
+};
+
+/**
+ * @brief Graph that connects every point to its k nearest other points (by
+ * Euclidean distance), found with UniformGrid<2>::k_nearest, in O(n k)
+ * expected time for evenly spread points. Edges are weighted with
+ * distance(i, j), which must not be smaller than the Euclidean distance scaled
+ * by a constant (rounded variants such as TSPLIB EUC_2D are fine).
+ *
+ * @param symmetric - also add (j, i) for every edge (i, j)
+ */
+template <class WeightT = double, class DistanceF>
+CSRGraph<WeightT> k_nearest_graph(const std::vector<double> &x,
+                                  const std::vector<double> &y, std::size_t k,
+                                  DistanceF &&distance, bool symmetric = true) {
+  using Edge = typename CSRGraph<WeightT>::Edge;
+  using VertexId = typename CSRGraph<WeightT>::VertexId;
+  const std::size_t n = x.size();
+  k = std::min(k, n > 0 ? n - 1 : 0);
+  std::vector<Edge> edges;
+  if (k == 0)
+    return CSRGraph<WeightT>(n, edges);
+  edges.reserve(n * k * (symmetric ? 2 : 1));
+
+  std::vector<SpatialPoint<2>> points(n);
+  for (std::size_t i = 0; i < n; ++i)
+    points[i] = {x[i], y[i]};
+  UniformGrid<2> grid;
+  grid.build(points);
+  std::vector<std::pair<double, VertexId>> nearest;
+  for (std::size_t i = 0; i < n; ++i) {
+    // The point itself is among the k + 1 nearest, unless duplicates of it
+    // push it out; then the last one is dropped
+    grid.k_nearest(points[i], k + 1, nearest);
+    std::size_t taken = 0;
+    for (const auto &[squared, j] : nearest) {
+      if (j == i || taken == k)
+        continue;
+      ++taken;
+      const auto weight = static_cast<WeightT>(distance(i, j));
+      edges.push_back({static_cast<VertexId>(i), j, weight});
+      if (symmetric)
+        edges.push_back({j, static_cast<VertexId>(i), weight});
+    }
+  }
+  return CSRGraph<WeightT>(n, edges);
+}
+} // namespace swarm
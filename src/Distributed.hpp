@@ -0,0 +1,545 @@
+#pragma once
+#include "AlignedAllocator.hpp"
+#include "SwarmService.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Channels between the ranks (processes) of a partitioned swarm. Every
+ * ordered pair of ranks has its own FIFO channel of byte messages. send()
+ * never blocks: what does not fit into the channel is kept by the sender and
+ * pushed on while it waits in receive(), flush() or barrier().
+ */
+class ITransport {
+public:
+  static constexpr std::chrono::milliseconds Forever = std::chrono::milliseconds::max();
+
+  virtual ~ITransport() = default;
+  virtual std::size_t rank() const = 0;
+  virtual std::size_t ranks() const = 0;
+  virtual void send(std::size_t to, std::span<const std::byte> message) = 0;
+  /**
+   * @brief The next message from `from`, into `out`
+   *
+   * @return false if none started arriving within `timeout`
+   * @throw std::runtime_error if `from` is gone (died or closed its side)
+   * before sending, or a message stops arriving halfway
+   */
+  virtual bool receive(std::size_t from, std::vector<std::byte> &out,
+                       std::chrono::milliseconds timeout = Forever) = 0;
+  /**
+   * @brief Wait until everything sent has entered the channels
+   *
+   * @throw std::runtime_error if a receiver is gone before taking it
+   */
+  virtual void flush() = 0;
+  /**
+   * @brief Wait for all ranks. Every message sent before the barrier must
+   * have been received, as the barrier uses the same channels.
+   */
+  virtual void barrier() {
+    std::vector<std::byte> token;
+    if (rank() == 0) {
+      for (std::size_t r = 1; r < ranks(); ++r)
+        receive(r, token);
+      for (std::size_t r = 1; r < ranks(); ++r)
+        send(r, {});
+    } else {
+      send(0, {});
+      receive(0, token);
+    }
+    flush();
+  }
+};
+
+/**
+ * @brief Send trivially copyable values as one message
+ */
+template <class T> void send_values(ITransport &t, std::size_t to, std::span<const T> values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  t.send(to, std::as_bytes(values));
+}
+/**
+ * @brief Receive a message sent by send_values<T>
+ */
+template <class T> std::vector<T> receive_values(ITransport &t, std::size_t from) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  std::vector<std::byte> bytes;
+  t.receive(from, bytes);
+  if (bytes.size() % sizeof(T) != 0)
+    throw std::runtime_error("message of " + std::to_string(bytes.size()) +
+                             " bytes is not an array of the expected type");
+  std::vector<T> values(bytes.size() / sizeof(T));
+  if (!bytes.empty())
+    std::memcpy(values.data(), bytes.data(), bytes.size());
+  return values;
+}
+
+/**
+ * @brief op over the values of all ranks, the same result on every rank. The
+ * values are combined in rank order on rank 0, so the result does not depend
+ * on timing.
+ */
+template <class T, class Op> T allreduce(ITransport &t, const T &value, Op op) {
+  if (t.ranks() == 1)
+    return value;
+  T result = value;
+  if (t.rank() == 0) {
+    for (std::size_t r = 1; r < t.ranks(); ++r)
+      result = op(result, receive_values<T>(t, r).at(0));
+    for (std::size_t r = 1; r < t.ranks(); ++r)
+      send_values<T>(t, r, std::span<const T>(&result, 1));
+  } else {
+    send_values<T>(t, 0, std::span<const T>(&value, 1));
+    result = receive_values<T>(t, 0).at(0);
+  }
+  t.flush();
+  return result;
+}
+
+/**
+ * @brief ITransport between processes of one machine over a POSIX shared
+ * memory object holding a lock-free single-producer single-consumer byte
+ * ring for every ordered pair of ranks. Messages are streamed through the
+ * ring, so they may be larger than it.
+ *
+ * Rank 0 (or a launcher) create()s the object, the other ranks open() it by
+ * name, e.g. after fork() or in processes started separately. The creator
+ * unlinks the name when it is destroyed; mappings already open stay valid.
+ *
+ * Every rank records its pid in the object. A rank waiting for a peer that
+ * has exited, been killed or destroyed its transport throws instead of
+ * waiting forever; a peer that dies before opening the object is not noticed.
+ */
+class SharedMemoryTransport : public ITransport {
+  static constexpr std::uint64_t Magic = 0x63537761726d5348; // "cSwarmSH"
+  static constexpr std::int64_t Detached = -1;                // pid of a closed rank
+  struct Header {
+    std::atomic<std::uint64_t> magic;
+    std::uint64_t ranks;
+    std::uint64_t capacity;
+    // followed by the pid of every rank, 0 until it attaches
+  };
+  struct Ring {
+    alignas(CacheLineSize) std::atomic<std::uint64_t> head; // consumer
+    alignas(CacheLineSize) std::atomic<std::uint64_t> tail; // producer
+  };
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                    std::atomic<std::int64_t>::is_always_lock_free,
+                "shared memory atomics must be lock-free");
+
+  std::string _name;
+  bool _owner = false;
+  void *_base = nullptr;
+  std::size_t _bytes = 0;
+  std::size_t _rank = 0;
+  std::size_t _ranks = 0;
+  std::size_t _capacity = 0;
+  std::vector<std::vector<std::byte>> _pending; // by receiver
+  std::vector<std::size_t> _sent;               // of _pending, by receiver
+
+  SharedMemoryTransport() = default;
+
+public:
+  /**
+   * @brief Create the shared memory object `name` ("/something") for `ranks`
+   * ranks and open it as rank 0
+   *
+   * @param capacity - bytes of each ring, rounded up to a power of two
+   * @throw std::system_error if the object exists or cannot be mapped
+   */
+  static std::unique_ptr<SharedMemoryTransport> create(const std::string &name, std::size_t ranks,
+                                                       std::size_t capacity = 1 << 20) {
+    std::size_t size = CacheLineSize;
+    while (size < capacity)
+      size *= 2;
+    const std::size_t bytes = layout_bytes(ranks, size);
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), name);
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      const int error = errno;
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      throw std::system_error(error, std::generic_category(), name);
+    }
+    std::unique_ptr<SharedMemoryTransport> t(new SharedMemoryTransport());
+    t->_name = name;
+    t->_owner = true;
+    t->map(fd, bytes);
+    auto *header = new (t->_base) Header{{0}, ranks, size};
+    for (std::size_t r = 0; r < ranks; ++r)
+      new (&t->pid(r)) std::atomic<std::int64_t>(0);
+    for (std::size_t i = 0; i < ranks * ranks; ++i)
+      new (t->ring(i)) Ring{{0}, {0}};
+    header->magic.store(Magic, std::memory_order_release);
+    t->attach(0);
+    return t;
+  }
+  /**
+   * @brief Open the object made by create() as `rank`
+   *
+   * @throw std::system_error if it does not exist, std::invalid_argument if it
+   * is not a transport or has no such rank
+   */
+  static std::unique_ptr<SharedMemoryTransport> open(const std::string &name, std::size_t rank) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), name);
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), name);
+    }
+    std::unique_ptr<SharedMemoryTransport> t(new SharedMemoryTransport());
+    t->_name = name;
+    t->map(fd, static_cast<std::size_t>(info.st_size));
+    if (t->_bytes < sizeof(Header) ||
+        t->header().magic.load(std::memory_order_acquire) != Magic)
+      throw std::invalid_argument(name + " is not a shared memory transport");
+    if (rank >= t->header().ranks)
+      throw std::invalid_argument("no rank " + std::to_string(rank) + " in " + name);
+    t->attach(rank);
+    return t;
+  }
+  SharedMemoryTransport(const SharedMemoryTransport &) = delete;
+  SharedMemoryTransport &operator=(const SharedMemoryTransport &) = delete;
+  ~SharedMemoryTransport() override {
+    if (!_pending.empty()) // attached
+      pid(_rank).store(Detached, std::memory_order_release);
+    if (_base)
+      ::munmap(_base, _bytes);
+    if (_owner)
+      ::shm_unlink(_name.c_str());
+  }
+
+  std::size_t rank() const override { return _rank; }
+  std::size_t ranks() const override { return _ranks; }
+
+  void send(std::size_t to, std::span<const std::byte> message) override {
+    const std::uint64_t size = message.size();
+    auto &pending = _pending[to];
+    if (pending.empty()) {
+      // Straight into the ring, keeping what does not fit
+      const std::size_t head = write(to, std::as_bytes(std::span<const std::uint64_t>(&size, 1)));
+      if (head == sizeof(size)) {
+        const std::size_t body = write(to, message);
+        pending.insert(pending.end(), message.begin() + static_cast<std::ptrdiff_t>(body),
+                       message.end());
+        return;
+      }
+      const auto *bytes = reinterpret_cast<const std::byte *>(&size);
+      pending.insert(pending.end(), bytes + head, bytes + sizeof(size));
+    } else {
+      const auto *bytes = reinterpret_cast<const std::byte *>(&size);
+      pending.insert(pending.end(), bytes, bytes + sizeof(size));
+    }
+    pending.insert(pending.end(), message.begin(), message.end());
+  }
+
+  bool receive(std::size_t from, std::vector<std::byte> &out,
+               std::chrono::milliseconds timeout = Forever) override {
+    std::uint64_t size = 0;
+    auto *bytes = reinterpret_cast<std::byte *>(&size);
+    const std::size_t got = read(from, std::span<std::byte>(bytes, sizeof(size)), timeout);
+    if (got == 0)
+      return false;
+    if (got < sizeof(size) ||
+        read(from, std::span<std::byte>(bytes + got, sizeof(size) - got), timeout) !=
+            sizeof(size) - got)
+      throw std::runtime_error("message from rank " + std::to_string(from) + " cut off");
+    out.resize(size);
+    if (read(from, out, timeout) != size)
+      throw std::runtime_error("message from rank " + std::to_string(from) + " cut off");
+    return true;
+  }
+
+  void flush() override {
+    Backoff backoff;
+    while (!progress()) {
+      if (backoff.idle())
+        for (std::size_t to = 0; to < _ranks; ++to)
+          if (!_pending[to].empty() && gone(to))
+            throw_gone(to);
+      backoff.wait();
+    }
+  }
+
+private:
+  struct Backoff {
+    unsigned spins = 0;
+    void wait() {
+      if (++spins < 64)
+        return;
+      if (spins < 128)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    /**
+     * @brief Whether the wait has got to sleeping, when a check for dead
+     * peers costs little compared to it
+     */
+    bool idle() const { return spins >= 128; }
+  };
+
+  static std::size_t ring_stride(std::size_t capacity) { return sizeof(Ring) + capacity; }
+  static std::size_t header_bytes(std::size_t ranks) {
+    const std::size_t bytes = sizeof(Header) + ranks * sizeof(std::atomic<std::int64_t>);
+    return (bytes + CacheLineSize - 1) / CacheLineSize * CacheLineSize;
+  }
+  static std::size_t layout_bytes(std::size_t ranks, std::size_t capacity) {
+    return header_bytes(ranks) + ranks * ranks * ring_stride(capacity);
+  }
+  Header &header() const { return *static_cast<Header *>(_base); }
+  std::atomic<std::int64_t> &pid(std::size_t rank) const {
+    return reinterpret_cast<std::atomic<std::int64_t> *>(&header() + 1)[rank];
+  }
+  Ring *ring(std::size_t index) const {
+    return reinterpret_cast<Ring *>(static_cast<std::byte *>(_base) +
+                                    header_bytes(header().ranks) +
+                                    index * ring_stride(header().capacity));
+  }
+  std::byte *data(Ring *r) const { return reinterpret_cast<std::byte *>(r + 1); }
+
+  void map(int fd, std::size_t bytes) {
+    void *base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      if (_owner)
+        ::shm_unlink(_name.c_str());
+      _owner = false;
+      throw std::system_error(error, std::generic_category(), _name);
+    }
+    _base = base;
+    _bytes = bytes;
+  }
+  void attach(std::size_t rank) {
+    _rank = rank;
+    _ranks = header().ranks;
+    _capacity = header().capacity;
+    if (_bytes < layout_bytes(_ranks, _capacity))
+      throw std::invalid_argument(_name + " is truncated");
+    _pending.assign(_ranks, {});
+    _sent.assign(_ranks, 0);
+    pid(rank).store(::getpid(), std::memory_order_release);
+  }
+
+  /**
+   * @brief Whether `rank` has closed its transport or its process has ended
+   */
+  bool gone(std::size_t rank) const {
+    const std::int64_t id = pid(rank).load(std::memory_order_acquire);
+    if (id == 0)
+      return false;
+    if (id == Detached)
+      return true;
+    // A dead child stays a zombie until it is reaped, which kill() still
+    // finds, so ask waitid() first without reaping it
+    const auto p = static_cast<pid_t>(id);
+    siginfo_t info{};
+    if (::waitid(P_PID, static_cast<id_t>(p), &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+        info.si_pid == p)
+      return true;
+    return ::kill(p, 0) != 0 && errno == ESRCH;
+  }
+  [[noreturn]] static void throw_gone(std::size_t rank) {
+    throw std::runtime_error("rank " + std::to_string(rank) + " is gone");
+  }
+
+  /**
+   * @brief Copy as much of `bytes` as fits into the ring to `to`
+   */
+  std::size_t write(std::size_t to, std::span<const std::byte> bytes) {
+    Ring *r = ring(_rank * _ranks + to);
+    const std::uint64_t tail = r->tail.load(std::memory_order_relaxed);
+    const std::uint64_t head = r->head.load(std::memory_order_acquire);
+    const std::size_t n = std::min<std::size_t>(bytes.size(), _capacity - (tail - head));
+    const std::size_t at = tail & (_capacity - 1);
+    const std::size_t first = std::min(n, _capacity - at);
+    std::memcpy(data(r) + at, bytes.data(), first);
+    std::memcpy(data(r), bytes.data() + first, n - first);
+    r->tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+  /**
+   * @brief Fill `out` from the ring from `from`, pushing our pending data on
+   * while waiting
+   *
+   * @return bytes read, less than out.size() on timeout
+   * @throw std::runtime_error if `from` is gone and the ring is empty
+   */
+  std::size_t read(std::size_t from, std::span<std::byte> out, std::chrono::milliseconds timeout) {
+    Ring *r = ring(from * _ranks + _rank);
+    const auto deadline = timeout == Forever ? std::chrono::steady_clock::time_point::max()
+                                             : std::chrono::steady_clock::now() + timeout;
+    Backoff backoff;
+    std::size_t done = 0;
+    while (done < out.size()) {
+      const std::uint64_t head = r->head.load(std::memory_order_relaxed);
+      const std::uint64_t tail = r->tail.load(std::memory_order_acquire);
+      const std::size_t n = std::min<std::size_t>(out.size() - done, tail - head);
+      if (n == 0) {
+        progress();
+        if (std::chrono::steady_clock::now() >= deadline)
+          break;
+        // What a peer wrote before going is still read
+        if (backoff.idle() && gone(from) && r->tail.load(std::memory_order_acquire) == head)
+          throw_gone(from);
+        backoff.wait();
+        continue;
+      }
+      const std::size_t at = head & (_capacity - 1);
+      const std::size_t first = std::min(n, _capacity - at);
+      std::memcpy(out.data() + done, data(r) + at, first);
+      std::memcpy(out.data() + done + first, data(r), n - first);
+      r->head.store(head + n, std::memory_order_release);
+      done += n;
+      backoff = {};
+    }
+    return done;
+  }
+  /**
+   * @brief Push pending data into the rings
+   *
+   * @return true if nothing is pending any more
+   */
+  bool progress() {
+    bool empty = true;
+    for (std::size_t to = 0; to < _ranks; ++to) {
+      auto &pending = _pending[to];
+      if (pending.empty())
+        continue;
+      _sent[to] += write(to, std::span<const std::byte>(pending).subspan(_sent[to]));
+      if (_sent[to] == pending.size()) {
+        pending.clear();
+        _sent[to] = 0;
+      } else {
+        empty = false;
+      }
+    }
+    return empty;
+  }
+};
+
+/**
+ * @brief Exchange of ghost (boundary) unit state between neighboring ranks
+ * at the end of every step. Units post the state the neighbors need during
+ * the step; after end_step(), ghosts(rank) holds what that neighbor posted
+ * for this rank.
+ *
+ * @tparam T - trivially copyable state
+ */
+template <class T> class GhostExchange : public ISwarmService {
+  static_assert(std::is_trivially_copyable_v<T>);
+  struct Outbox {
+    std::mutex mutex;
+    std::vector<T> values;
+  };
+  ITransport &_transport;
+  std::vector<std::size_t> _neighbors;
+  std::unique_ptr<Outbox[]> _outboxes; // by rank
+  std::vector<std::vector<T>> _ghosts; // by rank
+
+public:
+  /**
+   * @param neighbors - ranks to exchange with; the relation must be symmetric
+   */
+  GhostExchange(ITransport &transport, std::vector<std::size_t> neighbors)
+      : _transport(transport), _neighbors(std::move(neighbors)),
+        _outboxes(std::make_unique<Outbox[]>(transport.ranks())), _ghosts(transport.ranks()) {}
+
+  /**
+   * @brief State for neighbor `to`; thread-safe
+   */
+  void post(std::size_t to, const T &value) {
+    std::lock_guard lock(_outboxes[to].mutex);
+    _outboxes[to].values.push_back(value);
+  }
+  std::span<const T> ghosts(std::size_t from) const { return _ghosts[from]; }
+  const std::vector<std::size_t> &neighbors() const { return _neighbors; }
+
+  void end_step() override {
+    for (const std::size_t to : _neighbors) {
+      send_values<T>(_transport, to, _outboxes[to].values);
+      _outboxes[to].values.clear();
+    }
+    for (const std::size_t from : _neighbors)
+      _ghosts[from] = receive_values<T>(_transport, from);
+    _transport.flush();
+  }
+};
+
+/**
+ * @brief Run body(rank) in `ranks` processes on this machine: rank 0 in the
+ * calling process, the others in fork()ed children that exit with the value
+ * body returns (1 if it throws)
+ *
+ * @return 0 if every rank returned 0, else the first non-zero result; an
+ * exception of rank 0 is rethrown once the children have exited. The
+ * children are killed then, as they may be waiting for rank 0.
+ */
+inline int fork_ranks(std::size_t ranks, const std::function<int(std::size_t)> &body) {
+  std::vector<pid_t> children;
+  for (std::size_t rank = 1; rank < ranks; ++rank) {
+    const pid_t pid = ::fork();
+    if (pid < 0)
+      throw std::system_error(errno, std::generic_category(), "fork");
+    if (pid == 0) {
+      int code = 1;
+      try {
+        code = body(rank);
+      } catch (...) {
+      }
+      ::_exit(code);
+    }
+    children.push_back(pid);
+  }
+  int result = 1;
+  std::exception_ptr error;
+  try {
+    result = body(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  if (error)
+    for (const pid_t pid : children)
+      ::kill(pid, SIGKILL);
+  for (const pid_t pid : children) {
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    const int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (result == 0)
+      result = code;
+  }
+  if (error)
+    std::rethrow_exception(error);
+  return result;
+}
+} // namespace swarm
@@ -0,0 +1,87 @@
+#pragma once
+#include "AlignedAllocator.hpp"
+#include "SwarmService.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief State of the units of a swarm kept twice, in two contiguous,
+ * cache-aligned arrays: during a step units read the values of the previous
+ * step with read() and write the values of the next one with write(), and
+ * end_step() swaps the arrays. Whatever unit a unit reads, and whatever
+ * thread runs either of them, it sees the previous step only, so synchronous
+ * updates run in parallel without locks.
+ *
+ * A unit owns one slot, taken by add() and returned by remove() between
+ * steps; freed slots are reused. A unit writes only its own slot, and writes
+ * it completely every step unless the buffer carries the values over.
+ */
+template <class T> class DoubleBuffer : public ISwarmService {
+  std::vector<T, AlignedAllocator<T>> _data[2];
+  std::vector<std::size_t> _free;
+  std::size_t _read = 0;
+  bool _carry;
+
+public:
+  /**
+   * @param carry - end_step() also copies the new values into the write
+   * array, for units that do not write every step
+   */
+  explicit DoubleBuffer(bool carry = false) : _carry(carry) {}
+
+  void reserve(std::size_t slots) {
+    _data[0].reserve(slots);
+    _data[1].reserve(slots);
+  }
+  /**
+   * @brief Take a slot holding `value` in both arrays
+   *
+   * @return the slot
+   */
+  std::size_t add(const T &value = T()) {
+    if (_free.empty()) {
+      _data[0].push_back(value);
+      _data[1].push_back(value);
+      return _data[0].size() - 1;
+    }
+    const std::size_t slot = _free.back();
+    _free.pop_back();
+    _data[0][slot] = value;
+    _data[1][slot] = value;
+    return slot;
+  }
+  void remove(std::size_t slot) { _free.push_back(slot); }
+
+  /**
+   * @brief value of the slot at the end of the previous step
+   */
+  const T &read(std::size_t slot) const { return _data[_read][slot]; }
+  /**
+   * @brief value of the slot at the end of this step
+   */
+  T &write(std::size_t slot) { return _data[_read ^ 1][slot]; }
+  /**
+   * @brief all slots at the end of the previous step, freed ones included
+   */
+  std::span<const T> read() const { return _data[_read]; }
+  std::span<T> write() { return _data[_read ^ 1]; }
+
+  std::size_t size() const { return _data[0].size() - _free.size(); }
+  /**
+   * @brief number of slots, freed ones included
+   */
+  std::size_t slots() const { return _data[0].size(); }
+
+  /**
+   * @brief Step barrier: what was written becomes readable
+   */
+  void end_step() override {
+    _read ^= 1;
+    if (_carry)
+      std::copy(_data[_read].begin(), _data[_read].end(), _data[_read ^ 1].begin());
+  }
+};
+} // namespace swarm
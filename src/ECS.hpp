@@ -0,0 +1,279 @@
+#pragma once
+#include "Parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Handle of an entity (an agent without an object of its own) in an
+ * EntityRegistry. The generation tells a destroyed entity from a new one
+ * in the same slot.
+ */
+struct Entity {
+  std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+  std::uint32_t generation = 0;
+  bool operator==(const Entity &) const = default;
+};
+
+namespace detail {
+inline std::uint32_t next_component_id() {
+  static std::atomic<std::uint32_t> next{0};
+  return next++;
+}
+/**
+ * @brief Dense id of a component type, the same in every registry
+ */
+template <class C> std::uint32_t component_id() {
+  static const std::uint32_t id = next_component_id();
+  return id;
+}
+} // namespace detail
+
+struct IComponentPool {
+  virtual ~IComponentPool() = default;
+  virtual bool contains(std::uint32_t index) const = 0;
+  virtual void remove(std::uint32_t index) = 0;
+  virtual std::size_t size() const = 0;
+};
+
+/**
+ * @brief Sparse set: the components of one type in a dense array, with an
+ * index from entity slot to array position. Iteration walks the dense array;
+ * removal moves the last component into the hole, so the order is not
+ * stable.
+ */
+template <class C> class SparseSet : public IComponentPool {
+  static constexpr std::uint32_t Absent = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> _sparse; // entity index -> dense position
+  std::vector<Entity> _entities;
+  std::vector<C> _values;
+
+public:
+  bool contains(std::uint32_t index) const override {
+    return index < _sparse.size() && _sparse[index] != Absent;
+  }
+  std::size_t size() const override { return _values.size(); }
+
+  /**
+   * @brief Add the component of `e`, or replace it
+   */
+  template <class... Args> C &emplace(Entity e, Args &&...args) {
+    if (contains(e.index))
+      return _values[_sparse[e.index]] = C{std::forward<Args>(args)...};
+    if (e.index >= _sparse.size())
+      _sparse.resize(std::max<std::size_t>(e.index + 1, _sparse.size() * 2), Absent);
+    _sparse[e.index] = static_cast<std::uint32_t>(_values.size());
+    _entities.push_back(e);
+    return _values.emplace_back(C{std::forward<Args>(args)...});
+  }
+  void remove(std::uint32_t index) override {
+    if (!contains(index))
+      return;
+    const std::uint32_t hole = _sparse[index];
+    const std::uint32_t last = static_cast<std::uint32_t>(_values.size() - 1);
+    if (hole != last) {
+      _values[hole] = std::move(_values[last]);
+      _entities[hole] = _entities[last];
+      _sparse[_entities[hole].index] = hole;
+    }
+    _values.pop_back();
+    _entities.pop_back();
+    _sparse[index] = Absent;
+  }
+  void reserve(std::size_t n) {
+    _entities.reserve(n);
+    _values.reserve(n);
+  }
+
+  C &get(std::uint32_t index) { return _values[_sparse[index]]; }
+  const C &get(std::uint32_t index) const { return _values[_sparse[index]]; }
+  /**
+   * @brief The column: every component of this type, contiguous
+   */
+  std::span<C> values() { return _values; }
+  std::span<const C> values() const { return _values; }
+  /**
+   * @brief Owner of each component of values()
+   */
+  std::span<const Entity> entities() const { return _entities; }
+};
+
+template <class... Cs> class View;
+
+/**
+ * @brief Entity-component storage for homogeneous swarms. Instead of one
+ * object per agent holding its components, every component type lives in
+ * its own SparseSet, so a pass over one component of all agents reads a
+ * single contiguous array.
+ *
+ * Destroyed slots are recycled through a free list with a new generation.
+ * Not thread-safe for structural changes (create, destroy, emplace,
+ * remove); View::each with a pool may change component values.
+ */
+class EntityRegistry {
+  std::vector<std::uint32_t> _generations;
+  std::vector<char> _alive;
+  std::vector<std::uint32_t> _free;
+  std::vector<std::unique_ptr<IComponentPool>> _pools; // by component id
+
+public:
+  Entity create() {
+    if (!_free.empty()) {
+      const std::uint32_t index = _free.back();
+      _free.pop_back();
+      _alive[index] = 1;
+      return {index, _generations[index]};
+    }
+    _generations.push_back(0);
+    _alive.push_back(1);
+    return {static_cast<std::uint32_t>(_generations.size() - 1), 0};
+  }
+  /**
+   * @brief Remove the entity and its components
+   *
+   * @return false if it was not alive
+   */
+  bool destroy(Entity e) {
+    if (!alive(e))
+      return false;
+    for (auto &pool : _pools)
+      if (pool)
+        pool->remove(e.index);
+    ++_generations[e.index];
+    _alive[e.index] = 0;
+    _free.push_back(e.index);
+    return true;
+  }
+  bool alive(Entity e) const {
+    return e.index < _generations.size() && _alive[e.index] &&
+           _generations[e.index] == e.generation;
+  }
+  /**
+   * @brief Number of live entities
+   */
+  std::size_t size() const { return _generations.size() - _free.size(); }
+  /**
+   * @brief Entity slots ever used, live or free
+   */
+  std::size_t capacity() const { return _generations.size(); }
+
+  template <class C> SparseSet<C> &pool() {
+    const std::uint32_t id = detail::component_id<C>();
+    if (id >= _pools.size())
+      _pools.resize(id + 1);
+    if (!_pools[id])
+      _pools[id] = std::make_unique<SparseSet<C>>();
+    return static_cast<SparseSet<C> &>(*_pools[id]);
+  }
+  /**
+   * @brief Add the component of a live entity, or replace it
+   *
+   * @throw std::out_of_range if the entity is dead
+   */
+  template <class C, class... Args> C &emplace(Entity e, Args &&...args) {
+    if (!alive(e))
+      throw std::out_of_range("EntityRegistry: dead entity");
+    return pool<C>().emplace(e, std::forward<Args>(args)...);
+  }
+  /**
+   * @brief Remove the component; a no-op for a dead entity, whose slot may
+   * belong to another one by now
+   */
+  template <class C> void remove(Entity e) {
+    if (alive(e))
+      pool<C>().remove(e.index);
+  }
+  template <class C> bool has(Entity e) { return alive(e) && pool<C>().contains(e.index); }
+  /**
+   * @brief The component of a live entity that has it
+   *
+   * @throw std::out_of_range if the entity is dead
+   */
+  template <class C> C &get(Entity e) {
+    if (!alive(e))
+      throw std::out_of_range("EntityRegistry: dead entity");
+    return pool<C>().get(e.index);
+  }
+  template <class C> C *try_get(Entity e) {
+    auto &p = pool<C>();
+    return alive(e) && p.contains(e.index) ? &p.get(e.index) : nullptr;
+  }
+
+  /**
+   * @brief The entities with all of Cs
+   */
+  template <class... Cs> View<Cs...> view() { return View<Cs...>(pool<Cs>()...); }
+};
+
+/**
+ * @brief Entities having every component of Cs. Iteration follows the dense
+ * array of the smallest of the pools and looks the other components up, so
+ * a single-component view is a plain loop over a column.
+ */
+template <class... Cs> class View {
+  static_assert(sizeof...(Cs) > 0);
+  std::tuple<SparseSet<Cs> *...> _pools;
+  std::span<const Entity> _entities; // of the smallest pool
+
+public:
+  explicit View(SparseSet<Cs> &...pools) : _pools(&pools...) {
+    std::size_t smallest = std::numeric_limits<std::size_t>::max();
+    auto pick = [&](const auto &p) {
+      if (p.size() < smallest) {
+        smallest = p.size();
+        _entities = p.entities();
+      }
+    };
+    (pick(pools), ...);
+  }
+  /**
+   * @brief Upper bound of the number of entities in the view
+   */
+  std::size_t size_hint() const { return _entities.size(); }
+
+  /**
+   * @brief fn(Entity, Cs &...) for every entity of the view
+   */
+  template <class F> void each(F &&fn) { each_in(0, _entities.size(), fn); }
+  /**
+   * @brief each() split over the pool in contiguous blocks; fn may change the
+   * components of the entity it is given, nothing else
+   */
+  template <class F> void each(ThreadPool &pool, F &&fn) {
+    pool.parallel_for(_entities.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+      each_in(begin, end, fn);
+    });
+  }
+  /**
+   * @brief each() for the positions [begin, end) of [0, size_hint())
+   */
+  template <class F> void each(std::size_t begin, std::size_t end, F &&fn) {
+    each_in(begin, end, fn);
+  }
+
+private:
+  template <class F> void each_in(std::size_t begin, std::size_t end, F &fn) {
+    if constexpr (sizeof...(Cs) == 1) {
+      auto &column = *std::get<0>(_pools);
+      auto values = column.values();
+      for (std::size_t i = begin; i < end; ++i)
+        fn(_entities[i], values[i]);
+    } else {
+      for (std::size_t i = begin; i < end; ++i) {
+        const Entity e = _entities[i];
+        if ((std::get<SparseSet<Cs> *>(_pools)->contains(e.index) && ...))
+          fn(e, std::get<SparseSet<Cs> *>(_pools)->get(e.index)...);
+      }
+    }
+  }
+};
+} // namespace swarm
@@ -0,0 +1,67 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+namespace swarm {
+
+/**
+ * @brief Read-only memory mapping of a whole file (POSIX). The contents are
+ * paged in on first access and read sequentially without copies.
+ */
+class MappedFile {
+  const char *_data = nullptr;
+  std::size_t _size = 0;
+
+public:
+  /**
+   * @throw std::system_error if the file cannot be opened or mapped
+   */
+  explicit MappedFile(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), path);
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    _size = static_cast<std::size_t>(info.st_size);
+    if (_size > 0) {
+      void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+      ::madvise(data, _size, MADV_SEQUENTIAL);
+      _data = static_cast<const char *>(data);
+    }
+    ::close(fd);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept
+      : _data(std::exchange(other._data, nullptr)),
+        _size(std::exchange(other._size, 0)) {}
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    return *this;
+  }
+  ~MappedFile() {
+    if (_data)
+      ::munmap(const_cast<char *>(_data), _size);
+  }
+
+  std::string_view view() const { return {_data, _size}; }
+  std::size_t size() const { return _size; }
+};
+} // namespace swarm
@@ -0,0 +1,411 @@
+#pragma once
+#include "AlignedAllocator.hpp"
+#include "SwarmService.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Header of a message between swarm units. The payload is not copied
+ * into the mailbox, it stays in the sender's MessageArena.
+ */
+struct Message {
+  std::uint32_t sender = 0;
+  std::uint32_t tag = 0;
+  std::uint32_t size = 0; // payload bytes
+  const void *data = nullptr;
+
+  template <class T> const T &as() const {
+    return *static_cast<const T *>(data);
+  }
+};
+
+/**
+ * @brief Bump allocator for message payloads. Memory is taken from chunks that
+ * are kept between steps; reset() releases everything at once by rewinding.
+ * Not thread-safe: every endpoint of the bus allocates from its own arenas.
+ */
+class MessageArena {
+  static constexpr std::size_t ChunkSize = 64 * 1024;
+  struct Chunk {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+  std::vector<Chunk> _chunks;
+  std::size_t _chunk = 0;
+  std::size_t _offset = 0;
+
+public:
+  void *allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+    for (;;) {
+      if (_chunk < _chunks.size()) {
+        const Chunk &chunk = _chunks[_chunk];
+        const auto address =
+            reinterpret_cast<std::uintptr_t>(chunk.data.get() + _offset);
+        const std::size_t start = _offset + ((align - address % align) % align);
+        if (start + bytes <= chunk.size) {
+          _offset = start + bytes;
+          return chunk.data.get() + start;
+        }
+        ++_chunk;
+        _offset = 0;
+        continue;
+      }
+      const std::size_t size = std::max(ChunkSize, bytes + align);
+      _chunks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+    }
+  }
+  void reset() {
+    _chunk = 0;
+    _offset = 0;
+  }
+  /**
+   * @brief bytes of all chunks held by the arena
+   */
+  std::size_t capacity() const {
+    std::size_t total = 0;
+    for (const auto &chunk : _chunks)
+      total += chunk.size;
+    return total;
+  }
+};
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer queue (Vyukov's
+ * sequence-numbered ring). Producers claim a slot with one CAS, the consumer
+ * needs no atomic read-modify-write at all.
+ *
+ * @tparam T - trivially copyable element
+ */
+template <class T> class MpscRing {
+  static_assert(std::is_trivially_copyable_v<T>);
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+  std::unique_ptr<Slot[]> _slots;
+  std::size_t _mask;
+  alignas(CacheLineSize) std::atomic<std::size_t> _tail{0}; // producers
+  alignas(CacheLineSize) std::size_t _head = 0;             // consumer
+
+public:
+  /**
+   * @param capacity - rounded up to a power of two
+   */
+  explicit MpscRing(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    _slots = std::make_unique<Slot[]>(size);
+    _mask = size - 1;
+    for (std::size_t i = 0; i < size; ++i)
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+
+  std::size_t capacity() const { return _mask + 1; }
+
+  /**
+   * @brief Any thread. false if the ring is full.
+   */
+  bool try_push(const T &value) {
+    std::size_t position = _tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+      slot = &_slots[position & _mask];
+      const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(sequence - position);
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        position = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = value;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Consumer thread only. false if the ring is empty.
+   */
+  bool try_pop(T &out) {
+    Slot &slot = _slots[_head & _mask];
+    if (slot.sequence.load(std::memory_order_acquire) != _head + 1)
+      return false;
+    out = slot.value;
+    slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+    ++_head;
+    return true;
+  }
+};
+
+/**
+ * @brief When a sent message becomes visible to its receiver
+ */
+enum class MessageDelivery {
+  /**
+   * @brief at once, through the receiver's lock-free mailbox. The order in
+   * which messages of different senders arrive depends on thread timing.
+   */
+  Immediate,
+  /**
+   * @brief at the next step barrier: messages sent in step t are received in
+   * step t + 1, in sender order, whatever the number of threads. Senders write
+   * only to their own outbox, so a step needs no synchronization at all.
+   */
+  StepSynchronous
+};
+
+/**
+ * @brief Message exchange between swarm units. Every endpoint (unit) has its
+ * own mailbox and payload arenas, so units may send and receive concurrently
+ * while the swarm iterates them in parallel. See MessageDelivery for the two
+ * delivery modes.
+ *
+ * A payload is written once into the sender's arena and shared by all
+ * receivers of a multicast or broadcast. It stays valid until the end of the
+ * step after the one it was sent in: end_step(), called by the swarm at the
+ * step barrier, rewinds the arenas of the step before. A unit should therefore
+ * drain its mailbox every step. Messages beyond the mailbox capacity are
+ * dropped and counted.
+ *
+ * Endpoints and groups are set up between steps, not while units run.
+ */
+class MessageBus : public ISwarmService {
+public:
+  using EndpointId = std::uint32_t;
+  using GroupId = std::size_t;
+
+private:
+  // Step-synchronous send, fanned out to its receivers at the barrier
+  struct Outgoing {
+    enum Kind : std::uint32_t { Direct, Group, Broadcast };
+    Kind kind;
+    std::size_t to; // endpoint or group
+    Message message;
+  };
+  struct alignas(CacheLineSize) Endpoint {
+    std::unique_ptr<MpscRing<Message>> mailbox; // Immediate only
+    std::vector<Outgoing> outbox;               // StepSynchronous only
+    std::vector<Message> inbox;                 // StepSynchronous only
+    MessageArena arenas[2];
+    std::atomic<std::size_t> dropped{0};
+  };
+  std::vector<std::unique_ptr<Endpoint>> _endpoints;
+  std::vector<std::vector<EndpointId>> _groups;
+  std::size_t _mailbox_capacity;
+  MessageDelivery _delivery;
+  std::size_t _step = 0;
+
+public:
+  /**
+   * @param mailbox_capacity - messages a mailbox holds (per step when
+   * step-synchronous); an immediate mailbox rounds it up to a power of two
+   */
+  explicit MessageBus(std::size_t mailbox_capacity = 1024,
+                      MessageDelivery delivery = MessageDelivery::Immediate)
+      : _mailbox_capacity(mailbox_capacity), _delivery(delivery) {}
+  MessageBus(const MessageBus &) = delete;
+  MessageBus &operator=(const MessageBus &) = delete;
+
+  MessageDelivery delivery() const { return _delivery; }
+
+  EndpointId add_endpoint() {
+    auto endpoint = std::make_unique<Endpoint>();
+    if (_delivery == MessageDelivery::Immediate)
+      endpoint->mailbox = std::make_unique<MpscRing<Message>>(_mailbox_capacity);
+    _endpoints.push_back(std::move(endpoint));
+    return static_cast<EndpointId>(_endpoints.size() - 1);
+  }
+  std::size_t endpoints() const { return _endpoints.size(); }
+
+  GroupId add_group(std::vector<EndpointId> members = {}) {
+    _groups.push_back(std::move(members));
+    return _groups.size() - 1;
+  }
+  void join(GroupId group, EndpointId endpoint) {
+    _groups.at(group).push_back(endpoint);
+  }
+  void leave(GroupId group, EndpointId endpoint) {
+    auto &members = _groups.at(group);
+    members.erase(std::remove(members.begin(), members.end(), endpoint), members.end());
+  }
+  const std::vector<EndpointId> &group(GroupId group) const {
+    return _groups.at(group);
+  }
+
+  /**
+   * @brief Payload memory of `sender` for the current step
+   */
+  void *allocate(EndpointId sender, std::size_t bytes,
+                 std::size_t align = alignof(std::max_align_t)) {
+    return _endpoints[sender]->arenas[_step & 1].allocate(bytes, align);
+  }
+
+  /**
+   * @brief Deliver a message whose payload is already in place (allocate())
+   *
+   * @return false if the mailbox was full and the message was dropped; a
+   * step-synchronous send is always accepted and may be dropped at the barrier
+   */
+  bool post(EndpointId to, const Message &message) {
+    if (_delivery == MessageDelivery::StepSynchronous) {
+      _endpoints[message.sender]->outbox.push_back(
+          {Outgoing::Direct, to, message});
+      return true;
+    }
+    Endpoint &endpoint = *_endpoints[to];
+    if (endpoint.mailbox->try_push(message))
+      return true;
+    endpoint.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  template <class T>
+  bool send(EndpointId from, EndpointId to, std::uint32_t tag, const T &value) {
+    return post(to, make_message(from, tag, value));
+  }
+  /**
+   * @return number of members the message was delivered (or, when
+   * step-synchronous, addressed) to
+   */
+  template <class T>
+  std::size_t multicast(EndpointId from, GroupId group, std::uint32_t tag,
+                        const T &value) {
+    const Message message = make_message(from, tag, value);
+    if (_delivery == MessageDelivery::StepSynchronous) {
+      _endpoints[from]->outbox.push_back({Outgoing::Group, group, message});
+      return receivers(_groups[group], from);
+    }
+    std::size_t delivered = 0;
+    for (const EndpointId to : _groups[group])
+      delivered += to != from && post(to, message);
+    return delivered;
+  }
+  /**
+   * @brief send to every endpoint except the sender
+   */
+  template <class T>
+  std::size_t broadcast(EndpointId from, std::uint32_t tag, const T &value) {
+    const Message message = make_message(from, tag, value);
+    if (_delivery == MessageDelivery::StepSynchronous) {
+      _endpoints[from]->outbox.push_back({Outgoing::Broadcast, 0, message});
+      return _endpoints.size() - 1;
+    }
+    std::size_t delivered = 0;
+    for (std::size_t to = 0; to < _endpoints.size(); ++to)
+      delivered += to != from && post(static_cast<EndpointId>(to), message);
+    return delivered;
+  }
+
+  /**
+   * @brief Call f(const Message &) for every message waiting for `endpoint`.
+   * Only the endpoint's owner may receive.
+   *
+   * @return number of messages received
+   */
+  template <class F> std::size_t receive(EndpointId endpoint, F &&f) {
+    if (_delivery == MessageDelivery::StepSynchronous) {
+      auto &inbox = _endpoints[endpoint]->inbox;
+      for (const Message &message : inbox)
+        f(message);
+      const std::size_t count = inbox.size();
+      inbox.clear();
+      return count;
+    }
+    auto &mailbox = *_endpoints[endpoint]->mailbox;
+    Message message;
+    std::size_t count = 0;
+    while (mailbox.try_pop(message)) {
+      f(std::as_const(message));
+      ++count;
+    }
+    return count;
+  }
+
+  /**
+   * @brief Step barrier: step-synchronous messages of the step just finished
+   * replace the unread ones in the inboxes, and payloads of the step before
+   * are released. Call with no unit running.
+   */
+  void end_step() override {
+    if (_delivery == MessageDelivery::StepSynchronous)
+      deliver();
+    ++_step;
+    for (auto &endpoint : _endpoints)
+      endpoint->arenas[_step & 1].reset();
+  }
+  std::size_t step() const { return _step; }
+
+  /**
+   * @brief messages dropped so far because the mailbox of `endpoint` was full
+   */
+  std::size_t dropped(EndpointId endpoint) const {
+    return _endpoints[endpoint]->dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::size_t receivers(const std::vector<EndpointId> &group,
+                        EndpointId from) const {
+    return group.size() - static_cast<std::size_t>(
+                              std::count(group.begin(), group.end(), from));
+  }
+
+  void deliver() {
+    for (auto &endpoint : _endpoints)
+      endpoint->inbox.clear();
+    auto put = [this](std::size_t to, const Message &message) {
+      Endpoint &endpoint = *_endpoints[to];
+      if (endpoint.inbox.size() < _mailbox_capacity)
+        endpoint.inbox.push_back(message);
+      else
+        endpoint.dropped.fetch_add(1, std::memory_order_relaxed);
+    };
+    // Sender order, then send order: the same for any number of threads
+    for (auto &sender : _endpoints) {
+      for (const Outgoing &out : sender->outbox) {
+        switch (out.kind) {
+        case Outgoing::Direct:
+          put(out.to, out.message);
+          break;
+        case Outgoing::Group:
+          for (const EndpointId to : _groups[out.to]) {
+            if (to != out.message.sender)
+              put(to, out.message);
+          }
+          break;
+        case Outgoing::Broadcast:
+          for (std::size_t to = 0; to < _endpoints.size(); ++to) {
+            if (to != out.message.sender)
+              put(to, out.message);
+          }
+          break;
+        }
+      }
+      sender->outbox.clear();
+    }
+  }
+
+  template <class T>
+  Message make_message(EndpointId from, std::uint32_t tag, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "message payloads are copied bytewise");
+    void *data = allocate(from, sizeof(T), alignof(T));
+    std::memcpy(data, &value, sizeof(T));
+    return {from, tag, static_cast<std::uint32_t>(sizeof(T)), data};
+  }
+};
+} // namespace swarm
@@ -0,0 +1,411 @@
+#pragma once
+#include "Parallel.hpp"
+#include "Swarm.hpp"
+#include "SwarmService.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+namespace swarm {
+
+/**
+ * @brief CPUs of each NUMA node that this process may run on
+ */
+struct NumaTopology {
+  std::vector<std::vector<int>> nodes;
+
+  std::size_t cpus() const {
+    std::size_t n = 0;
+    for (const auto &node : nodes)
+      n += node.size();
+    return n;
+  }
+
+  /**
+   * @brief One node with `cpus` CPUs numbered from 0, 0 - one per hardware
+   * thread
+   */
+  static NumaTopology single(std::size_t cpus = 0) {
+    if (cpus == 0)
+      cpus = std::max(1u, std::thread::hardware_concurrency());
+    NumaTopology t;
+    t.nodes.emplace_back();
+    for (std::size_t cpu = 0; cpu < cpus; ++cpu)
+      t.nodes[0].push_back(static_cast<int>(cpu));
+    return t;
+  }
+
+  /**
+   * @brief Parse a kernel CPU list such as "0-3,8,10-11"
+   *
+   * @throw std::invalid_argument on a malformed list
+   */
+  static std::vector<int> parse_cpulist(std::string_view list) {
+    std::vector<int> cpus;
+    auto number = [&list](std::size_t &at) {
+      if (at >= list.size() || list[at] < '0' || list[at] > '9')
+        throw std::invalid_argument("bad cpu list: " + std::string(list));
+      int n = 0;
+      for (; at < list.size() && list[at] >= '0' && list[at] <= '9'; ++at)
+        n = n * 10 + (list[at] - '0');
+      return n;
+    };
+    while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+      list.remove_suffix(1);
+    for (std::size_t at = 0; at < list.size();) {
+      const int first = number(at);
+      int last = first;
+      if (at < list.size() && list[at] == '-')
+        last = number(++at);
+      for (int cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+      if (at < list.size() && list[at++] != ',')
+        throw std::invalid_argument("bad cpu list: " + std::string(list));
+    }
+    return cpus;
+  }
+
+  /**
+   * @brief The nodes listed in sysfs, restricted to the CPUs of the process's
+   * affinity mask. Falls back to single() where there is no such information
+   * (not Linux, no sysfs).
+   */
+  static NumaTopology detect(const std::filesystem::path &root = "/sys/devices/system/node") {
+    std::vector<std::pair<int, std::vector<int>>> found;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(root, error)) {
+      const std::string name = entry.path().filename().string();
+      if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+          name.find_first_not_of("0123456789", 4) != std::string::npos)
+        continue;
+      std::ifstream file(entry.path() / "cpulist");
+      std::string list;
+      if (!std::getline(file, list))
+        continue;
+      std::vector<int> cpus = parse_cpulist(list);
+      std::erase_if(cpus, [](int cpu) { return !allowed(cpu); });
+      if (!cpus.empty())
+        found.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+    }
+    if (found.empty())
+      return single();
+    std::sort(found.begin(), found.end());
+    NumaTopology t;
+    for (auto &node : found)
+      t.nodes.push_back(std::move(node.second));
+    return t;
+  }
+
+private:
+  static bool allowed(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+      return true;
+    return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(static_cast<std::size_t>(cpu), &set);
+#else
+    return cpu >= 0;
+#endif
+  }
+};
+
+/**
+ * @brief Restrict the calling thread to `cpus`
+ *
+ * @return false if the system refused or does not support it
+ */
+inline bool pin_current_thread(std::span<const int> cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const int cpu : cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(static_cast<std::size_t>(cpu), &set);
+  return !cpus.empty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+namespace detail {
+inline thread_local std::size_t numa_partition = 0;
+}
+/**
+ * @brief Partition of the SwarmNumaContainer worker running the calling
+ * thread; 0 outside of one
+ */
+inline std::size_t numa_partition() { return detail::numa_partition; }
+
+/**
+ * @brief Units container partitioned by NUMA node. Each node has its own unit
+ * slots and its own workers, pinned to its CPUs; a unit is only ever run by
+ * workers of its node. Units made by create_units() are allocated by those
+ * workers, so by the kernel's first-touch policy they live in the node's
+ * memory.
+ *
+ * The calling thread only waits for the workers (it is worker 0 of pool(),
+ * with nothing to do), so it is neither pinned nor bound to a partition.
+ * Units must not touch units of other partitions while they run; data that
+ * crosses partitions goes through an ExchangeBuffer.
+ */
+template <typename IUnitT = ISwarmUnit>
+class SwarmNumaContainer : public ISwarmUnitsContainer<IUnitT> {
+  NumaTopology topology_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::vector<std::size_t> nodeOf_;    // by worker, pool worker - 1
+  std::vector<std::size_t> rankOf_;    // by worker, within its node
+  std::vector<std::size_t> workersOf_; // by node
+  std::vector<SwarmUnitSlots<IUnitT>> partitions_;
+  bool pinned_ = false;
+
+public:
+  SwarmNumaContainer(std::size_t size) : ISwarmUnitsContainer<IUnitT>(size) {
+    set_topology(NumaTopology::detect());
+    reserve(size);
+  }
+  SwarmNumaContainer() : ISwarmUnitsContainer<IUnitT>() {
+    set_topology(NumaTopology::detect());
+  }
+
+  /**
+   * @brief Replace the partitions and the pool; only while the container is
+   * empty
+   *
+   * @param workers_per_node - 0 - one per CPU of the node, each pinned to its
+   * CPU; otherwise pinned to the whole node
+   * @param pin - false - leave the workers unpinned (the partitions are kept)
+   */
+  void set_topology(NumaTopology topology, std::size_t workers_per_node = 0,
+                    bool pin = true) {
+    if (size() != 0)
+      throw std::logic_error("set_topology on a non-empty SwarmNumaContainer");
+    if (topology.nodes.empty())
+      topology = NumaTopology::single();
+    topology_ = std::move(topology);
+    nodeOf_.clear();
+    rankOf_.clear();
+    workersOf_.assign(topology_.nodes.size(), 0);
+    for (std::size_t node = 0; node < topology_.nodes.size(); ++node) {
+      const std::size_t workers =
+          workers_per_node ? workers_per_node : std::max<std::size_t>(1, topology_.nodes[node].size());
+      for (std::size_t rank = 0; rank < workers; ++rank) {
+        nodeOf_.push_back(node);
+        rankOf_.push_back(rank);
+      }
+      workersOf_[node] = workers;
+    }
+    pool_.reset();
+    pool_ = std::make_unique<ThreadPool>(nodeOf_.size() + 1);
+    partitions_ = std::vector<SwarmUnitSlots<IUnitT>>(topology_.nodes.size());
+    std::atomic<bool> pinned{pin};
+    on_workers([&](std::size_t worker) {
+      const auto &cpus = topology_.nodes[nodeOf_[worker]];
+      detail::numa_partition = nodeOf_[worker];
+      if (!pin)
+        return;
+      bool ok;
+      if (workers_per_node == 0 && !cpus.empty())
+        ok = pin_current_thread(std::span<const int>(&cpus[rankOf_[worker] % cpus.size()], 1));
+      else
+        ok = pin_current_thread(cpus);
+      if (!ok)
+        pinned = false;
+    });
+    pinned_ = pinned;
+  }
+  const NumaTopology &topology() const { return topology_; }
+  /**
+   * @brief Whether every worker was pinned by the last set_topology()
+   */
+  bool pinned() const { return pinned_; }
+  /**
+   * @brief the pool of the workers; for swarm-level work use
+   * for_each_partition()
+   */
+  ThreadPool &pool() { return *pool_; }
+  std::size_t workers() const { return nodeOf_.size(); }
+  std::size_t partitions() const { return partitions_.size(); }
+  std::size_t partition_size(std::size_t partition) const {
+    return partitions_[partition].size();
+  }
+  /**
+   * @brief Partition of worker `worker`, 0 <= worker < workers()
+   */
+  std::size_t partition_of_worker(std::size_t worker) const { return nodeOf_[worker]; }
+
+  /**
+   * @brief Call fn(partition) once per partition, on the first worker of the
+   * partition's node, all partitions in parallel
+   */
+  template <class F> void for_each_partition(F &&fn) {
+    on_workers([&](std::size_t worker) {
+      if (rankOf_[worker] == 0)
+        fn(nodeOf_[worker]);
+    });
+  }
+
+  /**
+   * @brief Reserve `size` slots in total, spread over the partitions in
+   * proportion to their workers, by the partitions' own workers
+   */
+  void reserve(std::size_t size) {
+    for_each_partition([&](std::size_t p) {
+      partitions_[p].reserve(size * workersOf_[p] / nodeOf_.size() + 1);
+    });
+  }
+
+  /**
+   * @brief Add `count` units spread over the partitions in proportion to their
+   * workers, each allocated by a worker of its partition
+   *
+   * @param make - make(partition, i) returns the i-th unit (a new IUnitT or a
+   * SwarmUnitLink); called concurrently
+   */
+  template <class F> void create_units(std::size_t count, F &&make) {
+    std::vector<std::vector<SwarmUnitLink<IUnitT>>> made(nodeOf_.size());
+    on_workers([&](std::size_t worker) {
+      const auto [begin, end] = ThreadPool::block(count, nodeOf_.size(), worker);
+      made[worker].reserve(end - begin);
+      for (std::size_t i = begin; i < end; ++i)
+        made[worker].emplace_back(make(nodeOf_[worker], i));
+    });
+    // Slots are only written by the first worker of each partition
+    for_each_partition([&](std::size_t p) {
+      for (std::size_t worker = 0; worker < nodeOf_.size(); ++worker)
+        if (nodeOf_[worker] == p)
+          for (auto &unit : made[worker])
+            partitions_[p].add(std::move(unit));
+    });
+  }
+
+  /**
+   * @brief Add a unit allocated elsewhere to the smallest partition
+   */
+  void add_unit(SwarmUnitLink<IUnitT> unit) override {
+    std::size_t smallest = 0;
+    for (std::size_t p = 1; p < partitions_.size(); ++p)
+      if (partitions_[p].size() * workersOf_[smallest] <
+          partitions_[smallest].size() * workersOf_[p])
+        smallest = p;
+    partitions_[smallest].add(std::move(unit));
+  }
+  std::size_t remove_units(std::span<const IUnitT *const> sorted) override {
+    std::vector<std::size_t> removed(partitions_.size(), 0);
+    for_each_partition([&](std::size_t p) { removed[p] = partitions_[p].remove(sorted); });
+    std::size_t total = 0;
+    for (const std::size_t n : removed)
+      total += n;
+    return total;
+  }
+  void for_each(std::function<void(IUnitT &)> action) const override {
+    for (const auto &partition : partitions_)
+      for (const auto &unit : partition.slots())
+        if (unit)
+          action(*unit);
+  }
+  void init() override {
+    run([](IUnitT &unit) { unit.init(); });
+  }
+  void iter() override {
+    run([](IUnitT &unit) { unit.iter(); });
+  }
+  std::size_t size() const override {
+    std::size_t n = 0;
+    for (const auto &partition : partitions_)
+      n += partition.size();
+    return n;
+  }
+  std::size_t reserved_size() const override {
+    std::size_t n = 0;
+    for (const auto &partition : partitions_)
+      n += partition.capacity();
+    return n;
+  }
+
+private:
+  template <class F> void on_workers(F &&fn) {
+    pool_->run([&](std::size_t worker) {
+      if (worker > 0)
+        fn(worker - 1);
+    });
+  }
+  template <class F> void run(F &&fn) {
+    on_workers([&](std::size_t worker) {
+      const std::size_t p = nodeOf_[worker];
+      const auto &slots = partitions_[p].slots();
+      const auto [begin, end] = ThreadPool::block(slots.size(), workersOf_[p], rankOf_[worker]);
+      for (std::size_t i = begin; i < end; ++i)
+        if (slots[i])
+          fn(*slots[i]);
+    });
+  }
+};
+
+/**
+ * @brief Values units post during a step, handed to every partition at the
+ * step barrier: the way data crosses partitions of a SwarmNumaContainer
+ * (candidates for a global best, broadcast messages, ...).
+ *
+ * post() appends to the outbox of the caller's partition, so posting only
+ * contends within a node. end_step() merges the outboxes in partition order
+ * and each partition's first worker copies the result into the partition's
+ * inbox, which received() returns to the units of that partition during the
+ * next step.
+ */
+template <class T, typename IUnitT = ISwarmUnit> class ExchangeBuffer : public ISwarmService {
+  struct alignas(64) Partition {
+    std::mutex mutex;
+    std::vector<T> outbox;
+    std::vector<T> inbox;
+  };
+  SwarmNumaContainer<IUnitT> &_units;
+  std::unique_ptr<Partition[]> _partitions;
+  std::vector<T> _merged;
+
+public:
+  explicit ExchangeBuffer(SwarmNumaContainer<IUnitT> &units)
+      : _units(units), _partitions(std::make_unique<Partition[]>(units.partitions())) {}
+
+  void post(T value) {
+    Partition &p = _partitions[std::min(numa_partition(), _units.partitions() - 1)];
+    std::lock_guard lock(p.mutex);
+    p.outbox.push_back(std::move(value));
+  }
+  /**
+   * @brief Everything posted in the previous step, in the caller's partition
+   */
+  std::span<const T> received() const {
+    return _partitions[std::min(numa_partition(), _units.partitions() - 1)].inbox;
+  }
+  std::span<const T> received(std::size_t partition) const {
+    return _partitions[partition].inbox;
+  }
+
+  void end_step() override {
+    _merged.clear();
+    for (std::size_t p = 0; p < _units.partitions(); ++p) {
+      auto &outbox = _partitions[p].outbox;
+      _merged.insert(_merged.end(), std::make_move_iterator(outbox.begin()),
+                     std::make_move_iterator(outbox.end()));
+      outbox.clear();
+    }
+    _units.for_each_partition([this](std::size_t p) { _partitions[p].inbox = _merged; });
+  }
+};
+} // namespace swarm
@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Fixed-size pool of worker threads. The calling thread takes part in
+ * every job as worker 0, so a pool of size 1 runs everything inline.
+ *
+ * parallel_for splits [0, n) into one contiguous block per worker and block t
+ * always goes to worker t, so per-worker buffers indexed by the worker id are
+ * stable between calls. Jobs must not start other jobs on the same pool.
+ */
+class ThreadPool {
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _start;
+  std::condition_variable _done;
+  const std::function<void(std::size_t)> *_job = nullptr;
+  std::size_t _generation = 0;
+  std::size_t _pending = 0;
+  std::exception_ptr _error;
+  bool _stop = false;
+
+public:
+  /**
+   * @brief Construct a new ThreadPool
+   *
+   * @param threads - number of workers including the calling thread, 0 - one
+   * per hardware thread
+   */
+  explicit ThreadPool(std::size_t threads = 0) {
+    if (threads == 0)
+      threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    _threads.reserve(threads - 1);
+    for (std::size_t id = 1; id < threads; ++id)
+      _threads.emplace_back([this, id] { worker_loop(id); });
+  }
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(_mutex);
+      _stop = true;
+    }
+    _start.notify_all();
+    for (auto &t : _threads)
+      t.join();
+  }
+
+  /**
+   * @brief number of workers including the calling thread
+   */
+  std::size_t size() const { return _threads.size() + 1; }
+
+  /**
+   * @brief Run job(worker) once on every worker and wait for all of them. The
+   * first exception thrown by a worker is rethrown here.
+   */
+  void run(const std::function<void(std::size_t)> &job) {
+    if (_threads.empty()) {
+      job(0);
+      return;
+    }
+    {
+      std::lock_guard lock(_mutex);
+      _job = &job;
+      _pending = _threads.size();
+      _error = nullptr;
+      ++_generation;
+    }
+    _start.notify_all();
+    std::exception_ptr own_error;
+    try {
+      job(0);
+    } catch (...) {
+      own_error = std::current_exception();
+    }
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+    _job = nullptr;
+    if (own_error)
+      std::rethrow_exception(own_error);
+    if (_error)
+      std::rethrow_exception(_error);
+  }
+
+  /**
+   * @brief Call fn(begin, end, worker) for the block of [0, n) owned by every
+   * worker. Empty blocks are skipped.
+   */
+  template <class F> void parallel_for(std::size_t n, F &&fn) {
+    const std::size_t workers = size();
+    run([n, workers, &fn](std::size_t worker) {
+      const auto [begin, end] = block(n, workers, worker);
+      if (begin < end)
+        fn(begin, end, worker);
+    });
+  }
+
+  /**
+   * @brief [begin, end) of block `index` when [0, n) is split into `blocks`
+   * contiguous, nearly equal parts
+   */
+  static std::pair<std::size_t, std::size_t>
+  block(std::size_t n, std::size_t blocks, std::size_t index) {
+    return {n * index / blocks, n * (index + 1) / blocks};
+  }
+  /**
+   * @brief index of the block (see block()) that contains element i
+   */
+  static std::size_t block_of(std::size_t n, std::size_t blocks,
+                              std::size_t i) {
+    return ((i + 1) * blocks - 1) / n;
+  }
+
+private:
+  void worker_loop(std::size_t id) {
+    std::size_t seen = 0;
+    for (;;) {
+      std::unique_lock lock(_mutex);
+      _start.wait(lock, [this, seen] { return _stop || _generation != seen; });
+      if (_stop)
+        return;
+      seen = _generation;
+      const auto *job = _job;
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        (*job)(id);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      if (error && !_error)
+        _error = error;
+      if (--_pending == 0)
+        _done.notify_one();
+    }
+  }
+};
+
+/**
+ * @brief Pairwise reduction of values in index order: op(reduce of the first
+ * half, reduce of the second half). The result depends on the values only,
+ * and floating-point rounding grows with log n rather than n.
+ */
+template <class T, class Op>
+T tree_reduce(std::span<const T> values, T identity, Op op) {
+  if (values.empty())
+    return identity;
+  if (values.size() == 1)
+    return values[0];
+  const std::size_t half = values.size() / 2;
+  return op(tree_reduce(values.first(half), identity, op),
+            tree_reduce(values.subspan(half), identity, op));
+}
+
+/**
+ * @brief Reduce map(0), ..., map(n - 1) with op on the pool. The tree is
+ * fixed by n and `leaf` alone: leaves of `leaf` consecutive indices are
+ * folded left to right in parallel, then tree_reduce() joins them in order,
+ * so the result is bit-identical for any number of workers, which a
+ * reduction of per-worker partials is not.
+ */
+template <class T, class Map, class Op>
+T ordered_reduce(ThreadPool &pool, std::size_t n, T identity, Map map, Op op,
+                 std::size_t leaf = 256) {
+  const std::size_t leaves = (n + leaf - 1) / leaf;
+  std::vector<T> partial(leaves, identity);
+  pool.parallel_for(leaves, [&](std::size_t begin, std::size_t end,
+                                std::size_t) {
+    for (std::size_t l = begin; l < end; ++l) {
+      T acc = map(l * leaf);
+      for (std::size_t i = l * leaf + 1; i < std::min(n, (l + 1) * leaf); ++i)
+        acc = op(acc, map(i));
+      partial[l] = acc;
+    }
+  });
+  return tree_reduce(std::span<const T>(partial), identity, op);
+}
+} // namespace swarm
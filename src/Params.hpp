@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <functional>
 #include <type_traits>
 namespace swarm {
 /**
@@ -25,7 +27,15 @@ struct ITaskParams : public IParams {
 struct EmptyTaskParams : public ITaskParams {
   EmptyTaskParams() = default;
   ~EmptyTaskParams() = default;
+  bool operator==(const EmptyTaskParams &) const { return true; }
 };
+} // namespace swarm
+
+template <> struct std::hash<swarm::EmptyTaskParams> {
+  std::size_t operator()(const swarm::EmptyTaskParams &) const { return 0; }
+};
+
+namespace swarm {
 
 /**
  * @brief Link to global params. When you need the same params for many
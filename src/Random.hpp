@@ -1,3 +1,6 @@
+#pragma once
+#include <cstdint>
+#include <limits>
 #include <random>
 namespace swarm {
 class SwarmStaticRandom {
@@ -9,4 +12,45 @@ public:
     return std::uniform_real_distribution<>(min, max)(gen);
   }
 };
+
+/**
+ * @brief Random stream of one unit, selected by a swarm-wide seed and the
+ * index of the unit. Units drawing only from their own stream get the same
+ * numbers whatever thread runs them and in whatever order, unlike with the
+ * shared SwarmStaticRandom.
+ *
+ * SplitMix64 started from a hash of (seed, stream); rnd() uses the upper 53
+ * bits, so its values do not depend on the standard library either. Meets
+ * UniformRandomBitGenerator for the <random> distributions.
+ */
+class RandomStream {
+  std::uint64_t _state;
+
+  static constexpr std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+public:
+  using result_type = std::uint64_t;
+
+  explicit RandomStream(std::uint64_t seed = 0, std::uint64_t stream = 0)
+      : _state(mix(mix(seed) + stream * 0x9e3779b97f4a7c15ull)) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+  result_type operator()() {
+    return mix(_state += 0x9e3779b97f4a7c15ull);
+  }
+  /**
+   * @brief uniform in [min, max)
+   */
+  double rnd(double min = 0, double max = 1) {
+    const double u = static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    return min + (max - min) * u;
+  }
+};
 } // namespace swarm
@@ -0,0 +1,990 @@
+#pragma once
+#include "Parallel.hpp"
+#include "SwarmService.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+template <std::size_t D, class T = double> using SpatialPoint = std::array<T, D>;
+
+namespace detail {
+template <std::size_t D, class T>
+T squared_distance(const std::array<T, D> &a, const std::array<T, D> &b) {
+  T sum = 0;
+  for (std::size_t d = 0; d < D; ++d) {
+    const T diff = a[d] - b[d];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+/**
+ * @brief The k smallest (squared distance, id) pairs offered so far, kept as
+ * a max-heap in the caller's vector
+ */
+template <class T> class NearestHeap {
+  std::vector<std::pair<T, std::uint32_t>> &_best;
+  std::size_t _k;
+
+public:
+  NearestHeap(std::vector<std::pair<T, std::uint32_t>> &best, std::size_t k)
+      : _best(best), _k(k) {
+    _best.clear();
+  }
+  bool full() const { return _best.size() >= _k; }
+  T bound() const {
+    return _best.size() < _k ? std::numeric_limits<T>::infinity()
+                             : _best.front().first;
+  }
+  void offer(T squared, std::uint32_t id) {
+    const std::pair<T, std::uint32_t> candidate{squared, id};
+    if (_best.size() < _k) {
+      _best.push_back(candidate);
+      std::push_heap(_best.begin(), _best.end());
+    } else if (candidate < _best.front()) {
+      std::pop_heap(_best.begin(), _best.end());
+      _best.back() = candidate;
+      std::push_heap(_best.begin(), _best.end());
+    }
+  }
+  /**
+   * @brief sort the result by distance, then id
+   */
+  void finish() { std::sort_heap(_best.begin(), _best.end()); }
+};
+} // namespace detail
+
+/**
+ * @brief Uniform grid (cell lists) over a set of points, best for dense,
+ * evenly spread swarms. Points are stored grouped by cell, cells in row-major
+ * order along dimension 0, so a query scans whole rows of cells as contiguous
+ * memory.
+ *
+ * @tparam D - number of dimensions
+ * @tparam T - coordinate type
+ */
+template <std::size_t D, class T = double> class UniformGrid {
+public:
+  using Point = SpatialPoint<D, T>;
+  using Index = std::uint32_t;
+
+private:
+  T _requested;
+  T _cell = 1;
+  Point _origin{};
+  std::array<std::size_t, D> _side{};
+  std::array<std::size_t, D> _stride{};
+  std::vector<std::size_t> _start{0, 0}; // cell -> first slot
+  std::vector<Index> _ids;               // slot -> point id
+  std::vector<Point> _points;            // slot -> position
+
+public:
+  /**
+   * @param cell_size - edge of a cell, typically the query radius; 0 - about
+   * one point per cell. It is enlarged when the points are so spread out that
+   * the grid would have more than 2 cells per point.
+   */
+  explicit UniformGrid(T cell_size = 0) : _requested(cell_size) {
+    _side.fill(1);
+    _stride.fill(1);
+  }
+
+  void build(std::span<const Point> points) {
+    const std::size_t n = points.size();
+    Point lo{}, hi{};
+    if (n > 0)
+      lo = hi = points[0];
+    for (const Point &p : points) {
+      for (std::size_t d = 0; d < D; ++d) {
+        lo[d] = std::min(lo[d], p[d]);
+        hi[d] = std::max(hi[d], p[d]);
+      }
+    }
+    T widest = 0;
+    for (std::size_t d = 0; d < D; ++d)
+      widest = std::max(widest, hi[d] - lo[d]);
+    _origin = lo;
+    _cell = _requested > 0 ? _requested
+                           : widest / std::pow(static_cast<T>(std::max<std::size_t>(n, 1)),
+                                               T(1) / static_cast<T>(D));
+    if (!(_cell > 0))
+      _cell = 1;
+    auto cells = [&](T cell) {
+      double total = 1;
+      for (std::size_t d = 0; d < D; ++d)
+        total *= std::floor(static_cast<double>((hi[d] - lo[d]) / cell)) + 1;
+      return total;
+    };
+    while (cells(_cell) > 2.0 * static_cast<double>(n) + 1.0)
+      _cell *= 2;
+    std::size_t total = 1;
+    for (std::size_t d = 0; d < D; ++d) {
+      _side[d] = static_cast<std::size_t>((hi[d] - lo[d]) / _cell) + 1;
+      _stride[d] = total;
+      total *= _side[d];
+    }
+
+    // Counting sort of the points by cell
+    std::vector<std::size_t> cell_of(n);
+    _start.assign(total + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+      cell_of[i] = linear(cell_coords(points[i]));
+      ++_start[cell_of[i] + 1];
+    }
+    std::partial_sum(_start.begin(), _start.end(), _start.begin());
+    _ids.resize(n);
+    _points.resize(n);
+    std::vector<std::size_t> fill(_start.begin(), _start.end() - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t slot = fill[cell_of[i]]++;
+      _ids[slot] = static_cast<Index>(i);
+      _points[slot] = points[i];
+    }
+  }
+
+  std::size_t size() const { return _ids.size(); }
+  T cell_size() const { return _cell; }
+
+  /**
+   * @brief Call f(id, squared_distance) for every point within `radius` of q
+   */
+  template <class F>
+  void for_each_in_radius(const Point &q, T radius, F &&f) const {
+    if (_ids.empty())
+      return;
+    const T r2 = radius * radius;
+    std::array<std::ptrdiff_t, D> lo, hi;
+    for (std::size_t d = 0; d < D; ++d) {
+      const T a = std::floor((q[d] - radius - _origin[d]) / _cell);
+      const T b = std::floor((q[d] + radius - _origin[d]) / _cell);
+      if (b < 0 || a >= static_cast<T>(_side[d]))
+        return;
+      lo[d] = a < 0 ? 0 : static_cast<std::ptrdiff_t>(a);
+      hi[d] = std::min(static_cast<std::ptrdiff_t>(_side[d]) - 1,
+                       static_cast<std::ptrdiff_t>(b));
+    }
+    for_each_row(lo, hi, [&](std::size_t row) {
+      const std::size_t end = _start[row + static_cast<std::size_t>(hi[0]) + 1];
+      for (std::size_t s = _start[row + static_cast<std::size_t>(lo[0])]; s < end; ++s) {
+        const T d2 = detail::squared_distance(_points[s], q);
+        if (d2 <= r2)
+          f(_ids[s], d2);
+      }
+    });
+  }
+
+  /**
+   * @brief The k points nearest to q as (squared distance, id), nearest
+   * first. Searches rings of cells around q until no closer point can remain.
+   */
+  void k_nearest(const Point &q, std::size_t k,
+                 std::vector<std::pair<T, Index>> &out) const {
+    detail::NearestHeap<T> heap(out, std::min(k, _ids.size()));
+    if (heap.full())
+      return;
+    const auto center = cell_coords(q);
+    std::ptrdiff_t rings = 0;
+    for (std::size_t d = 0; d < D; ++d)
+      rings = std::max(rings, static_cast<std::ptrdiff_t>(_side[d]));
+    auto scan = [&](std::size_t first, std::size_t last) {
+      for (std::size_t s = _start[first]; s < _start[last + 1]; ++s)
+        heap.offer(detail::squared_distance(_points[s], q), _ids[s]);
+    };
+    for (std::ptrdiff_t ring = 0; ring < rings; ++ring) {
+      // Points outside the rings searched so far are at least this far away
+      const T reach = static_cast<T>(std::max<std::ptrdiff_t>(ring - 1, 0)) * _cell;
+      if (heap.full() && heap.bound() <= reach * reach)
+        break;
+      std::array<std::ptrdiff_t, D> lo, hi;
+      for (std::size_t d = 0; d < D; ++d) {
+        const auto c = static_cast<std::ptrdiff_t>(center[d]);
+        lo[d] = std::max<std::ptrdiff_t>(c - ring, 0);
+        hi[d] = std::min(c + ring, static_cast<std::ptrdiff_t>(_side[d]) - 1);
+      }
+      const auto c0 = static_cast<std::ptrdiff_t>(center[0]);
+      for_each_row(lo, hi, [&](std::size_t row, bool on_ring) {
+        // A row on the ring shell is scanned whole, other rows only at its ends
+        if (on_ring || ring == 0) {
+          scan(row + static_cast<std::size_t>(lo[0]), row + static_cast<std::size_t>(hi[0]));
+          return;
+        }
+        if (c0 - ring >= 0)
+          scan(row + static_cast<std::size_t>(c0 - ring), row + static_cast<std::size_t>(c0 - ring));
+        if (c0 + ring < static_cast<std::ptrdiff_t>(_side[0]))
+          scan(row + static_cast<std::size_t>(c0 + ring), row + static_cast<std::size_t>(c0 + ring));
+      }, center, ring);
+    }
+    heap.finish();
+  }
+
+private:
+  std::array<std::size_t, D> cell_coords(const Point &p) const {
+    std::array<std::size_t, D> c;
+    for (std::size_t d = 0; d < D; ++d) {
+      const T x = (p[d] - _origin[d]) / _cell;
+      c[d] = x <= 0 ? 0 : std::min(_side[d] - 1, static_cast<std::size_t>(x));
+    }
+    return c;
+  }
+  std::size_t linear(const std::array<std::size_t, D> &c) const {
+    std::size_t index = 0;
+    for (std::size_t d = 0; d < D; ++d)
+      index += c[d] * _stride[d];
+    return index;
+  }
+
+  /**
+   * @brief Call f(first cell of the row) for every row along dimension 0 of
+   * the box [lo, hi] over dimensions 1 .. D-1
+   */
+  template <class F>
+  void for_each_row(const std::array<std::ptrdiff_t, D> &lo,
+                    const std::array<std::ptrdiff_t, D> &hi, F &&f) const {
+    for_each_row(lo, hi, [&f](std::size_t row, bool) { f(row); }, {}, 0);
+  }
+  /**
+   * @brief Same, also telling whether the row lies on the shell of the cube of
+   * cells at Chebyshev distance `ring` from `center`
+   */
+  template <class F>
+  void for_each_row(const std::array<std::ptrdiff_t, D> &lo,
+                    const std::array<std::ptrdiff_t, D> &hi, F &&f,
+                    const std::array<std::size_t, D> &center,
+                    std::ptrdiff_t ring) const {
+    std::array<std::ptrdiff_t, D> c = lo;
+    for (;;) {
+      std::size_t row = 0;
+      bool on_ring = false;
+      for (std::size_t d = 1; d < D; ++d) {
+        row += static_cast<std::size_t>(c[d]) * _stride[d];
+        const auto offset = c[d] - static_cast<std::ptrdiff_t>(center[d]);
+        on_ring = on_ring || offset == ring || offset == -ring;
+      }
+      f(row, on_ring);
+      std::size_t d = 1;
+      for (; d < D; ++d) {
+        if (c[d] < hi[d]) {
+          ++c[d];
+          break;
+        }
+        c[d] = lo[d];
+      }
+      if (d >= D)
+        return;
+    }
+  }
+};
+
+/**
+ * @brief k-d tree over a set of points, for sparse or clustered swarms where
+ * a uniform grid would be mostly empty. Splits at the median of the widest
+ * dimension down to leaves of LeafSize points; points are stored in leaf
+ * order.
+ *
+ * @tparam D - number of dimensions
+ * @tparam T - coordinate type
+ */
+template <std::size_t D, class T = double> class KdTree {
+public:
+  using Point = SpatialPoint<D, T>;
+  using Index = std::uint32_t;
+  static constexpr std::size_t LeafSize = 16;
+
+private:
+  struct Node {
+    T split;
+    std::uint32_t dim;
+    std::uint32_t begin, end; // slots
+    std::uint32_t left = 0, right = 0; // 0 - leaf (the root is never a child)
+  };
+  std::vector<Node> _nodes;
+  std::vector<Index> _ids;
+  std::vector<Point> _points;
+
+public:
+  void build(std::span<const Point> points) {
+    _nodes.clear();
+    _ids.resize(points.size());
+    std::iota(_ids.begin(), _ids.end(), Index(0));
+    if (!points.empty())
+      build_node(points, 0, static_cast<std::uint32_t>(points.size()));
+    _points.resize(points.size());
+    for (std::size_t s = 0; s < _ids.size(); ++s)
+      _points[s] = points[_ids[s]];
+  }
+
+  std::size_t size() const { return _ids.size(); }
+
+  /**
+   * @brief Call f(id, squared_distance) for every point within `radius` of q
+   */
+  template <class F>
+  void for_each_in_radius(const Point &q, T radius, F &&f) const {
+    if (_nodes.empty())
+      return;
+    const T r2 = radius * radius;
+    std::uint32_t stack[64];
+    std::size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const Node &node = _nodes[stack[--top]];
+      if (node.left == 0) {
+        for (std::uint32_t s = node.begin; s < node.end; ++s) {
+          const T d2 = detail::squared_distance(_points[s], q);
+          if (d2 <= r2)
+            f(_ids[s], d2);
+        }
+        continue;
+      }
+      const T diff = q[node.dim] - node.split;
+      if (diff * diff <= r2)
+        stack[top++] = diff < 0 ? node.right : node.left;
+      stack[top++] = diff < 0 ? node.left : node.right;
+    }
+  }
+
+  /**
+   * @brief The k points nearest to q as (squared distance, id), nearest first
+   */
+  void k_nearest(const Point &q, std::size_t k,
+                 std::vector<std::pair<T, Index>> &out) const {
+    detail::NearestHeap<T> heap(out, std::min(k, _ids.size()));
+    if (heap.full())
+      return;
+    nearest(0, q, heap);
+    heap.finish();
+  }
+
+private:
+  std::uint32_t build_node(std::span<const Point> points, std::uint32_t begin,
+                           std::uint32_t end) {
+    const auto index = static_cast<std::uint32_t>(_nodes.size());
+    _nodes.push_back({T(0), 0, begin, end});
+    if (end - begin <= LeafSize)
+      return index;
+    Point lo = points[_ids[begin]], hi = lo;
+    for (std::uint32_t s = begin; s < end; ++s) {
+      const Point &p = points[_ids[s]];
+      for (std::size_t d = 0; d < D; ++d) {
+        lo[d] = std::min(lo[d], p[d]);
+        hi[d] = std::max(hi[d], p[d]);
+      }
+    }
+    std::uint32_t dim = 0;
+    for (std::uint32_t d = 1; d < D; ++d) {
+      if (hi[d] - lo[d] > hi[dim] - lo[dim])
+        dim = d;
+    }
+    const std::uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(_ids.begin() + begin, _ids.begin() + mid, _ids.begin() + end,
+                     [&](Index a, Index b) { return points[a][dim] < points[b][dim]; });
+    const T split = points[_ids[mid]][dim];
+    const std::uint32_t left = build_node(points, begin, mid);
+    const std::uint32_t right = build_node(points, mid, end);
+    Node &node = _nodes[index];
+    node.split = split;
+    node.dim = dim;
+    node.left = left;
+    node.right = right;
+    return index;
+  }
+
+  void nearest(std::uint32_t index, const Point &q, detail::NearestHeap<T> &heap) const {
+    const Node &node = _nodes[index];
+    if (node.left == 0) {
+      for (std::uint32_t s = node.begin; s < node.end; ++s)
+        heap.offer(detail::squared_distance(_points[s], q), _ids[s]);
+      return;
+    }
+    const T diff = q[node.dim] - node.split;
+    nearest(diff < 0 ? node.left : node.right, q, heap);
+    if (diff * diff <= heap.bound())
+      nearest(diff < 0 ? node.right : node.left, q, heap);
+  }
+};
+
+/**
+ * @brief Spatial hash over a set of points: cells of an unbounded grid kept
+ * in a hash table, only occupied cells exist, so the swarm may spread over any
+ * area. Unlike UniformGrid it is updated in place: update() re-buckets only
+ * the points that crossed a cell boundary and refreshes the others where they
+ * are.
+ *
+ * @tparam D - number of dimensions
+ * @tparam T - coordinate type
+ */
+template <std::size_t D, class T = double> class SpatialHash {
+public:
+  using Point = SpatialPoint<D, T>;
+  using Index = std::uint32_t;
+
+private:
+  using Key = std::array<std::int64_t, D>;
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const {
+      std::uint64_t h = 0;
+      for (const auto c : key)
+        h = (h ^ static_cast<std::uint64_t>(c)) * 0x9E3779B97F4A7C15ull;
+      return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+  };
+  struct Member {
+    Point position;
+    Index id;
+  };
+  // Positions are stored with the ids, so a query reads each cell as one block
+  struct Cell {
+    Key key;
+    std::vector<Member> members;
+  };
+  T _cell;
+  std::vector<Cell> _cells; // emptied cells are kept for reuse, see update()
+  std::unordered_map<Key, std::uint32_t, KeyHash> _lookup;
+  std::size_t _empty = 0; // emptied cells in _cells
+  std::size_t _size = 0;
+  std::vector<std::uint32_t> _cell_of; // point -> cell
+  std::vector<std::uint32_t> _slot_of; // point -> position in its cell
+  Key _lo{}, _hi{};                    // occupied key range
+
+public:
+  /**
+   * @param cell_size - edge of a cell, typically the query radius
+   */
+  explicit SpatialHash(T cell_size = 1) : _cell(cell_size > 0 ? cell_size : T(1)) {}
+
+  void build(std::span<const Point> points) {
+    _cells.clear();
+    _lookup.clear();
+    _empty = 0;
+    _size = points.size();
+    _cell_of.resize(points.size());
+    _slot_of.resize(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i)
+      insert(static_cast<Index>(i), points[i], key_of(points[i]));
+    update_range();
+  }
+
+  /**
+   * @brief Take new positions of the same points, moving only those whose
+   * cell changed. Falls back to build() if the number of points changed.
+   * Cells left empty are kept for points coming back, until they are a
+   * quarter of the table; then they are dropped.
+   *
+   * @return number of points moved to another cell
+   */
+  std::size_t update(std::span<const Point> points) {
+    if (points.size() != _size) {
+      build(points);
+      return points.size();
+    }
+    std::size_t moved = 0;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      const Key key = key_of(points[i]);
+      Cell &cell = _cells[_cell_of[i]];
+      if (key == cell.key) {
+        cell.members[_slot_of[i]].position = points[i];
+        continue;
+      }
+      erase(static_cast<Index>(i));
+      insert(static_cast<Index>(i), points[i], key);
+      ++moved;
+    }
+    if (4 * _empty > _cells.size())
+      compact();
+    if (moved > 0)
+      update_range();
+    return moved;
+  }
+
+  std::size_t size() const { return _size; }
+  T cell_size() const { return _cell; }
+  /**
+   * @brief number of cells in the table, emptied ones included
+   */
+  std::size_t cells() const { return _cells.size(); }
+
+  /**
+   * @brief Call f(id, squared_distance) for every point within `radius` of q
+   */
+  template <class F>
+  void for_each_in_radius(const Point &q, T radius, F &&f) const {
+    if (_size == 0)
+      return;
+    const T r2 = radius * radius;
+    Key lo, hi;
+    for (std::size_t d = 0; d < D; ++d) {
+      lo[d] = std::max(_lo[d], coordinate(q[d] - radius));
+      hi[d] = std::min(_hi[d], coordinate(q[d] + radius));
+      if (lo[d] > hi[d])
+        return;
+    }
+    for_each_cell(lo, hi, [&](const Cell &cell) {
+      for (const Member &m : cell.members) {
+        const T d2 = detail::squared_distance(m.position, q);
+        if (d2 <= r2)
+          f(m.id, d2);
+      }
+    });
+  }
+
+  /**
+   * @brief The k points nearest to q as (squared distance, id), nearest first
+   */
+  void k_nearest(const Point &q, std::size_t k,
+                 std::vector<std::pair<T, Index>> &out) const {
+    detail::NearestHeap<T> heap(out, std::min(k, _size));
+    if (heap.full())
+      return;
+    const Key center = key_of(q);
+    std::int64_t rings = 0;
+    for (std::size_t d = 0; d < D; ++d)
+      rings = std::max({rings, center[d] - _lo[d], _hi[d] - center[d]});
+    for (std::int64_t ring = 0; ring <= rings; ++ring) {
+      const T reach = static_cast<T>(std::max<std::int64_t>(ring - 1, 0)) * _cell;
+      if (heap.full() && heap.bound() <= reach * reach)
+        break;
+      Key lo, hi;
+      for (std::size_t d = 0; d < D; ++d) {
+        lo[d] = std::max(_lo[d], center[d] - ring);
+        hi[d] = std::min(_hi[d], center[d] + ring);
+      }
+      for_each_cell(lo, hi, [&](const Cell &cell) {
+        bool on_ring = false;
+        for (std::size_t d = 0; d < D; ++d)
+          on_ring = on_ring || cell.key[d] - center[d] == ring ||
+                    center[d] - cell.key[d] == ring;
+        if (!on_ring)
+          return;
+        for (const Member &m : cell.members)
+          heap.offer(detail::squared_distance(m.position, q), m.id);
+      });
+    }
+    heap.finish();
+  }
+
+private:
+  std::int64_t coordinate(T x) const {
+    return static_cast<std::int64_t>(std::floor(x / _cell));
+  }
+  Key key_of(const Point &p) const {
+    Key key;
+    for (std::size_t d = 0; d < D; ++d)
+      key[d] = coordinate(p[d]);
+    return key;
+  }
+  void insert(Index i, const Point &position, const Key &key) {
+    const auto [it, added] =
+        _lookup.try_emplace(key, static_cast<std::uint32_t>(_cells.size()));
+    if (added)
+      _cells.push_back({key, {}});
+    auto &members = _cells[it->second].members;
+    if (!added && members.empty())
+      --_empty;
+    _cell_of[i] = it->second;
+    _slot_of[i] = static_cast<std::uint32_t>(members.size());
+    members.push_back({position, i});
+  }
+  void erase(Index i) {
+    auto &members = _cells[_cell_of[i]].members;
+    const Member last = members.back();
+    members[_slot_of[i]] = last;
+    _slot_of[last.id] = _slot_of[i];
+    members.pop_back();
+    if (members.empty())
+      ++_empty;
+  }
+  /**
+   * @brief Drop the emptied cells, keeping the order of the others
+   */
+  void compact() {
+    std::size_t kept = 0;
+    for (std::size_t c = 0; c < _cells.size(); ++c) {
+      if (_cells[c].members.empty()) {
+        _lookup.erase(_cells[c].key);
+        continue;
+      }
+      if (kept != c)
+        _cells[kept] = std::move(_cells[c]);
+      const auto index = static_cast<std::uint32_t>(kept++);
+      _lookup.find(_cells[index].key)->second = index;
+      for (const Member &m : _cells[index].members)
+        _cell_of[m.id] = index;
+    }
+    _cells.resize(kept);
+    _empty = 0;
+  }
+  void update_range() {
+    _lo.fill(std::numeric_limits<std::int64_t>::max());
+    _hi.fill(std::numeric_limits<std::int64_t>::min());
+    for (const Cell &cell : _cells) {
+      if (cell.members.empty())
+        continue;
+      for (std::size_t d = 0; d < D; ++d) {
+        _lo[d] = std::min(_lo[d], cell.key[d]);
+        _hi[d] = std::max(_hi[d], cell.key[d]);
+      }
+    }
+  }
+
+  /**
+   * @brief Call f(cell) for every occupied cell with a key in [lo, hi]. Walks
+   * the box when it has fewer cells than the table, the table otherwise.
+   */
+  template <class F> void for_each_cell(const Key &lo, const Key &hi, F &&f) const {
+    double box = 1;
+    for (std::size_t d = 0; d < D; ++d)
+      box *= static_cast<double>(hi[d] - lo[d] + 1);
+    if (box > static_cast<double>(_cells.size())) {
+      for (const Cell &cell : _cells) {
+        bool inside = !cell.members.empty();
+        for (std::size_t d = 0; d < D && inside; ++d)
+          inside = lo[d] <= cell.key[d] && cell.key[d] <= hi[d];
+        if (inside)
+          f(cell);
+      }
+      return;
+    }
+    Key c = lo;
+    for (;;) {
+      if (const auto it = _lookup.find(c); it != _lookup.end())
+        f(_cells[it->second]);
+      std::size_t d = 0;
+      for (; d < D; ++d) {
+        if (c[d] < hi[d]) {
+          ++c[d];
+          break;
+        }
+        c[d] = lo[d];
+      }
+      if (d == D)
+        return;
+    }
+  }
+};
+
+/**
+ * @brief Neighbors of every point, CSR-style: the neighbors of point i are
+ * indices[offsets[i] .. offsets[i + 1])
+ */
+struct NeighborLists {
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::uint32_t> indices;
+
+  std::size_t size() const { return offsets.size() - 1; }
+  std::span<const std::uint32_t> operator[](std::size_t i) const {
+    return {indices.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+};
+
+namespace detail {
+/**
+ * @brief Run query(i, worker, out) for every point on the pool and concatenate
+ * the per-point results in point order
+ */
+template <class Query>
+NeighborLists gather_neighbors(std::size_t n, ThreadPool &pool, Query &&query) {
+  NeighborLists lists;
+  lists.offsets.assign(n + 1, 0);
+  std::vector<std::vector<std::uint32_t>> found(pool.size());
+  pool.parallel_for(n, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+    auto &out = found[worker];
+    out.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+      const std::size_t before = out.size();
+      query(i, worker, out);
+      lists.offsets[i + 1] = out.size() - before;
+    }
+  });
+  std::partial_sum(lists.offsets.begin(), lists.offsets.end(), lists.offsets.begin());
+  lists.indices.resize(lists.offsets.back());
+  pool.run([&](std::size_t worker) {
+    const auto [begin, end] = ThreadPool::block(n, pool.size(), worker);
+    if (begin < end)
+      std::copy(found[worker].begin(), found[worker].end(),
+                lists.indices.begin() + static_cast<std::ptrdiff_t>(lists.offsets[begin]));
+  });
+  return lists;
+}
+} // namespace detail
+
+/**
+ * @brief All points within `radius` of every point, the point itself
+ * excluded, queried in parallel
+ *
+ * @param index - built from `points`
+ */
+template <class IndexT>
+NeighborLists radius_neighbors(const IndexT &index,
+                               std::span<const typename IndexT::Point> points,
+                               typename IndexT::Point::value_type radius,
+                               ThreadPool &pool) {
+  return detail::gather_neighbors(points.size(), pool, [&](std::size_t i, std::size_t, auto &out) {
+    index.for_each_in_radius(points[i], radius, [&](std::uint32_t j, auto) {
+      if (j != i)
+        out.push_back(j);
+    });
+  });
+}
+
+/**
+ * @brief The k nearest other points of every point, nearest first, queried
+ * in parallel
+ *
+ * @param index - built from `points`
+ */
+template <class IndexT>
+NeighborLists k_nearest_neighbors(const IndexT &index,
+                                  std::span<const typename IndexT::Point> points,
+                                  std::size_t k, ThreadPool &pool) {
+  using T = typename IndexT::Point::value_type;
+  std::vector<std::vector<std::pair<T, std::uint32_t>>> best(pool.size());
+  return detail::gather_neighbors(points.size(), pool, [&](std::size_t i, std::size_t worker, auto &out) {
+    // Ask for one more: the point itself, unless duplicates push it out
+    auto &nearest = best[worker];
+    index.k_nearest(points[i], k + 1, nearest);
+    std::size_t taken = 0;
+    for (const auto &[d2, j] : nearest) {
+      if (j != i && taken < k) {
+        out.push_back(j);
+        ++taken;
+      }
+    }
+  });
+}
+
+/**
+ * @brief The k nearest indexed points of every query point, nearest first,
+ * queried in parallel. Unlike k_nearest_neighbors, the queries are a point
+ * set of their own, e.g. units looking for the nearest tasks.
+ */
+template <class IndexT>
+NeighborLists k_nearest_of(const IndexT &index,
+                           std::span<const typename IndexT::Point> queries,
+                           std::size_t k, ThreadPool &pool) {
+  using T = typename IndexT::Point::value_type;
+  std::vector<std::vector<std::pair<T, std::uint32_t>>> best(pool.size());
+  return detail::gather_neighbors(queries.size(), pool, [&](std::size_t i, std::size_t worker, auto &out) {
+    auto &nearest = best[worker];
+    index.k_nearest(queries[i], k, nearest);
+    for (const auto &[d2, j] : nearest)
+      out.push_back(j);
+  });
+}
+
+/**
+ * @brief Verlet neighbor lists: candidates within radius + skin, built with a
+ * spatial index and kept until some point has moved more than skin / 2 since
+ * the build. Until then every pair closer than radius is still in the lists,
+ * so a step only filters candidates instead of querying the index.
+ *
+ * Internally points are ranked in cell order at every build and the lists
+ * and positions are kept by rank, so filtering the candidates of a point
+ * reads nearby memory whatever the ids of the units are.
+ *
+ * @tparam D - number of dimensions
+ * @tparam T - coordinate type
+ */
+template <std::size_t D, class T = double> class VerletNeighborLists {
+public:
+  using Point = SpatialPoint<D, T>;
+
+private:
+  T _radius;
+  T _skin;
+  NeighborLists _lists;                // by rank
+  std::vector<std::uint32_t> _order;   // rank -> id
+  std::vector<std::uint32_t> _rank;    // id -> rank
+  std::vector<Point> _reference;       // by rank, positions at the last build
+  std::vector<Point> _current;         // by rank, positions at the last update
+  std::size_t _builds = 0;
+
+public:
+  VerletNeighborLists(T radius, T skin) : _radius(radius), _skin(skin) {}
+
+  T radius() const { return _radius; }
+  T skin() const { return _skin; }
+  /**
+   * @brief number of times the lists were built
+   */
+  std::size_t builds() const { return _builds; }
+
+  /**
+   * @brief Take the new positions and rebuild the lists if some point moved
+   * more than skin / 2 since the last build
+   *
+   * @param index - built from `points`
+   * @return true if the lists were rebuilt
+   */
+  template <class IndexT>
+  bool update(const IndexT &index, std::span<const Point> points, ThreadPool &pool) {
+    bool stale = points.size() != _order.size();
+    if (!stale) {
+      const T limit = _skin * _skin / 4;
+      for (std::size_t r = 0; r < _order.size(); ++r) {
+        _current[r] = points[_order[r]];
+        stale = stale || detail::squared_distance(_current[r], _reference[r]) > limit;
+      }
+    }
+    if (!stale)
+      return false;
+    build(index, points, pool);
+    return true;
+  }
+
+  /**
+   * @brief Call f(id, squared_distance) for every other point within radius
+   * of point `id`, as of the last update()
+   */
+  template <class F> void for_each_neighbor(std::size_t id, F &&f) const {
+    const T r2 = _radius * _radius;
+    const std::uint32_t rank = _rank[id];
+    const Point &p = _current[rank];
+    for (const std::uint32_t other : _lists[rank]) {
+      const T d2 = detail::squared_distance(p, _current[other]);
+      if (d2 <= r2)
+        f(_order[other], d2);
+    }
+  }
+
+private:
+  template <class IndexT>
+  void build(const IndexT &index, std::span<const Point> points, ThreadPool &pool) {
+    const std::size_t n = points.size();
+    // Rank by cell of edge radius + skin, last dimension major
+    const T cell = _radius + _skin > 0 ? _radius + _skin : T(1);
+    std::vector<std::pair<std::array<std::int64_t, D>, std::uint32_t>> keyed(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t d = 0; d < D; ++d)
+        keyed[i].first[D - 1 - d] = static_cast<std::int64_t>(std::floor(points[i][d] / cell));
+      keyed[i].second = static_cast<std::uint32_t>(i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+    _order.resize(n);
+    _rank.resize(n);
+    _current.resize(n);
+    for (std::size_t r = 0; r < n; ++r) {
+      _order[r] = keyed[r].second;
+      _rank[_order[r]] = static_cast<std::uint32_t>(r);
+      _current[r] = points[_order[r]];
+    }
+    _reference = _current;
+    const T reach = _radius + _skin;
+    _lists = detail::gather_neighbors(n, pool, [&](std::size_t r, std::size_t, auto &out) {
+      index.for_each_in_radius(_current[r], reach, [&](std::uint32_t id, T) {
+        if (_rank[id] != r)
+          out.push_back(_rank[id]);
+      });
+    });
+    ++_builds;
+  }
+};
+
+/**
+ * @brief Positions of the units of a swarm with a spatial index over them.
+ * During a step every unit writes only its own position and queries the index
+ * built at the last step barrier, so units running in parallel need no
+ * synchronization and all see the same snapshot. Attached to a Swarm, the
+ * index is brought up to date at the end of every iter(): incrementally if
+ * IndexT has update() (SpatialHash), rebuilt otherwise.
+ *
+ * With track_neighbors() the service also keeps Verlet neighbor lists, so
+ * for_each_neighbor() costs a scan of a few candidates and the lists are only
+ * rebuilt when units have moved far enough.
+ *
+ * @tparam IndexT - UniformGrid for dense swarms, KdTree for sparse ones,
+ * SpatialHash for slowly moving ones
+ */
+template <class IndexT> class UnitSpatialIndex : public ISwarmService {
+public:
+  using Point = typename IndexT::Point;
+  using Id = std::uint32_t;
+  using Scalar = typename Point::value_type;
+
+private:
+  std::vector<Point> _positions;
+  std::vector<Point> _snapshot; // positions at the last barrier
+  IndexT _index;
+  std::optional<VerletNeighborLists<std::tuple_size_v<Point>, Scalar>> _lists;
+  ThreadPool *_pool = nullptr;
+  std::unique_ptr<ThreadPool> _serial;
+
+public:
+  explicit UnitSpatialIndex(IndexT index = IndexT()) : _index(std::move(index)) {}
+
+  /**
+   * @brief Register a unit, between steps
+   */
+  Id add(const Point &position) {
+    _positions.push_back(position);
+    return static_cast<Id>(_positions.size() - 1);
+  }
+  std::size_t size() const { return _positions.size(); }
+  void set_position(Id id, const Point &position) { _positions[id] = position; }
+  const Point &position(Id id) const { return _positions[id]; }
+  const std::vector<Point> &positions() const { return _positions; }
+
+  /**
+   * @brief Keep Verlet neighbor lists for `radius`
+   *
+   * @param skin - extra distance covered by the lists, about twice the
+   * distance a unit moves between rebuilds
+   * @param pool - runs the list builds, nullptr - the calling thread
+   */
+  void track_neighbors(Scalar radius, Scalar skin, ThreadPool *pool = nullptr) {
+    _lists.emplace(radius, skin);
+    _pool = pool;
+  }
+  const VerletNeighborLists<std::tuple_size_v<Point>, Scalar> &neighbor_lists() const {
+    return *_lists;
+  }
+  /**
+   * @brief Call f(id, squared_distance) for every other unit within the
+   * tracked radius of unit `id`, as of the last barrier
+   */
+  template <class F> void for_each_neighbor(Id id, F &&f) const {
+    _lists->for_each_neighbor(id, std::forward<F>(f));
+  }
+
+  /**
+   * @brief the index as of the last rebuild()
+   */
+  const IndexT &index() const { return _index; }
+  template <class F>
+  void for_each_in_radius(const Point &q, Scalar radius, F &&f) const {
+    _index.for_each_in_radius(q, radius, std::forward<F>(f));
+  }
+  void k_nearest(const Point &q, std::size_t k,
+                 std::vector<std::pair<Scalar, Id>> &out) const {
+    _index.k_nearest(q, k, out);
+  }
+
+  void rebuild() {
+    _snapshot = _positions;
+    if constexpr (requires { _index.update(std::span<const Point>(_snapshot)); })
+      _index.update(_snapshot);
+    else
+      _index.build(_snapshot);
+    if (!_lists)
+      return;
+    if (!_pool) {
+      if (!_serial)
+        _serial = std::make_unique<ThreadPool>(1);
+      _pool = _serial.get();
+    }
+    _lists->update(_index, std::span<const Point>(_snapshot), *_pool);
+  }
+  void end_step() override { rebuild(); }
+};
+} // namespace swarm
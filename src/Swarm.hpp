@@ -1,9 +1,14 @@
 #pragma once
+#include "Parallel.hpp"
 #include "Params.hpp"
+#include "SwarmCommands.hpp"
+#include "SwarmService.hpp"
 #include "SwarmUnit.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <span>
 #include <type_traits>
 #include <unordered_set>
 #include <vector>
@@ -42,6 +47,13 @@ public:
   ISwarmUnitsContainer() {}
   virtual ~ISwarmUnitsContainer() = default;
   virtual void add_unit(SwarmUnitLink<IUnitT> unit) = 0;
+  /**
+   * @brief Remove the units of `sorted` (ascending pointers) that are in the
+   * container, with no unit running
+   *
+   * @return number of units removed
+   */
+  virtual std::size_t remove_units(std::span<const IUnitT *const> sorted) = 0;
   virtual void for_each(std::function<void(IUnitT &)>) const = 0;
   virtual void init() = 0;
   virtual void iter() = 0;
@@ -49,12 +61,53 @@ public:
   virtual std::size_t reserved_size() const = 0;
 };
 
+/**
+ * @brief Slots of units in a std::vector. Removed units leave empty slots on
+ * a free list, which added units take first, so churn does not move the
+ * other units or grow the vector beyond the largest population.
+ */
+template <typename IUnitT> class SwarmUnitSlots {
+  std::vector<SwarmUnitLink<IUnitT>> units_;
+  std::vector<std::size_t> free_;
+
+public:
+  void reserve(std::size_t size) { units_.reserve(size); }
+  void add(SwarmUnitLink<IUnitT> unit) {
+    if (free_.empty()) {
+      units_.emplace_back(std::move(unit));
+      return;
+    }
+    units_[free_.back()] = std::move(unit);
+    free_.pop_back();
+  }
+  std::size_t remove(std::span<const IUnitT *const> sorted) {
+    if (sorted.empty())
+      return 0;
+    std::size_t removed = 0;
+    for (std::size_t i = 0; i < units_.size(); ++i) {
+      const IUnitT *unit = units_[i].get();
+      if (unit && std::binary_search(sorted.begin(), sorted.end(), unit)) {
+        units_[i].reset();
+        free_.push_back(i);
+        ++removed;
+      }
+    }
+    return removed;
+  }
+  /**
+   * @brief the slots, empty ones included
+   */
+  const std::vector<SwarmUnitLink<IUnitT>> &slots() const { return units_; }
+  std::size_t size() const { return units_.size() - free_.size(); }
+  std::size_t capacity() const { return units_.capacity(); }
+};
+
 /**
  * @brief Реализация контейнера на основе std::vector
  */
 template <typename IUnitT = ISwarmUnit>
 class SwarmVectorContainer : public ISwarmUnitsContainer<IUnitT> {
-  std::vector<SwarmUnitLink<IUnitT>> units_;
+  SwarmUnitSlots<IUnitT> units_;
 
 public:
   SwarmVectorContainer(std::size_t size)
@@ -64,29 +117,101 @@ public:
 
   SwarmVectorContainer() : ISwarmUnitsContainer<IUnitT>() {}
   void add_unit(SwarmUnitLink<IUnitT> unit) override {
-    units_.emplace_back(move(unit));
+    units_.add(std::move(unit));
+  }
+  std::size_t remove_units(std::span<const IUnitT *const> sorted) override {
+    return units_.remove(sorted);
   }
 
   void for_each(std::function<void(IUnitT &)> action) const override {
-    for (const auto &unit : units_) {
+    for (const auto &unit : units_.slots()) {
       if (unit)
         action(*unit);
     }
   }
   void init() override {
-    for (const auto &unit : units_) {
-      unit->init();
+    for (const auto &unit : units_.slots()) {
+      if (unit)
+        unit->init();
     }
   }
   void iter() override {
-    for (const auto &unit : units_) {
-      unit->iter();
+    for (const auto &unit : units_.slots()) {
+      if (unit)
+        unit->iter();
     }
   }
   std::size_t size() const override { return units_.size(); }
   std::size_t reserved_size() const override { return units_.capacity(); };
 };
 
+/**
+ * @brief std::vector container whose init() and iter() run the units on a
+ * ThreadPool. Units are split into contiguous blocks, one per worker, so they
+ * must not touch each other's state from init() or iter(); for_each stays
+ * serial and in insertion order.
+ */
+template <typename IUnitT = ISwarmUnit>
+class SwarmParallelVectorContainer : public ISwarmUnitsContainer<IUnitT> {
+  SwarmUnitSlots<IUnitT> units_;
+  std::unique_ptr<ThreadPool> pool_;
+
+public:
+  SwarmParallelVectorContainer(std::size_t size)
+      : ISwarmUnitsContainer<IUnitT>(size),
+        pool_(std::make_unique<ThreadPool>()) {
+    units_.reserve(size);
+  }
+  SwarmParallelVectorContainer()
+      : ISwarmUnitsContainer<IUnitT>(), pool_(std::make_unique<ThreadPool>()) {}
+
+  /**
+   * @brief Replace the pool by one with `threads` workers, 0 - one per
+   * hardware thread
+   */
+  void set_threads(std::size_t threads) {
+    pool_ = std::make_unique<ThreadPool>(threads);
+  }
+  /**
+   * @brief the pool the units run on, free for swarm-level work between
+   * init()/iter() calls
+   */
+  ThreadPool &pool() { return *pool_; }
+
+  void add_unit(SwarmUnitLink<IUnitT> unit) override {
+    units_.add(std::move(unit));
+  }
+  std::size_t remove_units(std::span<const IUnitT *const> sorted) override {
+    return units_.remove(sorted);
+  }
+  void for_each(std::function<void(IUnitT &)> action) const override {
+    for (const auto &unit : units_.slots()) {
+      if (unit)
+        action(*unit);
+    }
+  }
+  void init() override {
+    const auto &slots = units_.slots();
+    pool_->parallel_for(slots.size(), [&slots](std::size_t begin,
+                                               std::size_t end, std::size_t) {
+      for (std::size_t i = begin; i < end; ++i)
+        if (slots[i])
+          slots[i]->init();
+    });
+  }
+  void iter() override {
+    const auto &slots = units_.slots();
+    pool_->parallel_for(slots.size(), [&slots](std::size_t begin,
+                                               std::size_t end, std::size_t) {
+      for (std::size_t i = begin; i < end; ++i)
+        if (slots[i])
+          slots[i]->iter();
+    });
+  }
+  std::size_t size() const override { return units_.size(); }
+  std::size_t reserved_size() const override { return units_.capacity(); }
+};
+
 /**
  * @brief Реализация контейнера на основе std::unordered_set
  */
@@ -106,14 +231,23 @@ class SwarmUnorderedSetContainer : public ISwarmUnitsContainer<IUnitT> {
   };
 
   std::unordered_set<SwarmUnitLink<IUnitT>, Hash, Equal> units_;
+  std::size_t reserved_ = 0; // as requested, a set has no capacity
 
 public:
   SwarmUnorderedSetContainer(std::size_t size)
-      : units_(size), ISwarmUnitsContainer<IUnitT>(size) {}
+      : ISwarmUnitsContainer<IUnitT>(size), units_(size), reserved_(size) {}
   SwarmUnorderedSetContainer() : ISwarmUnitsContainer<IUnitT>() {}
   void add_unit(SwarmUnitLink<IUnitT> unit) override {
     units_.insert(std::move(unit));
   }
+  std::size_t remove_units(std::span<const IUnitT *const> sorted) override {
+    std::size_t removed = 0;
+    for (const IUnitT *unit : sorted)
+      // A non-owning link, compared by pointer
+      removed += units_.erase(SwarmUnitLink<IUnitT>(
+          std::shared_ptr<IUnitT>(), const_cast<IUnitT *>(unit)));
+    return removed;
+  }
 
   void for_each(std::function<void(IUnitT &)> action) const override {
     for (const auto &unit : units_) {
@@ -122,7 +256,9 @@ public:
     }
   }
   std::size_t size() const override { return units_.size(); }
-  std::size_t reserved_size() const override { return units_.capacity(); }
+  std::size_t reserved_size() const override {
+    return std::max(reserved_, units_.size());
+  }
   void init() override {
     for (const auto &unit : units_) {
       unit->init();
@@ -157,6 +293,8 @@ class Swarm : public Parameterizable<SwarmParamsT> {
 protected:
   SwarmUnitsContainerT<IUnitT> _Units;
   SwarmParamsT _Params;
+  std::vector<ISwarmService *> _Services;
+  SwarmCommands<IUnitT> _Commands;
 
 public:
   Swarm(std::size_t sz = 0) : _Units(sz) {}
@@ -173,7 +311,32 @@ public:
     }
     init();
   }
-  virtual void iter() { _Units.iter(); }
+  virtual void iter() {
+    _Units.iter();
+    end_step();
+  }
+  /**
+   * @brief The step barriers of the attached services, then the commands
+   * recorded during the step; for a step that runs the units some other way
+   * (e.g. by a SystemScheduler)
+   */
+  void end_step() {
+    for (auto *service : _Services)
+      service->end_step();
+    _Commands.apply(_Units);
+  }
+  /**
+   * @brief Spawns, despawns and other structural changes the units record
+   * during a step, applied by end_step()
+   */
+  SwarmCommands<IUnitT> &commands() { return _Commands; }
+  std::size_t size() const { return _Units.size(); }
+  /**
+   * @brief Service the units use (MessageBus, UnitSpatialIndex, ...); every
+   * iter() ends with the step barriers of the attached services, in the order
+   * they were attached
+   */
+  void attach(ISwarmService &service) { _Services.push_back(&service); }
   void for_each(std::function<void(IUnitT &)> action) {
     _Units.for_each(action);
   }
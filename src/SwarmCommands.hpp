@@ -0,0 +1,127 @@
+#pragma once
+#include "SwarmUnit.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+namespace swarm {
+template <typename IUnitT> class SwarmUnitLink;
+
+/**
+ * @brief Structural changes of a swarm recorded while its units run and
+ * applied together at the end of the step: spawning and despawning units, and
+ * deferred actions such as moving a unit to another MessageBus group.
+ *
+ * Recording is thread-safe; every thread records into one of several
+ * shards, so units running in parallel rarely contend. The buffers keep
+ * their capacity between steps.
+ */
+template <typename IUnitT = ISwarmUnit> class SwarmCommands {
+  struct Shard {
+    std::mutex mutex;
+    std::vector<SwarmUnitLink<IUnitT>> spawned;
+    std::vector<const IUnitT *> despawned;
+    std::vector<std::function<void()>> deferred;
+  };
+  std::unique_ptr<Shard[]> _shards;
+  std::size_t _count;
+  std::vector<const IUnitT *> _despawned; // merged, sorted
+
+public:
+  /**
+   * @param shards - number of buffers, 0 - two per hardware thread
+   */
+  explicit SwarmCommands(std::size_t shards = 0)
+      : _count(shards ? shards : 2 * std::max(1u, std::thread::hardware_concurrency())) {
+    _shards = std::make_unique<Shard[]>(_count);
+  }
+
+  /**
+   * @brief Add the unit at the end of the step; it is init()'ed then and
+   * runs from the next step on
+   */
+  void spawn(SwarmUnitLink<IUnitT> unit) {
+    Shard &s = shard();
+    std::lock_guard lock(s.mutex);
+    s.spawned.push_back(std::move(unit));
+  }
+  /**
+   * @brief spawn() a new T(args...)
+   *
+   * @return the unit, owned by the commands until applied
+   */
+  template <class T, class... Args> T *spawn(Args &&...args) {
+    T *unit = new T(std::forward<Args>(args)...);
+    spawn(SwarmUnitLink<IUnitT>(unit));
+    return unit;
+  }
+  /**
+   * @brief Remove the unit from the swarm at the end of the step, before the
+   * units spawned in the same step are added. Despawning twice is harmless.
+   */
+  void despawn(const IUnitT *unit) {
+    Shard &s = shard();
+    std::lock_guard lock(s.mutex);
+    s.despawned.push_back(unit);
+  }
+  /**
+   * @brief Call fn() at the end of the step, after the spawns and despawns
+   */
+  void defer(std::function<void()> fn) {
+    Shard &s = shard();
+    std::lock_guard lock(s.mutex);
+    s.deferred.push_back(std::move(fn));
+  }
+
+  /**
+   * @brief Number of recorded commands; call between steps
+   */
+  std::size_t pending() const {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < _count; ++i)
+      n += _shards[i].spawned.size() + _shards[i].despawned.size() +
+           _shards[i].deferred.size();
+    return n;
+  }
+
+  /**
+   * @brief Apply the recorded commands to a units container, with no unit
+   * running. Despawned units leave their slots to the container's free list
+   * and spawned units take them.
+   */
+  template <class ContainerT> void apply(ContainerT &units) {
+    _despawned.clear();
+    for (std::size_t i = 0; i < _count; ++i) {
+      auto &despawned = _shards[i].despawned;
+      _despawned.insert(_despawned.end(), despawned.begin(), despawned.end());
+      despawned.clear();
+    }
+    if (!_despawned.empty()) {
+      std::sort(_despawned.begin(), _despawned.end());
+      _despawned.erase(std::unique(_despawned.begin(), _despawned.end()), _despawned.end());
+      units.remove_units(_despawned);
+    }
+    for (std::size_t i = 0; i < _count; ++i) {
+      for (auto &unit : _shards[i].spawned) {
+        unit->init();
+        units.add_unit(std::move(unit));
+      }
+      _shards[i].spawned.clear();
+    }
+    for (std::size_t i = 0; i < _count; ++i) {
+      for (auto &fn : _shards[i].deferred)
+        fn();
+      _shards[i].deferred.clear();
+    }
+  }
+
+private:
+  Shard &shard() {
+    return _shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % _count];
+  }
+};
+} // namespace swarm
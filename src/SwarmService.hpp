@@ -0,0 +1,17 @@
+#pragma once
+namespace swarm {
+/**
+ * @brief Shared state that the units of a swarm use during a step (message
+ * bus, spatial index, ...). A Swarm the service is attached to calls
+ * end_step() at the barrier after every iteration of its units.
+ */
+class ISwarmService {
+public:
+  ISwarmService() = default;
+  virtual ~ISwarmService() = default;
+  /**
+   * @brief Step barrier, called with no unit running
+   */
+  virtual void end_step() = 0;
+};
+} // namespace swarm
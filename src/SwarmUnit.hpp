@@ -81,6 +81,18 @@ public:
       : _params(p), _taskManagerC(*new _TaskManagerT((UnitT *)this)),
         _communicationC(*new _CommunicationT((UnitT *)this)),
         _executorC(*new _ExecutorT((UnitT *)this)) {}
+  // The unit owns its components, a copy would delete them twice
+  BasicSwarmUnit(const BasicSwarmUnit &) = delete;
+  BasicSwarmUnit &operator=(const BasicSwarmUnit &) = delete;
+  /**
+   * @brief the task manager, for the swarm to hand out tasks
+   */
+  _TaskManagerT &task_manager() { return _taskManagerC; }
+  const _TaskManagerT &task_manager() const { return _taskManagerC; }
+  _CommunicationT &communication() { return _communicationC; }
+  const _CommunicationT &communication() const { return _communicationC; }
+  _ExecutorT &executor() { return _executorC; }
+  const _ExecutorT &executor() const { return _executorC; }
   void init() {
     _taskManagerC.init();
     _communicationC.init();
@@ -91,7 +103,11 @@ public:
     _communicationC.iter();
     _executorC.iter();
   }
-  virtual ~BasicSwarmUnit() = default;
+  virtual ~BasicSwarmUnit() {
+    delete &_executorC;
+    delete &_communicationC;
+    delete &_taskManagerC;
+  }
 };
 
 class EmptySwarmUnit;
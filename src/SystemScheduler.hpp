@@ -0,0 +1,262 @@
+#pragma once
+#include "ECS.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Data a system reads. The types only name the data: ECS component
+ * types, or tag structs such as the state a unit component owns.
+ */
+template <class... Ts> struct Reads {};
+/**
+ * @brief Data a system writes, see Reads
+ */
+template <class... Ts> struct Writes {};
+
+/**
+ * @brief The data ids a system reads and writes
+ */
+struct SystemAccess {
+  std::vector<std::uint32_t> reads;
+  std::vector<std::uint32_t> writes;
+  bool everything = false; // undeclared: may write anything
+
+  /**
+   * @brief Access of a system that did not declare its data
+   */
+  static SystemAccess all() { return {{}, {}, true}; }
+  template <class... Rs, class... Ws>
+  static SystemAccess of(Reads<Rs...>, Writes<Ws...>) {
+    SystemAccess a{{detail::component_id<Rs>()...}, {detail::component_id<Ws>()...}};
+    std::sort(a.reads.begin(), a.reads.end());
+    std::sort(a.writes.begin(), a.writes.end());
+    return a;
+  }
+  /**
+   * @brief Whether the two systems must not run concurrently: one of them
+   * writes what the other reads or writes
+   */
+  bool conflicts(const SystemAccess &other) const {
+    return everything || other.everything || intersects(writes, other.writes) ||
+           intersects(writes, other.reads) || intersects(reads, other.writes);
+  }
+
+private:
+  static bool intersects(const std::vector<std::uint32_t> &a,
+                         const std::vector<std::uint32_t> &b) {
+    for (auto i = a.begin(), j = b.begin(); i != a.end() && j != b.end();) {
+      if (*i < *j)
+        ++i;
+      else if (*j < *i)
+        ++j;
+      else
+        return true;
+    }
+    return false;
+  }
+};
+
+namespace detail {
+template <class C, class ReadsT, class WritesT> struct is_accessed;
+template <class C, class... Rs, class... Ws>
+struct is_accessed<C, Reads<Rs...>, Writes<Ws...>>
+    : std::bool_constant<(std::is_same_v<C, Rs> || ...) || (std::is_same_v<C, Ws> || ...)> {};
+
+template <class ComponentT> SystemAccess component_access() {
+  if constexpr (requires {
+                  typename ComponentT::Reads;
+                  typename ComponentT::Writes;
+                })
+    return SystemAccess::of(typename ComponentT::Reads{}, typename ComponentT::Writes{});
+  else
+    return SystemAccess::all();
+}
+} // namespace detail
+
+/**
+ * @brief Runs the passes (systems) of a step in parallel where their declared
+ * data allows it. A system is a loop over `size()` items, e.g. all units or
+ * all entities of a view, together with the data it reads and writes.
+ *
+ * Systems conflict when one writes what the other reads or writes; of two
+ * conflicting systems the one added first runs first. Systems are grouped
+ * into stages, each stage right after the last one it depends on, and all
+ * systems of a stage run as one parallel_for over their items concatenated,
+ * so a stage costs a single barrier. The items of a system must be
+ * independent of each other, and a system must not touch data it has not
+ * declared.
+ */
+class SystemScheduler {
+public:
+  /**
+   * @brief fn(begin, end, worker) over the items [begin, end) of a system
+   */
+  using BlockFn = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+private:
+  struct System {
+    std::string name;
+    SystemAccess access;
+    std::function<std::size_t()> size;
+    BlockFn run;
+  };
+  std::vector<System> _systems;
+  std::vector<std::vector<std::size_t>> _dependencies;
+  std::vector<std::vector<std::size_t>> _stages;
+  std::vector<std::size_t> _stageOf; // by system
+  std::vector<std::size_t> _offsets;
+
+public:
+  /**
+   * @brief Add a system of `size()` items, evaluated at the start of its
+   * stage of every step
+   *
+   * @return index of the system
+   */
+  std::size_t add_system(std::string name, SystemAccess access,
+                         std::function<std::size_t()> size, BlockFn run) {
+    const std::size_t id = _systems.size();
+    std::vector<std::size_t> dependencies;
+    std::size_t stage = 0;
+    for (std::size_t other = 0; other < id; ++other)
+      if (access.conflicts(_systems[other].access)) {
+        dependencies.push_back(other);
+        stage = std::max(stage, _stageOf[other] + 1);
+      }
+    _systems.push_back({std::move(name), std::move(access), std::move(size), std::move(run)});
+    _dependencies.push_back(std::move(dependencies));
+    if (stage == _stages.size())
+      _stages.emplace_back();
+    _stages[stage].push_back(id);
+    _stageOf.push_back(stage);
+    return id;
+  }
+  template <class ReadsT, class WritesT>
+  std::size_t add_system(std::string name, std::function<std::size_t()> size, BlockFn run) {
+    return add_system(std::move(name), SystemAccess::of(ReadsT{}, WritesT{}), std::move(size),
+                      std::move(run));
+  }
+  /**
+   * @brief A system of one item, fn() runs on a single worker
+   */
+  template <class ReadsT, class WritesT, class F> std::size_t add_task(std::string name, F fn) {
+    return add_system<ReadsT, WritesT>(
+        std::move(name), [] { return std::size_t(1); },
+        [fn = std::move(fn)](std::size_t, std::size_t, std::size_t) mutable { fn(); });
+  }
+  /**
+   * @brief fn(UnitT &) for every unit of `units`, which must outlive the
+   * scheduler and may change between steps
+   */
+  template <class ReadsT, class WritesT, class UnitT, class F>
+  std::size_t add_unit_pass(std::string name, const std::vector<UnitT *> &units, F fn) {
+    return add_system<ReadsT, WritesT>(
+        std::move(name), [&units] { return units.size(); },
+        [&units, fn = std::move(fn)](std::size_t begin, std::size_t end, std::size_t) {
+          for (std::size_t i = begin; i < end; ++i)
+            fn(*units[i]);
+        });
+  }
+  /**
+   * @brief The iter() passes of the task manager, communication and executor
+   * components of BasicSwarmUnit's, as three systems. A component declares
+   * its data with nested types `Reads` and `Writes` (swarm::Reads<...>,
+   * swarm::Writes<...>); a component without them conflicts with every
+   * other system, so undeclared components keep their order.
+   */
+  template <class UnitT> void add_component_passes(const std::vector<UnitT *> &units) {
+    using TaskManagerT = typename UnitT::_TaskManagerT;
+    using CommunicationT = typename UnitT::_CommunicationT;
+    using ExecutorT = typename UnitT::_ExecutorT;
+    auto pass = [&](std::string name, SystemAccess access, auto iter) {
+      add_system(
+          std::move(name), std::move(access), [&units] { return units.size(); },
+          [&units, iter](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+              iter(*units[i]);
+          });
+    };
+    pass("task manager", detail::component_access<TaskManagerT>(),
+         [](UnitT &u) { u.task_manager().iter(); });
+    pass("communication", detail::component_access<CommunicationT>(),
+         [](UnitT &u) { u.communication().iter(); });
+    pass("executor", detail::component_access<ExecutorT>(),
+         [](UnitT &u) { u.executor().iter(); });
+  }
+  /**
+   * @brief fn(Entity, Cs &...) for the entities of registry.view<Cs...>();
+   * every Cs must be declared in ReadsT or WritesT. The registry must not
+   * change structurally while the scheduler runs.
+   */
+  template <class ReadsT, class WritesT, class... Cs, class F>
+  std::size_t add_each(std::string name, EntityRegistry &registry, F fn) {
+    static_assert((detail::is_accessed<Cs, ReadsT, WritesT>::value && ...),
+                  "every component of the view must be declared");
+    auto view = std::make_shared<std::optional<View<Cs...>>>();
+    return add_system<ReadsT, WritesT>(
+        std::move(name),
+        [&registry, view] {
+          view->emplace(registry.template view<Cs...>());
+          return (*view)->size_hint();
+        },
+        [view, fn = std::move(fn)](std::size_t begin, std::size_t end, std::size_t) {
+          (*view)->each(begin, end, fn);
+        });
+  }
+
+  std::size_t systems() const { return _systems.size(); }
+  const std::string &name(std::size_t system) const { return _systems[system].name; }
+  /**
+   * @brief The earlier systems that conflict with `system`, the edges of the
+   * dependency DAG
+   */
+  const std::vector<std::size_t> &dependencies(std::size_t system) const {
+    return _dependencies[system];
+  }
+  /**
+   * @brief The systems of each stage; a stage starts when the previous one
+   * has finished
+   */
+  const std::vector<std::vector<std::size_t>> &stages() const { return _stages; }
+
+  /**
+   * @brief Run every system once, stage by stage
+   *
+   * @param pool - nullptr - the calling thread, systems in the order of adding
+   */
+  void run(ThreadPool *pool = nullptr) {
+    if (!pool) {
+      for (auto &system : _systems)
+        system.run(0, system.size(), 0);
+      return;
+    }
+    for (const auto &stage : _stages) {
+      _offsets.assign(1, 0);
+      for (std::size_t id : stage)
+        _offsets.push_back(_offsets.back() + _systems[id].size());
+      pool->parallel_for(_offsets.back(), [&](std::size_t begin, std::size_t end,
+                                              std::size_t worker) {
+        // The systems whose items overlap [begin, end)
+        std::size_t s = static_cast<std::size_t>(
+            std::upper_bound(_offsets.begin(), _offsets.end(), begin) - _offsets.begin() - 1);
+        for (; s < stage.size() && _offsets[s] < end; ++s) {
+          const std::size_t from = std::max(begin, _offsets[s]);
+          const std::size_t to = std::min(end, _offsets[s + 1]);
+          if (from < to)
+            _systems[stage[s]].run(from - _offsets[s], to - _offsets[s], worker);
+        }
+      });
+    }
+  }
+};
+} // namespace swarm
@@ -0,0 +1,390 @@
+#pragma once
+#include "CSRGraph.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief How distances of a TSPLIB instance are defined
+ */
+enum class TSPLIBWeight { Euc2D, Ceil2D, Att, Geo, Man2D, Max2D, Explicit };
+
+/**
+ * @brief A TSPLIB instance (TSP, ATSP or CVRP). Coordinate instances keep only
+ * the coordinates and compute distance() on demand, so they cost O(n) memory;
+ * EXPLICIT instances keep the full matrix.
+ */
+struct TSPLIBInstance {
+  std::string name;
+  std::string type;               // TSP, ATSP, CVRP, ...
+  std::string edge_weight_type;   // as written in the file
+  std::string edge_weight_format; // EXPLICIT only
+  TSPLIBWeight weight = TSPLIBWeight::Euc2D;
+  std::size_t dimension = 0;
+  std::vector<double> x; // node or display coordinates, may be empty for EXPLICIT
+  std::vector<double> y;
+  std::vector<double> weights; // EXPLICIT: dimension x dimension, row-major
+  // CVRP
+  double capacity = 0.0;
+  std::vector<double> demands;
+  std::vector<std::size_t> depots; // 0-based
+
+  bool has_coordinates() const { return x.size() == dimension; }
+
+  /**
+   * @brief TSPLIB distance between nodes i and j (0-based), rounded as the
+   * TSPLIB specification says
+   */
+  double distance(std::size_t i, std::size_t j) const {
+    if (weight == TSPLIBWeight::Explicit)
+      return weights[i * dimension + j];
+    const double dx = x[i] - x[j];
+    const double dy = y[i] - y[j];
+    switch (weight) {
+    case TSPLIBWeight::Euc2D:
+      return nint(std::sqrt(dx * dx + dy * dy));
+    case TSPLIBWeight::Ceil2D:
+      return std::ceil(std::sqrt(dx * dx + dy * dy));
+    case TSPLIBWeight::Att: {
+      const double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+      const double t = nint(r);
+      return t < r ? t + 1.0 : t;
+    }
+    case TSPLIBWeight::Man2D:
+      return nint(std::abs(dx) + std::abs(dy));
+    case TSPLIBWeight::Max2D:
+      return std::max(nint(std::abs(dx)), nint(std::abs(dy)));
+    case TSPLIBWeight::Geo: {
+      if (i == j)
+        return 0.0;
+      constexpr double Radius = 6378.388;
+      const double q1 = std::cos(geo(y[i]) - geo(y[j]));
+      const double q2 = std::cos(geo(x[i]) - geo(x[j]));
+      const double q3 = std::cos(geo(x[i]) + geo(x[j]));
+      return std::floor(
+          Radius * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+    }
+    case TSPLIBWeight::Explicit:
+      break;
+    }
+    return weights[i * dimension + j];
+  }
+
+  /**
+   * @brief Write all distances into a row-major matrix, diagonal included.
+   * Needs dimension^2 doubles; large instances should use distance() or
+   * tsplib_graph() instead.
+   *
+   * @param stride - distance in elements between the starts of two rows
+   */
+  void fill_matrix(double *out, std::size_t stride) const {
+    for (std::size_t i = 0; i < dimension; ++i) {
+      for (std::size_t j = 0; j < dimension; ++j)
+        out[i * stride + j] = distance(i, j);
+    }
+  }
+
+private:
+  static double nint(double v) { return std::floor(v + 0.5); }
+  // DDD.MM degrees and minutes to radians, as in the TSPLIB reference code
+  static double geo(double v) {
+    constexpr double Pi = 3.141592;
+    const double degrees = std::trunc(v);
+    return Pi * (degrees + 5.0 * (v - degrees) / 3.0) / 180.0;
+  }
+};
+
+namespace detail {
+inline std::string_view trim(std::string_view s) {
+  const auto first = s.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos)
+    return {};
+  return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+/**
+ * @brief Forward-only reader over the file text, numbers are parsed in place
+ * with std::from_chars
+ */
+class TSPLIBCursor {
+  const char *_p;
+  const char *_end;
+
+public:
+  explicit TSPLIBCursor(std::string_view text)
+      : _p(text.data()), _end(text.data() + text.size()) {}
+  bool done() const { return _p == _end; }
+  const char *position() const { return _p; }
+  void rewind(const char *p) { _p = p; }
+
+  /**
+   * @brief the rest of the current line, the cursor moves to the next one
+   */
+  std::string_view line() {
+    const char *begin = _p;
+    while (_p != _end && *_p != '\n')
+      ++_p;
+    std::string_view text(begin, static_cast<std::size_t>(_p - begin));
+    if (_p != _end)
+      ++_p;
+    return text;
+  }
+
+  template <class T> T number() {
+    while (_p != _end && (*_p == ' ' || *_p == '\t' || *_p == '\r' ||
+                          *_p == '\n' || *_p == '+'))
+      ++_p;
+    T value{};
+    const auto [next, error] = std::from_chars(_p, _end, value);
+    if (error != std::errc())
+      throw std::runtime_error("TSPLIB: number expected");
+    _p = next;
+    return value;
+  }
+};
+
+inline TSPLIBWeight parse_weight_type(std::string_view type) {
+  if (type == "EUC_2D")
+    return TSPLIBWeight::Euc2D;
+  if (type == "CEIL_2D")
+    return TSPLIBWeight::Ceil2D;
+  if (type == "ATT")
+    return TSPLIBWeight::Att;
+  if (type == "GEO")
+    return TSPLIBWeight::Geo;
+  if (type == "MAN_2D")
+    return TSPLIBWeight::Man2D;
+  if (type == "MAX_2D")
+    return TSPLIBWeight::Max2D;
+  if (type == "EXPLICIT")
+    return TSPLIBWeight::Explicit;
+  throw std::runtime_error("TSPLIB: unsupported EDGE_WEIGHT_TYPE " +
+                           std::string(type));
+}
+
+/**
+ * @brief EDGE_WEIGHT_SECTION in any of the TSPLIB matrix layouts into a full
+ * matrix. A column-wise layout of one triangle is the row-wise layout of the
+ * other.
+ */
+inline void read_edge_weights(TSPLIBCursor &cursor, TSPLIBInstance &instance) {
+  const std::size_t n = instance.dimension;
+  std::string_view format = instance.edge_weight_format;
+  if (format == "UPPER_COL")
+    format = "LOWER_ROW";
+  else if (format == "LOWER_COL")
+    format = "UPPER_ROW";
+  else if (format == "UPPER_DIAG_COL")
+    format = "LOWER_DIAG_ROW";
+  else if (format == "LOWER_DIAG_COL")
+    format = "UPPER_DIAG_ROW";
+
+  instance.weights.assign(n * n, 0.0);
+  auto set = [&](std::size_t i, std::size_t j) {
+    const double w = cursor.number<double>();
+    instance.weights[i * n + j] = w;
+    instance.weights[j * n + i] = w;
+  };
+  if (format == "FULL_MATRIX") {
+    for (auto &w : instance.weights)
+      w = cursor.number<double>();
+  } else if (format == "UPPER_ROW") {
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = i + 1; j < n; ++j)
+        set(i, j);
+  } else if (format == "LOWER_ROW") {
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = 0; j < i; ++j)
+        set(i, j);
+  } else if (format == "UPPER_DIAG_ROW") {
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = i; j < n; ++j)
+        set(i, j);
+  } else if (format == "LOWER_DIAG_ROW") {
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = 0; j <= i; ++j)
+        set(i, j);
+  } else {
+    throw std::runtime_error("TSPLIB: unsupported EDGE_WEIGHT_FORMAT " +
+                             instance.edge_weight_format);
+  }
+}
+
+inline void read_coordinates(TSPLIBCursor &cursor, TSPLIBInstance &instance) {
+  instance.x.assign(instance.dimension, 0.0);
+  instance.y.assign(instance.dimension, 0.0);
+  for (std::size_t k = 0; k < instance.dimension; ++k) {
+    const auto node = cursor.number<std::size_t>();
+    if (node == 0 || node > instance.dimension)
+      throw std::runtime_error("TSPLIB: node id out of range");
+    instance.x[node - 1] = cursor.number<double>();
+    instance.y[node - 1] = cursor.number<double>();
+  }
+}
+
+/**
+ * @brief Skip the data lines of a section we do not use
+ */
+inline void skip_section(TSPLIBCursor &cursor) {
+  while (!cursor.done()) {
+    const char *start = cursor.position();
+    const std::string_view text = trim(cursor.line());
+    if (!text.empty() && std::isalpha(static_cast<unsigned char>(text[0]))) {
+      cursor.rewind(start);
+      return;
+    }
+  }
+}
+} // namespace detail
+
+/**
+ * @brief Parse a TSPLIB file held in memory. Numbers are read in place and
+ * written straight into the result, nothing is allocated per line.
+ *
+ * Supported: EDGE_WEIGHT_TYPE EUC_2D, CEIL_2D, ATT, GEO, MAN_2D, MAX_2D and
+ * EXPLICIT (all matrix formats), NODE_COORD_SECTION, DISPLAY_DATA_SECTION,
+ * EDGE_WEIGHT_SECTION and the CVRP CAPACITY, DEMAND_SECTION, DEPOT_SECTION.
+ *
+ * @throw std::runtime_error on malformed or unsupported input
+ */
+inline TSPLIBInstance parse_tsplib(std::string_view text) {
+  TSPLIBInstance instance;
+  detail::TSPLIBCursor cursor(text);
+  bool weight_known = false;
+  while (!cursor.done()) {
+    const std::string_view line = detail::trim(cursor.line());
+    if (line.empty())
+      continue;
+    if (line == "EOF")
+      break;
+    if (instance.dimension == 0 && line.ends_with("_SECTION"))
+      throw std::runtime_error("TSPLIB: DIMENSION missing before data");
+
+    if (line == "NODE_COORD_SECTION") {
+      detail::read_coordinates(cursor, instance);
+    } else if (line == "DISPLAY_DATA_SECTION") {
+      if (instance.has_coordinates())
+        detail::skip_section(cursor);
+      else
+        detail::read_coordinates(cursor, instance);
+    } else if (line == "EDGE_WEIGHT_SECTION") {
+      detail::read_edge_weights(cursor, instance);
+    } else if (line == "DEMAND_SECTION") {
+      instance.demands.assign(instance.dimension, 0.0);
+      for (std::size_t k = 0; k < instance.dimension; ++k) {
+        const auto node = cursor.number<std::size_t>();
+        if (node == 0 || node > instance.dimension)
+          throw std::runtime_error("TSPLIB: node id out of range");
+        instance.demands[node - 1] = cursor.number<double>();
+      }
+    } else if (line == "DEPOT_SECTION") {
+      for (long node = cursor.number<long>(); node != -1;
+           node = cursor.number<long>()) {
+        if (node <= 0 || static_cast<std::size_t>(node) > instance.dimension)
+          throw std::runtime_error("TSPLIB: depot out of range");
+        instance.depots.push_back(static_cast<std::size_t>(node - 1));
+      }
+    } else if (line.ends_with("_SECTION")) {
+      detail::skip_section(cursor);
+    } else if (const auto colon = line.find(':');
+               colon != std::string_view::npos) {
+      const std::string_view key = detail::trim(line.substr(0, colon));
+      const std::string_view value = detail::trim(line.substr(colon + 1));
+      if (key == "NAME") {
+        instance.name = value;
+      } else if (key == "TYPE") {
+        instance.type = value;
+      } else if (key == "EDGE_WEIGHT_TYPE") {
+        instance.edge_weight_type = value;
+        instance.weight = detail::parse_weight_type(value);
+        weight_known = true;
+      } else if (key == "EDGE_WEIGHT_FORMAT") {
+        instance.edge_weight_format = value;
+      } else if (key == "DIMENSION" || key == "CAPACITY") {
+        double number = 0.0;
+        const auto [end, error] =
+            std::from_chars(value.data(), value.data() + value.size(), number);
+        if (error != std::errc() || number < 0.0)
+          throw std::runtime_error("TSPLIB: bad " + std::string(key));
+        if (key == "DIMENSION")
+          instance.dimension = static_cast<std::size_t>(number);
+        else
+          instance.capacity = number;
+      }
+    }
+  }
+  if (!weight_known || instance.dimension == 0)
+    throw std::runtime_error("TSPLIB: DIMENSION or EDGE_WEIGHT_TYPE missing");
+  if (instance.weight == TSPLIBWeight::Explicit
+          ? instance.weights.size() != instance.dimension * instance.dimension
+          : !instance.has_coordinates())
+    throw std::runtime_error("TSPLIB: distance data missing");
+  return instance;
+}
+
+/**
+ * @brief Memory-map a TSPLIB file and parse it
+ */
+inline TSPLIBInstance load_tsplib(const std::string &path) {
+  const MappedFile file(path);
+  return parse_tsplib(file.view());
+}
+
+/**
+ * @brief Read a TSPLIB file from a stream (buffered once, then parse_tsplib)
+ */
+inline TSPLIBInstance read_tsplib(std::istream &in) {
+  const std::string text(std::istreambuf_iterator<char>(in), {});
+  return parse_tsplib(text);
+}
+
+/**
+ * @brief Sparse graph of an instance: every node connected (both ways) to its
+ * k nearest nodes, weighted with the TSPLIB distance. The Euclidean types
+ * (EUC_2D, CEIL_2D, ATT) use a grid in O(n k); the others, whose nearest
+ * nodes a Euclidean search would only approximate, scan all pairs.
+ */
+inline CSRGraph<double> tsplib_graph(const TSPLIBInstance &instance,
+                                     std::size_t k) {
+  auto distance = [&instance](std::size_t i, std::size_t j) {
+    return instance.distance(i, j);
+  };
+  if (instance.weight == TSPLIBWeight::Euc2D ||
+      instance.weight == TSPLIBWeight::Ceil2D ||
+      instance.weight == TSPLIBWeight::Att)
+    return k_nearest_graph<double>(instance.x, instance.y, k, distance);
+
+  using Edge = CSRGraph<double>::Edge;
+  using VertexId = CSRGraph<double>::VertexId;
+  const std::size_t n = instance.dimension;
+  k = std::min(k, n - 1);
+  std::vector<Edge> edges;
+  edges.reserve(2 * n * k);
+  std::vector<VertexId> order(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::iota(order.begin(), order.end(), 0u);
+    std::swap(order[i], order.back());
+    std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(k),
+                      order.end() - 1, [&](VertexId a, VertexId b) {
+                        return distance(i, a) < distance(i, b);
+                      });
+    for (std::size_t c = 0; c < k; ++c) {
+      const auto u = static_cast<VertexId>(i);
+      edges.push_back({u, order[c], distance(i, order[c])});
+      edges.push_back({order[c], u, distance(order[c], i)});
+    }
+  }
+  return CSRGraph<double>(n, edges);
+}
+} // namespace swarm
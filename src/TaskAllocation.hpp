@@ -0,0 +1,412 @@
+#pragma once
+#include "Parallel.hpp"
+#include "SpatialIndex.hpp"
+#include "SwarmUnit.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Unit-task pairs with their scores, stored by unit. A pair whose
+ * score is NaN or -infinity is infeasible and never assigned.
+ */
+struct AllocationGraph {
+  std::size_t tasks = 0;
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::uint32_t> task;
+  std::vector<double> score;
+
+  std::size_t units() const { return offsets.size() - 1; }
+  std::size_t pairs() const { return task.size(); }
+  static bool feasible(double s) {
+    return s > -std::numeric_limits<double>::infinity();
+  }
+};
+
+/**
+ * @brief Score the candidate tasks of every unit in parallel
+ *
+ * @param candidates - tasks each unit may take, e.g. from k_nearest_of()
+ * @param score - callable (unit, task) -> double, higher is better
+ */
+template <class ScoreF>
+AllocationGraph score_pairs(const NeighborLists &candidates, std::size_t tasks,
+                            ScoreF &&score, ThreadPool &pool) {
+  AllocationGraph g;
+  g.tasks = tasks;
+  g.offsets = candidates.offsets;
+  g.task = candidates.indices;
+  g.score.resize(g.task.size());
+  pool.parallel_for(candidates.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t u = begin; u < end; ++u)
+      for (std::size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k)
+        g.score[k] = score(static_cast<std::uint32_t>(u), g.task[k]);
+  });
+  return g;
+}
+/**
+ * @brief Score every unit-task pair in parallel; for small batches
+ */
+template <class ScoreF>
+AllocationGraph score_all_pairs(std::size_t units, std::size_t tasks,
+                                ScoreF &&score, ThreadPool &pool) {
+  AllocationGraph g;
+  g.tasks = tasks;
+  g.offsets.resize(units + 1);
+  for (std::size_t u = 0; u <= units; ++u)
+    g.offsets[u] = u * tasks;
+  g.task.resize(units * tasks);
+  g.score.resize(units * tasks);
+  pool.parallel_for(units, [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t u = begin; u < end; ++u)
+      for (std::size_t t = 0; t < tasks; ++t) {
+        g.task[u * tasks + t] = static_cast<std::uint32_t>(t);
+        g.score[u * tasks + t] = score(static_cast<std::uint32_t>(u), static_cast<std::uint32_t>(t));
+      }
+  });
+  return g;
+}
+
+/**
+ * @brief Result of an allocation: the unit of every task and the tasks of
+ * every unit in the order the unit should do them
+ */
+struct Allocation {
+  static constexpr std::uint32_t None = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> unit;  // by task, None if unassigned
+  NeighborLists bundles;            // by unit
+  double total = 0.0;               // sum of the scores of assigned pairs
+  std::size_t rounds = 0;           // bidding rounds of cbba_allocation
+
+  std::size_t assigned() const {
+    return static_cast<std::size_t>(
+        std::count_if(unit.begin(), unit.end(), [](std::uint32_t u) { return u != None; }));
+  }
+};
+
+namespace detail {
+/**
+ * @brief Stable LSD radix sort of ids by 64-bit key, 11 bits per pass (the
+ * counts stay in L1); `ids` ends up ordered by key, equal keys in their
+ * original order
+ */
+inline void radix_sort(std::vector<std::uint64_t> &keys, std::vector<std::uint32_t> &ids) {
+  constexpr unsigned Bits = 11;
+  constexpr std::uint64_t Mask = (1u << Bits) - 1;
+  std::vector<std::uint64_t> key_buffer(keys.size());
+  std::vector<std::uint32_t> id_buffer(ids.size());
+  std::vector<std::size_t> count(std::size_t(1) << Bits);
+  for (unsigned shift = 0; shift < 64; shift += Bits) {
+    std::fill(count.begin(), count.end(), 0);
+    for (const auto k : keys)
+      ++count[(k >> shift) & Mask];
+    if (keys.empty() || count[(keys[0] >> shift) & Mask] == keys.size())
+      continue; // every key has the same digit
+    std::size_t sum = 0;
+    for (auto &c : count)
+      sum += std::exchange(c, sum);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const std::size_t to = count[(keys[i] >> shift) & Mask]++;
+      key_buffer[to] = keys[i];
+      id_buffer[to] = ids[i];
+    }
+    keys.swap(key_buffer);
+    ids.swap(id_buffer);
+  }
+}
+/**
+ * @brief Key that sorts scores from best to worst
+ */
+inline std::uint64_t descending_key(double s) {
+  const auto bits = std::bit_cast<std::uint64_t>(s + 0.0); // -0 as +0
+  const std::uint64_t ascending = bits >> 63 ? ~bits : bits | (std::uint64_t(1) << 63);
+  return ~ascending;
+}
+/**
+ * @brief Fill bundles and total from per-unit task lists
+ */
+inline void finish_allocation(Allocation &a, const AllocationGraph &g,
+                              const std::vector<std::vector<std::uint32_t>> &bundles,
+                              const std::vector<std::vector<double>> &scores) {
+  a.bundles.offsets.assign(1, 0);
+  a.bundles.indices.clear();
+  a.total = 0.0;
+  for (std::size_t u = 0; u < g.units(); ++u) {
+    a.bundles.indices.insert(a.bundles.indices.end(), bundles[u].begin(), bundles[u].end());
+    a.bundles.offsets.push_back(a.bundles.indices.size());
+    for (double s : scores[u])
+      a.total += s;
+  }
+}
+} // namespace detail
+
+/**
+ * @brief Greedy batch assignment: pairs are taken best score first while
+ * the task is free and the unit has room. At least half the optimal total
+ * for capacity 1; pairs are radix sorted, O(p) for p pairs.
+ *
+ * @param capacity - most tasks per unit
+ */
+inline Allocation greedy_allocation(const AllocationGraph &g, std::size_t capacity = 1) {
+  std::vector<std::uint64_t> keys;
+  std::vector<std::uint32_t> order; // pairs, best first
+  keys.reserve(g.pairs());
+  order.reserve(g.pairs());
+  for (std::size_t k = 0; k < g.pairs(); ++k)
+    if (AllocationGraph::feasible(g.score[k])) {
+      keys.push_back(detail::descending_key(g.score[k]));
+      order.push_back(static_cast<std::uint32_t>(k));
+    }
+  // Stable, and pairs are numbered by unit: equal scores go to the lower unit
+  detail::radix_sort(keys, order);
+  Allocation a;
+  a.unit.assign(g.tasks, Allocation::None);
+  std::vector<std::vector<std::uint32_t>> bundles(g.units());
+  std::vector<std::vector<double>> scores(g.units());
+  std::vector<std::uint32_t> owner(g.pairs());
+  for (std::size_t u = 0; u < g.units(); ++u)
+    std::fill(owner.begin() + static_cast<std::ptrdiff_t>(g.offsets[u]),
+              owner.begin() + static_cast<std::ptrdiff_t>(g.offsets[u + 1]),
+              static_cast<std::uint32_t>(u));
+  for (const std::uint32_t k : order) {
+    const std::uint32_t u = owner[k], t = g.task[k];
+    if (a.unit[t] != Allocation::None || bundles[u].size() >= capacity)
+      continue;
+    a.unit[t] = u;
+    bundles[u].push_back(t);
+    scores[u].push_back(g.score[k]);
+  }
+  detail::finish_allocation(a, g, bundles, scores);
+  return a;
+}
+
+/**
+ * @brief Optimal one-to-one assignment by the Hungarian method: as many
+ * feasible pairs as possible, with the best total among those. Dense and
+ * O(n^2 m) for n = min(units, tasks), m = max(units, tasks): for batches of
+ * up to a few thousand, otherwise use greedy_allocation or cbba_allocation.
+ */
+inline Allocation hungarian_allocation(const AllocationGraph &g) {
+  const bool by_unit = g.units() <= g.tasks; // rows are the smaller side
+  const std::size_t n = by_unit ? g.units() : g.tasks;
+  const std::size_t m = by_unit ? g.tasks : g.units();
+  // Infeasible pairs cost more than any feasible assignment
+  double best = 0.0;
+  for (std::size_t k = 0; k < g.pairs(); ++k)
+    if (AllocationGraph::feasible(g.score[k]))
+      best = std::max(best, std::abs(g.score[k]));
+  const double forbidden = 2.0 * (best + 1.0) * static_cast<double>(n + 1);
+  std::vector<double> cost((n + 1) * (m + 1), forbidden);
+  for (std::size_t u = 0; u < g.units(); ++u)
+    for (std::size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+      if (!AllocationGraph::feasible(g.score[k]))
+        continue;
+      const std::size_t t = g.task[k];
+      const std::size_t i = (by_unit ? u : t) + 1, j = (by_unit ? t : u) + 1;
+      cost[i * (m + 1) + j] = std::min(cost[i * (m + 1) + j], -g.score[k]);
+    }
+
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> row(n + 1, 0.0), col(m + 1, 0.0), slack(m + 1);
+  std::vector<std::size_t> match(m + 1, 0), way(m + 1, 0); // column -> row
+  std::vector<char> used(m + 1);
+  for (std::size_t i = 1; i <= n; ++i) {
+    match[0] = i;
+    std::size_t j0 = 0;
+    std::fill(slack.begin(), slack.end(), inf);
+    std::fill(used.begin(), used.end(), 0);
+    do {
+      used[j0] = 1;
+      const std::size_t i0 = match[j0];
+      double delta = inf;
+      std::size_t j1 = 0;
+      const double *c = &cost[i0 * (m + 1)];
+      for (std::size_t j = 1; j <= m; ++j) {
+        if (used[j])
+          continue;
+        const double reduced = c[j] - row[i0] - col[j];
+        if (reduced < slack[j]) {
+          slack[j] = reduced;
+          way[j] = j0;
+        }
+        if (slack[j] < delta) {
+          delta = slack[j];
+          j1 = j;
+        }
+      }
+      for (std::size_t j = 0; j <= m; ++j) {
+        if (used[j]) {
+          row[match[j]] += delta;
+          col[j] -= delta;
+        } else {
+          slack[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (match[j0] != 0);
+    do {
+      const std::size_t j1 = way[j0];
+      match[j0] = match[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  Allocation a;
+  a.unit.assign(g.tasks, Allocation::None);
+  std::vector<std::vector<std::uint32_t>> bundles(g.units());
+  std::vector<std::vector<double>> scores(g.units());
+  for (std::size_t j = 1; j <= m; ++j) {
+    const std::size_t i = match[j];
+    if (i == 0 || cost[i * (m + 1) + j] >= forbidden)
+      continue;
+    const auto u = static_cast<std::uint32_t>((by_unit ? i : j) - 1);
+    const auto t = static_cast<std::uint32_t>((by_unit ? j : i) - 1);
+    a.unit[t] = u;
+    bundles[u].push_back(t);
+    scores[u].push_back(-cost[i * (m + 1) + j]);
+  }
+  detail::finish_allocation(a, g, bundles, scores);
+  return a;
+}
+
+/**
+ * @brief Consensus-based bundle algorithm. Every round each unit, in
+ * parallel, extends its bundle with the best tasks it can outbid the current
+ * winners on; then the bids are merged, the highest bid winning (the lower
+ * unit on ties). A unit that is outbid on a task also gives up every task it
+ * added after it. Rounds repeat until no winner changes, so the result does
+ * not depend on the number of threads.
+ *
+ * Scores do not depend on the rest of the bundle here: the bundle order is
+ * the order of bidding, best first.
+ *
+ * @param capacity - most tasks per unit (the bundle size)
+ * @param max_rounds - stop early, with a consistent but maybe not converged
+ * allocation
+ */
+inline Allocation cbba_allocation(const AllocationGraph &g, std::size_t capacity,
+                                  ThreadPool &pool, std::size_t max_rounds = 10000) {
+  constexpr double lowest = -std::numeric_limits<double>::infinity();
+  const std::size_t units = g.units();
+  std::vector<std::uint32_t> winner(g.tasks, Allocation::None);
+  std::vector<double> bid(g.tasks, lowest);
+  std::vector<std::vector<std::uint32_t>> bundles(units);
+  std::vector<std::vector<double>> scores(units);
+  std::vector<std::vector<std::uint32_t>> released(units);
+  std::vector<std::size_t> fresh(units); // index of the first new bid in the bundle
+  std::vector<char> active(units, 1);    // bundle may change this round
+
+  std::size_t round = 0;
+  for (bool changed = true; changed && round < max_rounds; ++round) {
+    pool.parallel_for(units, [&](std::size_t begin, std::size_t end, std::size_t) {
+      for (std::size_t u = begin; u < end; ++u) {
+        auto &bundle = bundles[u];
+        auto &bundle_scores = scores[u];
+        released[u].clear();
+        fresh[u] = bundle.size();
+        if (!active[u])
+          continue;
+        // Drop everything from the first lost task on
+        std::size_t keep = 0;
+        while (keep < bundle.size() && winner[bundle[keep]] == u)
+          ++keep;
+        if (keep < bundle.size()) {
+          released[u].assign(bundle.begin() + static_cast<std::ptrdiff_t>(keep) + 1, bundle.end());
+          bundle.resize(keep);
+          bundle_scores.resize(keep);
+        }
+        fresh[u] = keep;
+        while (bundle.size() < capacity) {
+          std::size_t pick = g.offsets[u + 1];
+          for (std::size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+            const double s = g.score[k];
+            const std::uint32_t t = g.task[k];
+            if (!AllocationGraph::feasible(s) ||
+                std::find(bundle.begin(), bundle.end(), t) != bundle.end())
+              continue;
+            const bool outbids =
+                winner[t] == u || s > bid[t] ||
+                (!(s < bid[t]) && !(bid[t] < s) && u < winner[t]);
+            if (outbids && (pick == g.offsets[u + 1] || s > g.score[pick]))
+              pick = k;
+          }
+          if (pick == g.offsets[u + 1])
+            break;
+          bundle.push_back(g.task[pick]);
+          bundle_scores.push_back(g.score[pick]);
+        }
+      }
+    });
+    // Merge in unit order: the same result for any split of the units
+    changed = false;
+    for (std::size_t u = 0; u < units; ++u)
+      for (const std::uint32_t t : released[u])
+        if (winner[t] == u) {
+          winner[t] = Allocation::None;
+          bid[t] = lowest;
+          changed = true;
+        }
+    std::fill(active.begin(), active.end(), 0);
+    for (std::size_t u = 0; u < units; ++u)
+      for (std::size_t i = fresh[u]; i < bundles[u].size(); ++i) {
+        const std::uint32_t t = bundles[u][i];
+        const double s = scores[u][i];
+        if (winner[t] == u || s > bid[t] ||
+            (!(s < bid[t]) && !(bid[t] < s) && u < winner[t])) {
+          if (winner[t] != Allocation::None && winner[t] != u)
+            active[winner[t]] = 1; // outbid
+          winner[t] = static_cast<std::uint32_t>(u);
+          bid[t] = s;
+          changed = true;
+        } else {
+          active[u] = 1; // lost to an earlier unit this round
+        }
+      }
+    // Released tasks and unfilled bundles: someone may bid now
+    if (changed)
+      for (std::size_t u = 0; u < units; ++u)
+        active[u] = active[u] || bundles[u].size() < capacity;
+  }
+  // Keep only what every unit still wins
+  Allocation a;
+  a.rounds = round;
+  a.unit = winner;
+  for (std::size_t u = 0; u < units; ++u) {
+    std::size_t keep = 0;
+    while (keep < bundles[u].size() && winner[bundles[u][keep]] == u)
+      ++keep;
+    for (std::size_t i = keep; i < bundles[u].size(); ++i)
+      if (winner[bundles[u][i]] == u)
+        a.unit[bundles[u][i]] = Allocation::None;
+    bundles[u].resize(keep);
+    scores[u].resize(keep);
+  }
+  detail::finish_allocation(a, g, bundles, scores);
+  return a;
+}
+
+/**
+ * @brief Give every unit its tasks, in bundle order, through its task
+ * manager. Units are handled in parallel, each by one worker.
+ *
+ * @param units - by unit index of the allocation
+ * @param make - callable (UnitT &, task) -> PtrTask<UnitT>
+ */
+template <class UnitT, class MakeTask>
+void deliver(const Allocation &a, std::span<UnitT *const> units, MakeTask &&make,
+             ThreadPool &pool) {
+  pool.parallel_for(a.bundles.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t u = begin; u < end; ++u)
+      for (const std::uint32_t t : a.bundles[u])
+        units[u]->task_manager().add_task_in_back(make(*units[u], t));
+  });
+}
+} // namespace swarm
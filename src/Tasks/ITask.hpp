@@ -20,7 +20,6 @@ template <class SwarmUnitT> class IBaseTask {
                 "SwarmUnitT must be derived from BasicSwarmUnit");
   SwarmUnitT *_unit;
   const ITaskParams &_params;
-  bool is_full_decomposed;
 
 public:
   /**
@@ -28,11 +27,17 @@ public:
    *
    * @param lvl - complexity of the task, <= MaximumTaskLvl
    * @param u - pointer to unit
-   * @param p - the parameters that task is set
+   * @param p - the parameters that task is set, owned by the derived task
    */
   IBaseTask(uint32_t lvl, SwarmUnitT *u, const ITaskParams &p)
       : _unit(u), _params(p) {}
   virtual constexpr uint32_t get_lvl() const = 0;
+  /**
+   * @brief level 0 tasks are not decomposed any further
+   */
+  bool is_full_decomposed() const { return get_lvl() == 0; }
+  SwarmUnitT *unit() const { return _unit; }
+  const ITaskParams &params() const { return _params; }
 
   virtual ~IBaseTask() = default;
 };
@@ -56,14 +61,19 @@ class ITask : public IBaseTask<SwarmUnitT> {
                 "TaskParamsT must be derived by ITaskParams");
   static_assert(Lvl < MaximumTaskLvl, "Lvl of task must be < MaximumTaskLvl");
 
+  TaskParamsT _params;
+
 public:
+  using Params = TaskParamsT;
+  static constexpr uint32_t Level = Lvl;
   constexpr uint32_t get_lvl() const override { return Lvl; }
   ITask(SwarmUnitT *u, const TaskParamsT &params = TaskParamsT())
-      : IBaseTask<SwarmUnitT>(Lvl, u, params) {}
+      : IBaseTask<SwarmUnitT>(Lvl, u, _params), _params(params) {}
+  ITask(const ITask &o)
+      : IBaseTask<SwarmUnitT>(Lvl, o.unit(), _params), _params(o._params) {}
+  const TaskParamsT &params() const { return _params; }
 };
 
-template <typename SwarmUnitT, typename TaskParamsT>
-class ITask<0, SwarmUnitT, TaskParamsT> {};
 template <typename SwarmUnitT, typename TaskParamsT>
 class ITask<MaximumTaskLvl - 1, SwarmUnitT, TaskParamsT> {};
 
@@ -0,0 +1,200 @@
+#pragma once
+#include "ITask.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace swarm {
+template <class SwarmUnitT> class PtrTask;
+
+/**
+ * @brief One task of a decomposition plan: its type, level and a copy of its
+ * parameters, not bound to any unit
+ */
+template <class SwarmUnitT> struct TaskPlanStep {
+  std::type_index type;
+  std::uint32_t lvl;
+  std::shared_ptr<const ITaskParams> params;
+  PtrTask<SwarmUnitT> (*make)(SwarmUnitT *, const ITaskParams &);
+
+  /**
+   * @brief Create the task for the unit
+   */
+  PtrTask<SwarmUnitT> instantiate(SwarmUnitT *u) const { return make(u, *params); }
+
+  template <class TaskT, class ParamsT> static TaskPlanStep of(ParamsT &&p) {
+    using Params = typename TaskT::Params;
+    static_assert(std::is_base_of<IBaseTask<SwarmUnitT>, TaskT>::value,
+                  "TaskT must be derived from IBaseTask");
+    static_assert(std::is_constructible<TaskT, SwarmUnitT *, const Params &>::value,
+                  "TaskT must be constructible from (SwarmUnitT *, const Params &)");
+    return {typeid(TaskT), TaskT::Level,
+            std::make_shared<const Params>(std::forward<ParamsT>(p)),
+            [](SwarmUnitT *u, const ITaskParams &params) {
+              return PtrTask<SwarmUnitT>(
+                  new TaskT(u, static_cast<const Params &>(params)));
+            }};
+  }
+};
+
+/**
+ * @brief The level 0 tasks a task decomposes into, in order of execution.
+ * Plans are shared by every unit that decomposes the same task.
+ */
+template <class SwarmUnitT>
+using TaskPlan = std::vector<TaskPlanStep<SwarmUnitT>>;
+
+/**
+ * @brief Output of a decomposition rule: the subtasks of one task, each of a
+ * lower level than the task
+ */
+template <class SwarmUnitT> class TaskPlanBuilder {
+  std::uint32_t _lvl;
+  TaskPlan<SwarmUnitT> &_subtasks;
+
+public:
+  TaskPlanBuilder(std::uint32_t lvl, TaskPlan<SwarmUnitT> &subtasks)
+      : _lvl(lvl), _subtasks(subtasks) {}
+
+  template <class TaskT>
+  void add(const typename TaskT::Params &params = typename TaskT::Params()) {
+    if (TaskT::Level >= _lvl)
+      throw std::logic_error("subtask of level " + std::to_string(TaskT::Level) +
+                             " in a task of level " + std::to_string(_lvl));
+    _subtasks.push_back(TaskPlanStep<SwarmUnitT>::template of<TaskT>(params));
+  }
+};
+
+/**
+ * @brief Decomposes tasks into level 0 tasks by rules registered per task
+ * type. A rule maps the parameters of a task to its direct subtasks; the
+ * subtasks are decomposed the same way until only level 0 tasks remain.
+ *
+ * The full plan of each (task type, parameters) pair is computed once and
+ * cached, so it is the same decomposer that all units of a swarm should
+ * share. Parameters of the decomposed task types must be equality comparable
+ * and have a std::hash specialization. Rules are registered before units
+ * use the decomposer; decomposition itself is thread-safe.
+ */
+template <class SwarmUnitT> class TaskDecomposer {
+public:
+  using PlanPtr = std::shared_ptr<const TaskPlan<SwarmUnitT>>;
+
+private:
+  struct IRule {
+    virtual ~IRule() = default;
+    virtual void apply(const ITaskParams &p, TaskPlanBuilder<SwarmUnitT> &out) const = 0;
+    virtual PlanPtr find(const ITaskParams &p) const = 0;
+    virtual PlanPtr remember(const ITaskParams &p, PlanPtr plan) = 0;
+    virtual std::size_t plans() const = 0;
+  };
+  template <class TaskT> struct Rule : IRule {
+    using Params = typename TaskT::Params;
+    std::function<void(const Params &, TaskPlanBuilder<SwarmUnitT> &)> rule;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<Params, PlanPtr> cache;
+
+    void apply(const ITaskParams &p, TaskPlanBuilder<SwarmUnitT> &out) const override {
+      rule(static_cast<const Params &>(p), out);
+    }
+    PlanPtr find(const ITaskParams &p) const override {
+      std::shared_lock lock(mutex);
+      const auto it = cache.find(static_cast<const Params &>(p));
+      return it == cache.end() ? nullptr : it->second;
+    }
+    PlanPtr remember(const ITaskParams &p, PlanPtr plan) override {
+      std::unique_lock lock(mutex);
+      // If another thread got there first, every unit keeps sharing its plan
+      return cache.try_emplace(static_cast<const Params &>(p), std::move(plan))
+          .first->second;
+    }
+    std::size_t plans() const override {
+      std::shared_lock lock(mutex);
+      return cache.size();
+    }
+  };
+  std::unordered_map<std::type_index, std::unique_ptr<IRule>> _rules;
+
+public:
+  /**
+   * @brief Register how tasks of type TaskT split into subtasks. Replaces the
+   * previous rule of TaskT and forgets its plans.
+   *
+   * @param rule - callable (const TaskT::Params &, TaskPlanBuilder &), must
+   * give the same subtasks for equal parameters
+   */
+  template <class TaskT, class RuleT> void add_rule(RuleT &&rule) {
+    static_assert(TaskT::Level > 0, "level 0 tasks are not decomposed");
+    auto entry = std::make_unique<Rule<TaskT>>();
+    entry->rule = std::forward<RuleT>(rule);
+    _rules[typeid(TaskT)] = std::move(entry);
+  }
+  template <class TaskT> bool has_rule() const {
+    return _rules.count(typeid(TaskT)) != 0;
+  }
+
+  /**
+   * @brief The direct subtasks of a task, not cached
+   */
+  TaskPlan<SwarmUnitT> decompose(const IBaseTask<SwarmUnitT> &task) const {
+    TaskPlan<SwarmUnitT> subtasks;
+    if (task.get_lvl() > 0) {
+      TaskPlanBuilder<SwarmUnitT> out(task.get_lvl(), subtasks);
+      rule_of(typeid(task)).apply(task.params(), out);
+    }
+    return subtasks;
+  }
+  /**
+   * @brief The level 0 tasks of a task; empty for a level 0 task itself
+   */
+  PlanPtr plan(const IBaseTask<SwarmUnitT> &task) const {
+    if (task.get_lvl() == 0)
+      return std::make_shared<const TaskPlan<SwarmUnitT>>();
+    return plan(typeid(task), task.get_lvl(), task.params());
+  }
+  /**
+   * @brief Number of cached plans of task type TaskT
+   */
+  template <class TaskT> std::size_t plans() const {
+    const auto it = _rules.find(typeid(TaskT));
+    return it == _rules.end() ? 0 : it->second->plans();
+  }
+
+private:
+  IRule &rule_of(std::type_index type) const {
+    const auto it = _rules.find(type);
+    if (it == _rules.end())
+      throw std::logic_error(std::string("no decomposition rule for ") + type.name());
+    return *it->second;
+  }
+  PlanPtr plan(std::type_index type, std::uint32_t lvl, const ITaskParams &p) const {
+    IRule &rule = rule_of(type);
+    if (PlanPtr cached = rule.find(p))
+      return cached;
+    // Decompose one level at a time, splicing in the plans of the subtasks
+    TaskPlan<SwarmUnitT> subtasks;
+    TaskPlanBuilder<SwarmUnitT> out(lvl, subtasks);
+    rule.apply(p, out);
+    auto result = std::make_shared<TaskPlan<SwarmUnitT>>();
+    for (auto &step : subtasks) {
+      if (step.lvl == 0) {
+        result->push_back(std::move(step));
+        continue;
+      }
+      const PlanPtr sub = plan(step.type, step.lvl, *step.params);
+      result->insert(result->end(), sub->begin(), sub->end());
+    }
+    return rule.remember(p, std::move(result));
+  }
+};
+} // namespace swarm
@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+namespace swarm {
+
+/**
+ * @brief Min-heap of ids with d children per node and a position index, so
+ * the key of any id can be changed or the id removed in O(log n). Keys and
+ * ids are stored side by side in one array; with Arity 4 the children of a
+ * node share a cache line or two.
+ *
+ * @tparam Key - ordered by Compare, the smallest on top
+ * @tparam Arity - children per node, >= 2
+ */
+template <class Key, class Compare = std::less<Key>, std::size_t Arity = 4>
+class IndexedDaryHeap {
+  static_assert(Arity >= 2);
+  static constexpr std::uint32_t Absent = ~std::uint32_t(0);
+  struct Entry {
+    Key key;
+    std::uint32_t id;
+  };
+  std::vector<Entry> _heap;
+  std::vector<std::uint32_t> _position; // id -> index in _heap
+  Compare _less;
+
+public:
+  explicit IndexedDaryHeap(Compare less = Compare()) : _less(std::move(less)) {}
+
+  std::size_t size() const { return _heap.size(); }
+  bool empty() const { return _heap.empty(); }
+  bool contains(std::uint32_t id) const {
+    return id < _position.size() && _position[id] != Absent;
+  }
+  std::uint32_t top() const { return _heap.front().id; }
+  const Key &top_key() const { return _heap.front().key; }
+  const Key &key(std::uint32_t id) const { return _heap[_position[id]].key; }
+
+  /**
+   * @brief Insert an id that is not in the heap
+   */
+  void push(std::uint32_t id, const Key &key) {
+    if (id >= _position.size())
+      _position.resize(id + 1, Absent);
+    _heap.push_back({key, id});
+    _position[id] = static_cast<std::uint32_t>(_heap.size() - 1);
+    sift_up(_heap.size() - 1);
+  }
+  /**
+   * @brief Change the key of an id in the heap, either way
+   */
+  void update(std::uint32_t id, const Key &key) {
+    const std::size_t i = _position[id];
+    const bool up = _less(key, _heap[i].key);
+    _heap[i].key = key;
+    if (up)
+      sift_up(i);
+    else
+      sift_down(i);
+  }
+  void pop() { erase(top()); }
+  void erase(std::uint32_t id) {
+    const std::size_t i = _position[id];
+    _position[id] = Absent;
+    if (i + 1 == _heap.size()) {
+      _heap.pop_back();
+      return;
+    }
+    _heap[i] = _heap.back();
+    _heap.pop_back();
+    _position[_heap[i].id] = static_cast<std::uint32_t>(i);
+    if (i > 0 && _less(_heap[i].key, _heap[(i - 1) / Arity].key))
+      sift_up(i);
+    else
+      sift_down(i);
+  }
+  void clear() {
+    for (const Entry &e : _heap)
+      _position[e.id] = Absent;
+    _heap.clear();
+  }
+
+private:
+  void sift_up(std::size_t i) {
+    Entry moving = std::move(_heap[i]);
+    while (i > 0) {
+      const std::size_t parent = (i - 1) / Arity;
+      if (!_less(moving.key, _heap[parent].key))
+        break;
+      place(i, std::move(_heap[parent]));
+      i = parent;
+    }
+    place(i, std::move(moving));
+  }
+  void sift_down(std::size_t i) {
+    Entry moving = std::move(_heap[i]);
+    const std::size_t n = _heap.size();
+    for (;;) {
+      const std::size_t first = i * Arity + 1;
+      if (first >= n)
+        break;
+      std::size_t best = first;
+      const std::size_t last = std::min(first + Arity, n);
+      for (std::size_t c = first + 1; c < last; ++c) {
+        if (_less(_heap[c].key, _heap[best].key))
+          best = c;
+      }
+      if (!_less(_heap[best].key, moving.key))
+        break;
+      place(i, std::move(_heap[best]));
+      i = best;
+    }
+    place(i, std::move(moving));
+  }
+  void place(std::size_t i, Entry &&e) {
+    _position[e.id] = static_cast<std::uint32_t>(i);
+    _heap[i] = std::move(e);
+  }
+};
+
+/**
+ * @brief Pool of fixed-size blocks in power-of-two size classes, carved from
+ * large slabs and recycled through per-class free lists. Objects of different
+ * types share it; the caller keeps the size class returned by create().
+ * Not thread-safe: one pool per unit.
+ */
+class SlabPool {
+  static constexpr std::size_t MinBlock = 32;
+  static constexpr std::size_t Classes = 8; // 32 .. 4096 bytes
+  static constexpr std::size_t SlabSize = 64 * 1024;
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+  std::vector<std::unique_ptr<std::byte[]>> _slabs;
+  FreeBlock *_free[Classes] = {};
+  std::byte *_cursor = nullptr; // unused tail of the newest slab
+  std::size_t _left = 0;
+
+public:
+  static constexpr std::uint8_t Heap = 0xFF; // size class of oversized objects
+
+  SlabPool() = default;
+  SlabPool(const SlabPool &) = delete;
+  SlabPool &operator=(const SlabPool &) = delete;
+
+  static std::uint8_t size_class(std::size_t bytes) {
+    std::uint8_t c = 0;
+    for (std::size_t size = MinBlock; size < bytes; size *= 2) {
+      if (++c == Classes)
+        return Heap;
+    }
+    return c;
+  }
+
+  /**
+   * @brief Construct a T in the pool
+   *
+   * @return the object and its size class, needed by destroy()
+   */
+  template <class T, class... Args>
+  std::pair<T *, std::uint8_t> create(Args &&...args) {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+    const std::uint8_t c = size_class(sizeof(T));
+    void *memory = allocate(c, sizeof(T));
+    try {
+      return {::new (memory) T(std::forward<Args>(args)...), c};
+    } catch (...) {
+      deallocate(memory, c);
+      throw;
+    }
+  }
+  /**
+   * @brief Destroy an object made by create(), through a base class with a
+   * virtual destructor if needed
+   */
+  template <class T> void destroy(T *object, std::uint8_t c) {
+    // The block starts at the most derived object, not necessarily at *object
+    void *full;
+    if constexpr (std::is_polymorphic_v<T>)
+      full = const_cast<void *>(dynamic_cast<const volatile void *>(object));
+    else
+      full = const_cast<void *>(static_cast<const volatile void *>(object));
+    object->~T();
+    deallocate(full, c);
+  }
+
+private:
+  void *allocate(std::uint8_t c, std::size_t bytes) {
+    if (c == Heap)
+      return ::operator new(bytes);
+    if (FreeBlock *block = _free[c]) {
+      _free[c] = block->next;
+      return block;
+    }
+    const std::size_t size = MinBlock << c;
+    if (_left < size) {
+      // The rest of the old slab goes to the free lists of smaller classes
+      for (std::uint8_t small = c; small-- > 0;) {
+        const std::size_t piece = MinBlock << small;
+        while (_left >= piece) {
+          push_free(_cursor, small);
+          _cursor += piece;
+          _left -= piece;
+        }
+      }
+      _slabs.emplace_back(new std::byte[SlabSize]);
+      _cursor = _slabs.back().get();
+      _left = SlabSize;
+    }
+    void *block = _cursor;
+    _cursor += size;
+    _left -= size;
+    return block;
+  }
+  void deallocate(void *p, std::uint8_t c) {
+    if (c == Heap)
+      ::operator delete(p);
+    else
+      push_free(p, c);
+  }
+  void push_free(void *p, std::uint8_t c) {
+    _free[c] = ::new (p) FreeBlock{_free[c]};
+  }
+};
+} // namespace swarm
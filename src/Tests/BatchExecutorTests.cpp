@@ -0,0 +1,174 @@
+#include "../Swarm.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <vector>
+
+using namespace swarm;
+namespace {
+struct Mover : public BasicSwarmUnit<Mover, EmptyParams, PriorityTaskManagerC,
+                                     EmptyCommunicationC, BatchedExecutorC> {
+  double x = 0.0, y = 0.0;
+  int waited = 0;
+  void connect(BatchExecutor<Mover> &batch) { _executorC.connect(batch); }
+};
+struct Target : public ITaskParams {
+  double x = 0.0, y = 0.0;
+  Target(double tx = 0.0, double ty = 0.0) : x(tx), y(ty) {}
+};
+using MoveTo = ITask<0, Mover, Target>;
+using Wait = ITask<0, Mover>;
+using Explore = ITask<0, Mover, Target>; // same parameters, no kernel
+struct ExploreTask : public Explore {
+  using Explore::Explore;
+};
+
+// Moves at most `speed` towards the target per step
+struct MoveKernel {
+  double speed = 1.0;
+  struct Batch {
+    std::vector<double> x, y, tx, ty;
+    void resize(std::size_t n) {
+      for (auto *v : {&x, &y, &tx, &ty})
+        v->resize(n);
+    }
+  };
+  void gather(const MoveTo &task, Batch &b, std::size_t i) const {
+    b.x[i] = task.unit()->x;
+    b.y[i] = task.unit()->y;
+    b.tx[i] = task.params().x;
+    b.ty[i] = task.params().y;
+  }
+  void run(Batch &b, std::size_t begin, std::size_t end) const {
+    for (std::size_t i = begin; i < end; ++i) {
+      const double dx = b.tx[i] - b.x[i], dy = b.ty[i] - b.y[i];
+      const double d = std::sqrt(dx * dx + dy * dy);
+      const double f = d > speed ? speed / d : 1.0;
+      b.x[i] += f * dx;
+      b.y[i] += f * dy;
+    }
+  }
+  bool scatter(MoveTo &task, const Batch &b, std::size_t i) const {
+    task.unit()->x = b.x[i];
+    task.unit()->y = b.y[i];
+    const auto same = [](double a, double c) { return !(a < c) && !(c < a); };
+    return same(b.x[i], task.params().x) && same(b.y[i], task.params().y);
+  }
+};
+struct WaitKernel {
+  struct Batch {
+    void resize(std::size_t) {}
+  };
+  void gather(const Wait &, Batch &, std::size_t) {}
+  void run(Batch &, std::size_t, std::size_t) {}
+  bool scatter(Wait &task, const Batch &, std::size_t) {
+    ++task.unit()->waited;
+    return true;
+  }
+};
+
+struct MoverSwarm : public Swarm<SwarmParallelVectorContainer, EmptyParams> {
+  BatchExecutor<Mover> batch;
+  std::vector<Mover *> movers;
+  MoverSwarm(std::size_t size, std::size_t threads) : Swarm(size) {
+    _Units.set_threads(threads);
+    batch.set_pool(&_Units.pool());
+    batch.add_kernel<MoveTo>(MoveKernel{1.0});
+    batch.add_kernel<Wait>(WaitKernel{});
+    attach(batch);
+    for (std::size_t i = 0; i < size; ++i) {
+      auto *unit = new Mover();
+      unit->connect(batch);
+      auto &tasks = unit->task_manager();
+      const double far = static_cast<double>(i % 7);
+      tasks.emplace_task<MoveTo>(3.0, 0.0, Target(far, -far));
+      tasks.emplace_task<Wait>(2.0, 0.0);
+      tasks.emplace_task<MoveTo>(1.0, 0.0, Target(0.0, 0.0));
+      movers.push_back(unit);
+      _Units.add_unit(SwarmUnitLink<>(unit));
+    }
+  }
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(BatchExecutorSwarmTest) {
+  MoverSwarm serial(100, 1), parallel(100, 4);
+  serial.init();
+  parallel.init();
+  for (int s = 0; s < 5; ++s) {
+    serial.iter();
+    parallel.iter();
+    if (s == 0)
+      BOOST_CHECK_EQUAL(serial.batch.executed(), 100);
+  }
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Mover &a = *serial.movers[i], &b = *parallel.movers[i];
+    BOOST_CHECK_EQUAL(a.x, b.x);
+    BOOST_CHECK_EQUAL(a.y, b.y);
+    // The target is far * sqrt(2) away, one unit per step: by step 5 the
+    // near ones have also waited, the far ones are still on their way
+    const double distance = static_cast<double>(i % 7) * std::sqrt(2.0);
+    BOOST_CHECK_EQUAL(a.waited, distance <= 4.0 ? 1 : 0);
+    if (distance > 5.0)
+      BOOST_CHECK_CLOSE(std::hypot(a.x, a.y), 5.0, 1e-9);
+  }
+  for (int s = 0; s < 20; ++s)
+    serial.iter();
+  for (const Mover *m : serial.movers) {
+    BOOST_CHECK_EQUAL(m->x, 0.0);
+    BOOST_CHECK_EQUAL(m->y, 0.0);
+    BOOST_CHECK_EQUAL(m->waited, 1);
+    BOOST_CHECK(m->task_manager().empty());
+  }
+  BOOST_CHECK_EQUAL(serial.batch.executed(), 0);
+}
+BOOST_AUTO_TEST_CASE(BatchExecutorSkipsTest) {
+  // Tasks without a kernel, or above level 0, stay with the unit
+  BatchExecutor<Mover> batch;
+  batch.add_kernel<MoveTo>(MoveKernel{});
+  Mover unit;
+  unit.connect(batch);
+  unit.task_manager().emplace_task<ExploreTask>(1.0, 0.0, Target(1.0, 1.0));
+  unit.iter();
+  batch.end_step();
+  BOOST_CHECK_EQUAL(batch.executed(), 0);
+  BOOST_CHECK_EQUAL(unit.task_manager().size(), 1);
+  unit.task_manager().emplace_task<MoveTo>(5.0, 0.0, Target(0.5, 0.0));
+  unit.iter();
+  batch.end_step();
+  BOOST_CHECK_EQUAL(batch.executed(), 1);
+  BOOST_CHECK_EQUAL(unit.x, 0.5);
+  BOOST_CHECK_EQUAL(unit.task_manager().size(), 1);
+}
+BOOST_AUTO_TEST_CASE(BatchExecutorDisconnectTest) {
+  BatchExecutor<Mover> batch;
+  batch.add_kernel<MoveTo>(MoveKernel{});
+  {
+    Mover a, b;
+    a.connect(batch);
+    b.connect(batch);
+    BOOST_CHECK_EQUAL(batch.connected(), 2);
+  }
+  BOOST_CHECK_EQUAL(batch.connected(), 0);
+  // Short-lived units reuse the slots of the despawned ones
+  for (int i = 0; i < 100; ++i) {
+    Mover m;
+    m.connect(batch);
+    m.task_manager().emplace_task<MoveTo>(1.0, 0.0, Target(0.5, 0.0));
+    m.iter();
+    batch.end_step();
+    BOOST_CHECK_EQUAL(batch.executed(), 1);
+    BOOST_CHECK_EQUAL(batch.connected(), 1);
+  }
+  BOOST_CHECK_EQUAL(batch.connected(), 0);
+
+  // A unit outliving its batch keeps its tasks
+  Mover survivor;
+  {
+    BatchExecutor<Mover> gone;
+    survivor.connect(gone);
+  }
+  survivor.task_manager().emplace_task<MoveTo>(1.0, 0.0, Target(0.5, 0.0));
+  survivor.iter();
+  BOOST_CHECK_EQUAL(survivor.task_manager().size(), 1);
+}
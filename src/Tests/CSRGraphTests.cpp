@@ -0,0 +1,138 @@
+#include "../CSRGraph.hpp"
+#include "../TSPLIB.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace swarm;
+BOOST_AUTO_TEST_CASE(CSRGraphEdgeListTest) {
+  CSRGraph<double> g(4, {{2, 1, 5.0}, {0, 3, 1.0}, {0, 1, 2.0}, {0, 3, 0.5}});
+  BOOST_CHECK_EQUAL(g.num_vertices(), 4);
+  BOOST_CHECK_EQUAL(g.num_edges(), 3); // parallel (0, 3) merged
+  BOOST_CHECK_EQUAL(g.degree(0), 2);
+  BOOST_CHECK_EQUAL(g.neighbors(0)[0], 1);
+  BOOST_CHECK_EQUAL(g.neighbors(0)[1], 3);
+  BOOST_CHECK_EQUAL(g.weight(0, 3), 0.5);
+  BOOST_CHECK_EQUAL(g.weight(2, 1), 5.0);
+  BOOST_CHECK(std::isinf(g.weight(1, 2)));
+  BOOST_CHECK(!g.has_edge(3, 0));
+  BOOST_CHECK_EQUAL(g.degree(3), 0);
+}
+BOOST_AUTO_TEST_CASE(CSRGraphKNearestTest) {
+  std::vector<double> x, y;
+  for (int i = 0; i < 300; ++i) {
+    x.push_back(std::fmod(i * 37.3, 101.0));
+    y.push_back(std::fmod(i * 71.9, 97.0));
+  }
+  auto distance = [&](std::size_t i, std::size_t j) {
+    return std::hypot(x[i] - x[j], y[i] - y[j]);
+  };
+  constexpr std::size_t k = 5;
+  auto g = k_nearest_graph<double>(x, y, k, distance, false);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    std::vector<double> all;
+    for (std::size_t j = 0; j < x.size(); ++j)
+      if (j != i)
+        all.push_back(distance(i, j));
+    std::sort(all.begin(), all.end());
+    std::vector<double> found(g.weights(i).begin(), g.weights(i).end());
+    std::sort(found.begin(), found.end());
+    BOOST_REQUIRE_EQUAL(found.size(), k);
+    for (std::size_t c = 0; c < k; ++c)
+      BOOST_CHECK_CLOSE(found[c], all[c], 1e-9);
+  }
+  // Points on top of each other get k other points, never themselves
+  const std::vector<double> same(8, 1.0);
+  auto stacked = k_nearest_graph<double>(same, same, 3, distance, false);
+  for (std::size_t i = 0; i < same.size(); ++i) {
+    BOOST_CHECK_EQUAL(stacked.degree(i), 3);
+    BOOST_CHECK(!stacked.has_edge(i, i));
+  }
+}
+BOOST_AUTO_TEST_CASE(TSPLIBReadTest) {
+  std::istringstream in("NAME : square\n"
+                        "TYPE: TSP\n"
+                        "DIMENSION : 4\n"
+                        "EDGE_WEIGHT_TYPE : EUC_2D\n"
+                        "NODE_COORD_SECTION\n"
+                        "1 0 0\n2 3 0\n3 3 4\n4 0 4.2\n"
+                        "EOF\n");
+  auto instance = read_tsplib(in);
+  BOOST_CHECK_EQUAL(instance.name, "square");
+  BOOST_CHECK_EQUAL(instance.dimension, 4);
+  BOOST_CHECK_EQUAL(instance.distance(0, 2), 5.0);
+  BOOST_CHECK_EQUAL(instance.distance(0, 3), 4.0);
+  auto g = tsplib_graph(instance, 2);
+  BOOST_CHECK_EQUAL(g.degree(0), 2);
+  BOOST_CHECK_EQUAL(g.weight(0, 1), 3.0);
+  BOOST_CHECK_EQUAL(g.weight(1, 0), 3.0);
+}
+BOOST_AUTO_TEST_CASE(TSPLIBExplicitTest) {
+  // Same symmetric 4x4 matrix in three layouts
+  const char *header = "NAME: m\nTYPE: TSP\nDIMENSION: 4\n"
+                       "EDGE_WEIGHT_TYPE: EXPLICIT\nEDGE_WEIGHT_FORMAT: ";
+  const std::string layouts[] = {
+      "FULL_MATRIX\nEDGE_WEIGHT_SECTION\n0 1 2 3\n1 0 4 5\n2 4 0 6\n3 5 6 0\n",
+      "UPPER_ROW\nEDGE_WEIGHT_SECTION\n1 2 3\n4 5\n6\n",
+      "LOWER_DIAG_ROW\nEDGE_WEIGHT_SECTION\n0 1 0 2 4 0 3 5 6 0\n",
+      "UPPER_COL\nEDGE_WEIGHT_SECTION\n1\n2 4\n3 5 6\nEOF\n"};
+  for (const auto &layout : layouts) {
+    auto instance = parse_tsplib(header + layout);
+    BOOST_REQUIRE_EQUAL(instance.weights.size(), 16);
+    BOOST_CHECK_EQUAL(instance.distance(0, 3), 3.0);
+    BOOST_CHECK_EQUAL(instance.distance(3, 1), 5.0);
+    BOOST_CHECK_EQUAL(instance.distance(2, 3), 6.0);
+    BOOST_CHECK_EQUAL(instance.distance(2, 2), 0.0);
+  }
+  auto g = tsplib_graph(parse_tsplib(header + layouts[1]), 1);
+  BOOST_CHECK(g.has_edge(0, 1) && g.has_edge(1, 0));
+  BOOST_CHECK(g.has_edge(3, 0));
+}
+BOOST_AUTO_TEST_CASE(TSPLIBDistanceTypesTest) {
+  auto att = parse_tsplib("DIMENSION: 2\nEDGE_WEIGHT_TYPE: ATT\n"
+                          "NODE_COORD_SECTION\n1 0 0\n2 10 0\n");
+  BOOST_CHECK_EQUAL(att.distance(0, 1), 4.0); // sqrt(10) rounded up
+  // One degree of longitude on the equator is about 111.3 km
+  auto geo = parse_tsplib("DIMENSION: 2\nEDGE_WEIGHT_TYPE: GEO\n"
+                          "NODE_COORD_SECTION\n1 0.0 0.0\n2 +0.0 1.0\n");
+  BOOST_CHECK_EQUAL(geo.distance(0, 1), 112.0);
+  BOOST_CHECK_EQUAL(geo.distance(1, 1), 0.0);
+  // Node 1 is nearer to node 0 than node 2 by MAX_2D, not by Euclidean
+  // distance
+  auto max = parse_tsplib("DIMENSION: 3\nEDGE_WEIGHT_TYPE: MAX_2D\n"
+                          "NODE_COORD_SECTION\n1 0 0\n2 3 3\n3 4 0\n");
+  auto nearest = tsplib_graph(max, 1);
+  BOOST_CHECK(nearest.has_edge(0, 1));
+  BOOST_CHECK(!nearest.has_edge(0, 2));
+  BOOST_CHECK_THROW(parse_tsplib("DIMENSION: 2\nEDGE_WEIGHT_TYPE: XRAY1\n"),
+                    std::runtime_error);
+  BOOST_CHECK_THROW(parse_tsplib("DIMENSION: 2\nEDGE_WEIGHT_TYPE: EUC_2D\n"
+                                 "NODE_COORD_SECTION\n1 0 0\n"),
+                    std::runtime_error);
+}
+BOOST_AUTO_TEST_CASE(TSPLIBLoadFileTest) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "cppSwarmLib_test.vrp").string();
+  {
+    std::ofstream out(path);
+    out << "NAME : tiny\nTYPE : CVRP\nDIMENSION : 3\nEDGE_WEIGHT_TYPE : EUC_2D\n"
+           "CAPACITY : 10\nNODE_COORD_SECTION\n 1 0 0\n 2 3 4\n 3 6 8\n"
+           "DEMAND_SECTION\n1 0\n2 4\n3 7\nDEPOT_SECTION\n 1\n -1\nEOF\n";
+  }
+  auto instance = load_tsplib(path);
+  std::filesystem::remove(path);
+  BOOST_CHECK_EQUAL(instance.type, "CVRP");
+  BOOST_CHECK_EQUAL(instance.capacity, 10.0);
+  BOOST_CHECK_EQUAL(instance.distance(0, 2), 10.0);
+  BOOST_REQUIRE_EQUAL(instance.demands.size(), 3);
+  BOOST_CHECK_EQUAL(instance.demands[2], 7.0);
+  BOOST_REQUIRE_EQUAL(instance.depots.size(), 1);
+  BOOST_CHECK_EQUAL(instance.depots[0], 0);
+  BOOST_CHECK_THROW(load_tsplib(path), std::system_error);
+}
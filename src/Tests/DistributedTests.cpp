@@ -0,0 +1,123 @@
+#include "../Distributed.hpp"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace swarm;
+namespace {
+std::string shm_name(const char *what) {
+  return "/cppSwarmLibTest." + std::string(what) + "." + std::to_string(::getpid());
+}
+struct Boundary {
+  std::uint32_t rank;
+  std::uint32_t step;
+  double x;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SharedMemoryTransportTest) {
+  const std::string name = shm_name("channels");
+  auto a = SharedMemoryTransport::create(name, 2, 256);
+  auto b = SharedMemoryTransport::open(name, 1);
+  BOOST_CHECK_THROW(SharedMemoryTransport::create(name, 2), std::system_error);
+  BOOST_CHECK_THROW(SharedMemoryTransport::open(name, 2), std::invalid_argument);
+  BOOST_CHECK_EQUAL(a->rank(), 0);
+  BOOST_CHECK_EQUAL(b->rank(), 1);
+  BOOST_CHECK_EQUAL(b->ranks(), 2);
+
+  std::vector<std::byte> got;
+  BOOST_CHECK(!b->receive(0, got, std::chrono::milliseconds(1)));
+  const std::vector<int> small{1, 2, 3};
+  send_values<int>(*a, 1, small);
+  a->send(1, {});
+  BOOST_CHECK(receive_values<int>(*b, 0) == small);
+  BOOST_CHECK(b->receive(0, got));
+  BOOST_CHECK(got.empty());
+
+  // Messages far larger than the ring stream through it, both ways at once
+  std::vector<double> big(10000);
+  std::iota(big.begin(), big.end(), 0.0);
+  std::vector<double> from_a, from_b;
+  std::thread other([&] {
+    send_values<double>(*b, 0, big);
+    from_a = receive_values<double>(*b, 0);
+    b->flush();
+  });
+  send_values<double>(*a, 1, big);
+  from_b = receive_values<double>(*a, 1);
+  a->flush();
+  other.join();
+  BOOST_CHECK(from_a == big);
+  BOOST_CHECK(from_b == big);
+}
+BOOST_AUTO_TEST_CASE(MultiProcessSwarmTest) {
+  constexpr std::size_t Ranks = 3;
+  constexpr std::uint32_t Steps = 20;
+  const std::string name = shm_name("swarm");
+  auto root = SharedMemoryTransport::create(name, Ranks, 1024);
+  // Every rank is a sub-swarm on a ring of ranks: it exchanges its boundary
+  // with both neighbors and takes part in a global sum each step
+  const int result = fork_ranks(Ranks, [&](std::size_t rank) {
+    std::unique_ptr<SharedMemoryTransport> own;
+    ITransport &t = rank == 0 ? static_cast<ITransport &>(*root)
+                              : *(own = SharedMemoryTransport::open(name, rank));
+    const std::size_t left = (rank + Ranks - 1) % Ranks, right = (rank + 1) % Ranks;
+    GhostExchange<Boundary> ghosts(t, {left, right});
+    t.barrier();
+    int errors = 0;
+    for (std::uint32_t step = 0; step < Steps; ++step) {
+      for (int i = 0; i < 100; ++i) // many units at the boundary
+        ghosts.post(right, {static_cast<std::uint32_t>(rank), step, static_cast<double>(i)});
+      ghosts.post(left, {static_cast<std::uint32_t>(rank), step, -1.0});
+      ghosts.end_step();
+      const auto from_left = ghosts.ghosts(left), from_right = ghosts.ghosts(right);
+      errors += from_left.size() != 100 || from_left[99].rank != left ||
+                from_left[99].step != step || from_right.size() != 1 ||
+                from_right[0].rank != right;
+      const auto sum = allreduce(t, static_cast<std::uint64_t>(rank + step),
+                                 [](std::uint64_t x, std::uint64_t y) { return x + y; });
+      errors += sum != 3 * step + 3; // 0 + 1 + 2
+    }
+    t.barrier();
+    return errors;
+  });
+  BOOST_CHECK_EQUAL(result, 0);
+}
+BOOST_AUTO_TEST_CASE(DeadRankTest) {
+  const std::string name = shm_name("dead");
+  auto root = SharedMemoryTransport::create(name, 2, 256);
+  // Rank 1 ends without a word, once having closed its transport and once
+  // killed before it could; rank 0 throws instead of waiting forever
+  for (const bool closed : {true, false}) {
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_CHECK_THROW(fork_ranks(2,
+                                 [&](std::size_t rank) {
+                                   if (rank == 0) {
+                                     root->barrier();
+                                     return 0;
+                                   }
+                                   auto own = SharedMemoryTransport::open(name, rank);
+                                   if (!closed)
+                                     ::_exit(3);
+                                   return 3;
+                                 }),
+                      std::runtime_error);
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+  }
+  // What a rank sent before closing is still delivered
+  BOOST_CHECK_EQUAL(fork_ranks(2,
+                               [&](std::size_t rank) {
+                                 if (rank == 0)
+                                   return receive_values<int>(*root, 1) == std::vector<int>{7} ? 0
+                                                                                               : 1;
+                                 auto own = SharedMemoryTransport::open(name, rank);
+                                 send_values<int>(*own, 0, std::vector<int>{7});
+                                 own->flush();
+                                 return 0;
+                               }),
+                    0);
+}
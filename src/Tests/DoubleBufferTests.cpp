@@ -0,0 +1,78 @@
+#include "../DoubleBuffer.hpp"
+#include "../Swarm.hpp"
+#include <bit>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace swarm;
+namespace {
+// Cell of a ring that relaxes to the mean of its neighbours, reading their
+// values of the previous step
+struct Cell : public ISwarmUnit {
+  DoubleBuffer<double> &state;
+  std::size_t slot, left, right;
+  Cell(DoubleBuffer<double> &s, std::size_t i, std::size_t n)
+      : state(s), slot(s.add(static_cast<double>(i % 7))), left((i + n - 1) % n),
+        right((i + 1) % n) {}
+  void init() override {}
+  void iter() override {
+    state.write(slot) = (state.read(left) + state.read(slot) + state.read(right)) / 3;
+  }
+};
+struct Ring : public Swarm<SwarmParallelVectorContainer, EmptyParams> {
+  DoubleBuffer<double> state;
+  Ring(std::size_t n, std::size_t threads) {
+    _Units.set_threads(threads);
+    state.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      _Units.add_unit(SwarmUnitLink<>(new Cell(state, i, n)));
+    attach(state);
+  }
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(DoubleBufferRingTest) {
+  constexpr std::size_t n = 1000;
+  std::vector<double> expected(n), next(n);
+  for (std::size_t i = 0; i < n; ++i)
+    expected[i] = static_cast<double>(i % 7);
+  for (int step = 0; step < 20; ++step) {
+    for (std::size_t i = 0; i < n; ++i)
+      next[i] = (expected[(i + n - 1) % n] + expected[i] + expected[(i + 1) % n]) / 3;
+    expected.swap(next);
+  }
+  for (const std::size_t threads : {1u, 3u}) {
+    Ring ring(n, threads);
+    ring.init();
+    for (int step = 0; step < 20; ++step)
+      ring.iter();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < n; ++i)
+      mismatches += std::bit_cast<std::uint64_t>(ring.state.read(i)) !=
+                    std::bit_cast<std::uint64_t>(expected[i]);
+    BOOST_CHECK_EQUAL(mismatches, 0);
+  }
+}
+BOOST_AUTO_TEST_CASE(DoubleBufferSlotsTest) {
+  DoubleBuffer<int> plain, carried(true);
+  for (auto *buffer : {&plain, &carried}) {
+    BOOST_CHECK_EQUAL(buffer->add(1), 0);
+    BOOST_CHECK_EQUAL(buffer->add(2), 1);
+    buffer->write(0) = 10;
+    buffer->end_step();
+    BOOST_CHECK_EQUAL(buffer->read(0), 10);
+    BOOST_CHECK_EQUAL(buffer->read(1), 2);
+    buffer->end_step(); // nothing written
+  }
+  BOOST_CHECK_EQUAL(plain.read(0), 1); // the values of two steps ago
+  BOOST_CHECK_EQUAL(carried.read(0), 10);
+
+  carried.remove(0);
+  BOOST_CHECK_EQUAL(carried.size(), 1);
+  BOOST_CHECK_EQUAL(carried.add(5), 0);
+  BOOST_CHECK_EQUAL(carried.read(0), 5);
+  BOOST_CHECK_EQUAL(carried.slots(), 2);
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(carried.read().data()) % CacheLineSize, 0);
+}
@@ -0,0 +1,107 @@
+#include "../ECS.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace swarm;
+namespace {
+struct Position {
+  double x = 0.0, y = 0.0;
+};
+struct Velocity {
+  double dx = 0.0, dy = 0.0;
+};
+struct Energy {
+  int value = 0;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(EntityRegistryTest) {
+  EntityRegistry world;
+  const Entity a = world.create(), b = world.create();
+  world.emplace<Position>(a, 1.0, 2.0);
+  world.emplace<Position>(b, 3.0, 4.0);
+  world.emplace<Energy>(b, 7);
+  BOOST_CHECK(world.has<Energy>(b));
+  BOOST_CHECK(!world.has<Energy>(a));
+  BOOST_CHECK_EQUAL(world.get<Position>(b).y, 4.0);
+  world.emplace<Position>(b, 5.0, 6.0); // replaces
+  BOOST_CHECK_EQUAL(world.pool<Position>().size(), 2);
+  BOOST_CHECK_EQUAL(world.get<Position>(b).x, 5.0);
+
+  BOOST_CHECK(world.destroy(a));
+  BOOST_CHECK(!world.destroy(a));
+  BOOST_CHECK(!world.alive(a));
+  BOOST_CHECK_EQUAL(world.size(), 1);
+  BOOST_CHECK_EQUAL(world.pool<Position>().size(), 1);
+  BOOST_CHECK_EQUAL(world.get<Position>(b).x, 5.0); // moved into the hole
+
+  const Entity c = world.create(); // recycles the slot of a
+  BOOST_CHECK_EQUAL(c.index, a.index);
+  BOOST_CHECK(c.generation != a.generation);
+  BOOST_CHECK(world.alive(c));
+  BOOST_CHECK(!world.has<Position>(c));
+  BOOST_CHECK(world.try_get<Position>(a) == nullptr);
+  // The stale handle of a does not reach the components of c
+  world.emplace<Position>(c, 7.0, 0.0);
+  world.remove<Position>(a);
+  BOOST_CHECK(world.has<Position>(c));
+  BOOST_CHECK_THROW(world.get<Position>(a), std::out_of_range);
+  BOOST_CHECK_THROW(world.emplace<Energy>(a, 42), std::out_of_range);
+  BOOST_CHECK(!world.has<Energy>(c));
+  BOOST_CHECK_EQUAL(world.capacity(), 2);
+  world.remove<Energy>(b);
+  BOOST_CHECK(!world.has<Energy>(b));
+}
+BOOST_AUTO_TEST_CASE(EntityViewTest) {
+  EntityRegistry world;
+  std::vector<Entity> entities;
+  for (int i = 0; i < 1000; ++i) {
+    const Entity e = world.create();
+    entities.push_back(e);
+    world.emplace<Position>(e, static_cast<double>(i), 0.0);
+    if (i % 3 == 0)
+      world.emplace<Velocity>(e, 1.0, static_cast<double>(i));
+    if (i % 5 == 0)
+      world.emplace<Energy>(e, i);
+  }
+  for (int i = 0; i < 1000; i += 7)
+    world.destroy(entities[static_cast<std::size_t>(i)]);
+
+  // Movement pass over the entities having both components
+  auto moving = world.view<Position, Velocity>();
+  BOOST_CHECK_EQUAL(moving.size_hint(), world.pool<Velocity>().size());
+  std::size_t moved = 0;
+  moving.each([&](Entity, Position &p, const Velocity &v) {
+    p.x += v.dx;
+    p.y += v.dy;
+    ++moved;
+  });
+  std::size_t expected = 0;
+  for (int i = 0; i < 1000; ++i) {
+    const Entity e = entities[static_cast<std::size_t>(i)];
+    if (i % 7 == 0) {
+      BOOST_CHECK(!world.alive(e));
+      continue;
+    }
+    const bool has_velocity = i % 3 == 0;
+    expected += has_velocity;
+    BOOST_CHECK_EQUAL(world.get<Position>(e).x, i + (has_velocity ? 1.0 : 0.0));
+    BOOST_CHECK_EQUAL(world.get<Position>(e).y, has_velocity ? i : 0.0);
+  }
+  BOOST_CHECK_EQUAL(moved, expected);
+
+  // Three components, and a parallel pass over one column
+  std::size_t both = 0;
+  world.view<Energy, Position, Velocity>().each([&](Entity e, Energy &en, Position &, Velocity &) {
+    BOOST_CHECK_EQUAL(en.value % 15, 0);
+    BOOST_CHECK(world.alive(e));
+    ++both;
+  });
+  BOOST_CHECK_EQUAL(both, 67 - 10); // multiples of 15 but not of 105
+  ThreadPool pool(4);
+  world.view<Energy>().each(pool, [](Entity, Energy &en) { en.value = -en.value; });
+  for (const auto &en : world.pool<Energy>().values())
+    BOOST_CHECK_LE(en.value, 0);
+}
@@ -0,0 +1,199 @@
+#include "../MessageBus.hpp"
+#include "../Parallel.hpp"
+#include "../Swarm.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <vector>
+
+using namespace swarm;
+BOOST_AUTO_TEST_CASE(MpscRingTest) {
+  MpscRing<int> ring(3);
+  BOOST_CHECK_EQUAL(ring.capacity(), 4);
+  for (int i = 0; i < 4; ++i)
+    BOOST_CHECK(ring.try_push(i));
+  BOOST_CHECK(!ring.try_push(4));
+  int value = -1;
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(ring.try_pop(value));
+    BOOST_CHECK_EQUAL(value, i);
+  }
+  BOOST_CHECK(!ring.try_pop(value));
+  BOOST_CHECK(ring.try_push(5)); // wraps around
+  BOOST_CHECK(ring.try_pop(value));
+  BOOST_CHECK_EQUAL(value, 5);
+}
+BOOST_AUTO_TEST_CASE(MessageBusGroupsTest) {
+  MessageBus bus(2);
+  for (int i = 0; i < 4; ++i)
+    bus.add_endpoint();
+  const auto group = bus.add_group({0, 2});
+  bus.join(group, 3);
+  BOOST_CHECK_EQUAL(bus.multicast(0, group, 7, 1.5), 2); // not to the sender
+  BOOST_CHECK_EQUAL(bus.broadcast(1, 8, 42), 3);
+  BOOST_CHECK_EQUAL(bus.send(1, 2, 9, 43), false); // mailbox of 2 is full
+  BOOST_CHECK_EQUAL(bus.dropped(2), 1);
+
+  std::vector<Message> got;
+  auto collect = [&got](const Message &m) { got.push_back(m); };
+  BOOST_CHECK_EQUAL(bus.receive(2, collect), 2);
+  BOOST_CHECK_EQUAL(got[0].sender, 0);
+  BOOST_CHECK_EQUAL(got[0].tag, 7);
+  BOOST_CHECK_EQUAL(got[0].as<double>(), 1.5);
+  BOOST_CHECK_EQUAL(got[1].as<int>(), 42);
+  BOOST_CHECK_EQUAL(bus.receive(0, collect), 1);
+  BOOST_CHECK_EQUAL(bus.receive(1, collect), 0);
+}
+BOOST_AUTO_TEST_CASE(MessageBusConcurrentTest) {
+  constexpr std::size_t per_worker = 20000;
+  ThreadPool pool(4);
+  MessageBus bus(256);
+  for (std::size_t i = 0; i < pool.size(); ++i)
+    bus.add_endpoint();
+  // Workers 1..3 flood endpoint 0 while worker 0 drains it
+  std::vector<std::size_t> last(pool.size(), 0);
+  std::size_t received = 0;
+  bool ordered = true;
+  pool.run([&](std::size_t worker) {
+    const auto id = static_cast<MessageBus::EndpointId>(worker);
+    if (worker != 0) {
+      for (std::size_t i = 1; i <= per_worker;) {
+        if (bus.send(id, 0, 0, i))
+          ++i;
+      }
+      return;
+    }
+    while (received < per_worker * (pool.size() - 1)) {
+      received += bus.receive(0, [&](const Message &m) {
+        const auto i = m.as<std::size_t>();
+        ordered = ordered && i == last[m.sender] + 1;
+        last[m.sender] = i;
+      });
+    }
+  });
+  BOOST_CHECK(ordered); // FIFO per sender
+  BOOST_CHECK_EQUAL(received, per_worker * (pool.size() - 1));
+}
+BOOST_AUTO_TEST_CASE(MailboxCommunicationSwarmTest) {
+  struct GossipUnit : public BasicSwarmUnit<GossipUnit, EmptyParams,
+                                            EmptyTaskManagerC,
+                                            MailboxCommunicationC> {
+    std::size_t heard = 0;
+    bool talk = true;
+    void connect(MessageBus &bus) { _communicationC.connect(bus); }
+    void iter() {
+      BasicSwarmUnit::iter();
+      heard += _communicationC.received().size();
+      if (talk)
+        _communicationC.broadcast(0, _communicationC.id());
+    }
+  };
+  struct GossipSwarm : public Swarm<SwarmParallelVectorContainer, EmptyParams> {
+    MessageBus bus{64};
+    explicit GossipSwarm(std::size_t size) : Swarm(size) {
+      _Units.set_threads(4);
+      attach(bus);
+      for (std::size_t i = 0; i < size; ++i) {
+        auto *unit = new GossipUnit();
+        unit->connect(bus);
+        _Units.add_unit(SwarmUnitLink<>(unit));
+      }
+    }
+  };
+  constexpr std::size_t size = 32;
+  constexpr std::size_t steps = 5;
+  GossipSwarm swarm(size);
+  swarm.init();
+  for (std::size_t s = 0; s < steps; ++s)
+    swarm.iter();
+  // One quiet step picks up what was sent after a receiver had already run
+  swarm.for_each([](ISwarmUnit &u) { dynamic_cast<GossipUnit &>(u).talk = false; });
+  swarm.iter();
+  std::size_t heard = 0;
+  swarm.for_each([&heard](ISwarmUnit &u) { heard += dynamic_cast<GossipUnit &>(u).heard; });
+  BOOST_CHECK_EQUAL(heard, steps * size * (size - 1));
+  BOOST_CHECK_EQUAL(swarm.bus.step(), steps + 1);
+}
+BOOST_AUTO_TEST_CASE(MessageBusStepSynchronousTest) {
+  MessageBus bus(8, MessageDelivery::StepSynchronous);
+  for (int i = 0; i < 3; ++i)
+    bus.add_endpoint();
+  const auto group = bus.add_group({0, 1});
+  BOOST_CHECK_EQUAL(bus.broadcast(2, 1, 10), 2);
+  BOOST_CHECK_EQUAL(bus.multicast(1, group, 2, 20), 1);
+  BOOST_CHECK(bus.send(0, 0, 3, 30)); // to itself
+  std::vector<int> got;
+  auto collect = [&got](const Message &m) { got.push_back(m.as<int>()); };
+  BOOST_CHECK_EQUAL(bus.receive(0, collect), 0); // nothing before the barrier
+  bus.end_step();
+  BOOST_CHECK_EQUAL(bus.receive(0, collect), 3);
+  BOOST_CHECK((got == std::vector<int>{30, 20, 10})); // sender order
+  BOOST_CHECK_EQUAL(bus.receive(0, collect), 0);
+  bus.end_step();
+  got.clear();
+  BOOST_CHECK_EQUAL(bus.receive(1, collect), 0); // unread messages expire
+  for (int i = 0; i < 10; ++i)
+    bus.send(0, 1, 0, i);
+  bus.end_step();
+  BOOST_CHECK_EQUAL(bus.receive(1, collect), 8);
+  BOOST_CHECK_EQUAL(bus.dropped(1), 2);
+}
+BOOST_AUTO_TEST_CASE(StepSynchronousSwarmTest) {
+  // Every unit sends its step number to a few others; what a unit sees each
+  // step must be the same for any number of threads
+  struct EchoUnit : public BasicSwarmUnit<EchoUnit, EmptyParams,
+                                          EmptyTaskManagerC,
+                                          MailboxCommunicationC> {
+    std::size_t step = 0;
+    std::size_t units = 0;
+    bool late = false;
+    std::vector<std::uint32_t> seen;
+    void connect(MessageBus &bus, std::size_t size) {
+      _communicationC.connect(bus);
+      units = size;
+    }
+    void iter() {
+      BasicSwarmUnit::iter();
+      for (const auto &m : _communicationC.received()) {
+        late = late || m.as<std::size_t>() + 1 != step;
+        seen.push_back(m.sender);
+      }
+      const auto id = _communicationC.id();
+      for (std::size_t k = 1; k <= 3; ++k)
+        _communicationC.send(static_cast<MessageBus::EndpointId>(
+                                 (id * 7 + k * (step + 1)) % units),
+                             0, step);
+      ++step;
+    }
+  };
+  struct EchoSwarm : public Swarm<SwarmParallelVectorContainer, EmptyParams> {
+    MessageBus bus{64, MessageDelivery::StepSynchronous};
+    EchoSwarm(std::size_t size, std::size_t threads) : Swarm(size) {
+      _Units.set_threads(threads);
+      attach(bus);
+      for (std::size_t i = 0; i < size; ++i) {
+        auto *unit = new EchoUnit();
+        unit->connect(bus, size);
+        _Units.add_unit(SwarmUnitLink<>(unit));
+      }
+    }
+    std::vector<std::vector<std::uint32_t>> seen() {
+      std::vector<std::vector<std::uint32_t>> all;
+      for_each([&all](ISwarmUnit &u) {
+        const auto &unit = dynamic_cast<EchoUnit &>(u);
+        BOOST_CHECK(!unit.late);
+        all.push_back(unit.seen);
+      });
+      return all;
+    }
+  };
+  EchoSwarm serial(50, 1), parallel(50, 4);
+  serial.init();
+  parallel.init();
+  for (int s = 0; s < 20; ++s) {
+    serial.iter();
+    parallel.iter();
+  }
+  const auto expected = serial.seen();
+  BOOST_CHECK(!expected[0].empty());
+  BOOST_CHECK(parallel.seen() == expected);
+}
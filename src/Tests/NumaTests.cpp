@@ -0,0 +1,110 @@
+#include "../Numa.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using namespace swarm;
+namespace {
+std::atomic<int> foreign{0}; // units run outside their partition
+
+struct Particle : public ISwarmUnit {
+  ExchangeBuffer<double> *best;
+  std::size_t partition;
+  double value;
+  double global_best = std::numeric_limits<double>::max();
+  Particle(ExchangeBuffer<double> *b, std::size_t p, double v)
+      : best(b), partition(p), value(v) {}
+  void init() override {}
+  void iter() override {
+    if (numa_partition() != partition)
+      ++foreign;
+    for (const double v : best->received())
+      global_best = std::min(global_best, v);
+    best->post(value);
+  }
+};
+struct NumaSwarm : public Swarm<SwarmNumaContainer, EmptyParams> {
+  SwarmNumaContainer<> &units() { return _Units; }
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(NumaTopologyTest) {
+  BOOST_CHECK(NumaTopology::parse_cpulist("0-3,8,10-11\n") ==
+              (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  BOOST_CHECK(NumaTopology::parse_cpulist("").empty());
+  BOOST_CHECK_THROW(NumaTopology::parse_cpulist("0-"), std::invalid_argument);
+  BOOST_CHECK_THROW(NumaTopology::parse_cpulist("1;2"), std::invalid_argument);
+
+  // A fake sysfs: two nodes on CPU 0, one on a CPU we may not use
+  const auto root = std::filesystem::temp_directory_path() / "cppSwarmLibNumaTest";
+  std::filesystem::remove_all(root);
+  for (const char *node : {"node1", "node0", "node7", "nodefoo"}) {
+    std::filesystem::create_directories(root / node);
+    std::ofstream(root / node / "cpulist") << (node[4] == '7' ? "100000\n" : "0\n");
+  }
+  const NumaTopology fake = NumaTopology::detect(root);
+  std::filesystem::remove_all(root);
+  BOOST_CHECK_EQUAL(fake.nodes.size(), 2);
+  BOOST_CHECK_EQUAL(fake.cpus(), 2);
+  BOOST_CHECK(NumaTopology::detect(root).nodes.size() == 1); // no sysfs
+  BOOST_CHECK_GE(NumaTopology::detect().cpus(), 1);
+  BOOST_CHECK_EQUAL(NumaTopology::single(3).cpus(), 3);
+
+  bool pinned = false;
+  std::thread([&pinned] {
+    const int cpu = 0;
+    pinned = pin_current_thread(std::span<const int>(&cpu, 1));
+  }).join();
+#ifdef __linux__
+  BOOST_CHECK(pinned);
+#endif
+}
+BOOST_AUTO_TEST_CASE(NumaContainerTest) {
+  NumaSwarm swarm;
+  // Two nodes sharing CPU 0, with two workers each
+  swarm.units().set_topology(NumaTopology{{{0}, {0}}}, 2);
+  BOOST_CHECK(swarm.units().pinned());
+  BOOST_CHECK_EQUAL(swarm.units().partitions(), 2);
+  BOOST_CHECK_EQUAL(swarm.units().workers(), 4);
+  BOOST_CHECK_EQUAL(swarm.units().pool().size(), 5);
+  BOOST_CHECK_EQUAL(swarm.units().partition_of_worker(3), 1);
+
+  ExchangeBuffer<double> best(swarm.units());
+  swarm.attach(best);
+  swarm.units().create_units(101, [&best](std::size_t p, std::size_t i) {
+    return new Particle(&best, p, 1000.0 - static_cast<double>(i));
+  });
+  BOOST_CHECK_EQUAL(swarm.size(), 101);
+  BOOST_CHECK_EQUAL(swarm.units().partition_size(0), 50);
+  BOOST_CHECK_EQUAL(swarm.units().partition_size(1), 51);
+  swarm.units().add_unit(SwarmUnitLink<>(new Particle(&best, 0, 5000.0)));
+  BOOST_CHECK_EQUAL(swarm.units().partition_size(0), 51);
+  BOOST_CHECK_THROW(swarm.units().set_topology(NumaTopology::single(1)), std::logic_error);
+
+  swarm.init();
+  swarm.iter();
+  swarm.iter();
+  BOOST_CHECK_EQUAL(foreign, 0);
+  BOOST_CHECK_EQUAL(best.received(0).size(), 102);
+  BOOST_CHECK_EQUAL(best.received(1).size(), 102);
+  swarm.for_each([](ISwarmUnit &u) {
+    BOOST_CHECK_EQUAL(static_cast<Particle &>(u).global_best, 900.0);
+  });
+
+  // Despawning through the commands empties slots in both partitions
+  std::vector<const ISwarmUnit *> gone;
+  swarm.for_each([&gone](ISwarmUnit &u) {
+    if (static_cast<Particle &>(u).value < 950.0)
+      gone.push_back(&u);
+  });
+  for (const auto *u : gone)
+    swarm.commands().despawn(u);
+  swarm.iter();
+  BOOST_CHECK_EQUAL(swarm.size(), 102 - 50);
+  BOOST_CHECK_EQUAL(foreign, 0);
+}
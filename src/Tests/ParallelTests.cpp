@@ -0,0 +1,63 @@
+#include "../Parallel.hpp"
+#include <bit>
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using namespace swarm;
+BOOST_AUTO_TEST_CASE(ThreadPoolParallelForTest) {
+  ThreadPool pool(4);
+  BOOST_CHECK_EQUAL(pool.size(), 4);
+  std::vector<int> v(1000, 0);
+  std::vector<std::size_t> owner(v.size());
+  pool.parallel_for(v.size(),
+                    [&](std::size_t begin, std::size_t end, std::size_t w) {
+                      for (auto i = begin; i < end; ++i) {
+                        v[i] += 1;
+                        owner[i] = w;
+                      }
+                    });
+  BOOST_CHECK_EQUAL(std::accumulate(v.begin(), v.end(), 0), 1000);
+  for (std::size_t i = 0; i < v.size(); ++i)
+    BOOST_CHECK_EQUAL(owner[i], ThreadPool::block_of(v.size(), 4, i));
+}
+BOOST_AUTO_TEST_CASE(ThreadPoolExceptionTest) {
+  ThreadPool pool(3);
+  BOOST_CHECK_THROW(pool.run([](std::size_t w) {
+    if (w == 2)
+      throw std::runtime_error("worker");
+  }),
+                    std::runtime_error);
+  int calls = 0;
+  pool.run([&](std::size_t w) {
+    if (w == 0)
+      ++calls;
+  });
+  BOOST_CHECK_EQUAL(calls, 1);
+}
+BOOST_AUTO_TEST_CASE(OrderedReduceTest) {
+  // Magnitudes far apart, so the grouping of the sum shows in the last bits
+  std::vector<double> v(10007);
+  for (std::size_t i = 0; i < v.size(); ++i)
+    v[i] = (i % 3 == 0 ? 1e8 : 1e-3) * (1.0 + 1.0 / static_cast<double>(i + 1));
+  const auto plus = [](double a, double b) { return a + b; };
+  const auto value = [&v](std::size_t i) { return v[i]; };
+
+  const double tree = tree_reduce(std::span<const double>(v), 0.0, plus);
+  const auto bits = [](double d) { return std::bit_cast<std::uint64_t>(d); };
+  for (const std::size_t threads : {1u, 2u, 3u, 4u}) {
+    ThreadPool pool(threads);
+    BOOST_CHECK_EQUAL(bits(ordered_reduce(pool, v.size(), 0.0, value, plus, 1)), bits(tree));
+    const double blocked = ordered_reduce(pool, v.size(), 0.0, value, plus);
+    ThreadPool serial(1);
+    BOOST_CHECK_EQUAL(bits(blocked), bits(ordered_reduce(serial, v.size(), 0.0, value, plus)));
+  }
+  ThreadPool pool(3);
+  BOOST_CHECK_EQUAL(ordered_reduce(pool, 0, 42, [](std::size_t) { return 1; }, std::plus<>()), 42);
+  BOOST_CHECK_EQUAL(ordered_reduce(pool, 1000, 0, [](std::size_t i) { return static_cast<int>(i); },
+                                   std::plus<>(), 7),
+                    999 * 1000 / 2);
+}
@@ -0,0 +1,29 @@
+#include "../Random.hpp"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+using namespace swarm;
+BOOST_AUTO_TEST_CASE(RandomStreamTest) {
+  RandomStream a(7, 3), b(7, 3), other(7, 4), reseeded(8, 3);
+  std::vector<std::uint64_t> first;
+  for (int i = 0; i < 100; ++i) {
+    first.push_back(a());
+    BOOST_CHECK_EQUAL(first.back(), b());
+  }
+  int same = 0;
+  for (int i = 0; i < 100; ++i)
+    same += (other() == first[static_cast<std::size_t>(i)]) +
+            (reseeded() == first[static_cast<std::size_t>(i)]);
+  BOOST_CHECK_EQUAL(same, 0);
+
+  double sum = 0;
+  for (int i = 0; i < 10000; ++i) {
+    const double x = a.rnd(-2, 3);
+    BOOST_CHECK(x >= -2 && x < 3);
+    sum += x;
+  }
+  BOOST_CHECK_CLOSE(sum / 10000, 0.5, 5);
+  std::uniform_int_distribution<int> dice(1, 6);
+  const int roll = dice(a);
+  BOOST_CHECK(roll >= 1 && roll <= 6);
+}
@@ -0,0 +1,237 @@
+#include "../SpatialIndex.hpp"
+#include "../Swarm.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace swarm;
+namespace {
+template <std::size_t D> std::vector<SpatialPoint<D>> random_points(std::size_t n, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> coord(-50.0, 50.0);
+  std::vector<SpatialPoint<D>> points(n);
+  for (auto &p : points) {
+    for (auto &x : p)
+      x = coord(rng);
+  }
+  // A dense cluster and exact duplicates
+  for (std::size_t i = 0; i < n / 10; ++i)
+    for (std::size_t d = 0; d < D; ++d)
+      points[i][d] = 3.0 + coord(rng) / 100.0;
+  points[n - 1] = points[n - 2];
+  return points;
+}
+
+template <class IndexT> void check_against_brute_force(IndexT index) {
+  using Point = typename IndexT::Point;
+  const auto points = random_points<std::tuple_size_v<Point>>(2000, 7);
+  index.build(points);
+  BOOST_REQUIRE_EQUAL(index.size(), points.size());
+  std::vector<std::pair<double, std::uint32_t>> nearest;
+  for (std::size_t q = 0; q < points.size(); q += 37) {
+    // Queries from the points themselves and from outside the point set
+    Point query = points[q];
+    if (q % 2)
+      query[0] += 80.0;
+    std::vector<std::pair<double, std::uint32_t>> all;
+    for (std::size_t j = 0; j < points.size(); ++j)
+      all.emplace_back(detail::squared_distance(points[j], query),
+                       static_cast<std::uint32_t>(j));
+    std::sort(all.begin(), all.end());
+
+    std::vector<std::uint32_t> found;
+    index.for_each_in_radius(query, 12.0, [&](std::uint32_t j, double) { found.push_back(j); });
+    std::sort(found.begin(), found.end());
+    std::vector<std::uint32_t> expected;
+    for (const auto &[d2, j] : all)
+      if (d2 <= 144.0)
+        expected.push_back(j);
+    std::sort(expected.begin(), expected.end());
+    BOOST_CHECK(found == expected);
+
+    index.k_nearest(query, 9, nearest);
+    BOOST_REQUIRE_EQUAL(nearest.size(), 9);
+    for (std::size_t k = 0; k < 9; ++k)
+      BOOST_CHECK_EQUAL(nearest[k].first, all[k].first);
+  }
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(UniformGridQueryTest) {
+  check_against_brute_force(UniformGrid<2>());
+  check_against_brute_force(UniformGrid<3>(12.0));
+  check_against_brute_force(UniformGrid<3>(0.01)); // enlarged to fit the points
+}
+BOOST_AUTO_TEST_CASE(KdTreeQueryTest) {
+  check_against_brute_force(KdTree<2>());
+  check_against_brute_force(KdTree<3>());
+}
+BOOST_AUTO_TEST_CASE(SpatialHashQueryTest) {
+  check_against_brute_force(SpatialHash<2>(4.0));
+  check_against_brute_force(SpatialHash<3>(12.0));
+}
+BOOST_AUTO_TEST_CASE(SpatialHashUpdateTest) {
+  auto points = random_points<2>(1000, 3);
+  SpatialHash<2> hash(2.0);
+  hash.build(points);
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<double> step(-0.5, 0.5);
+  std::size_t moved = 0;
+  for (int s = 0; s < 10; ++s) {
+    for (auto &p : points) {
+      p[0] += step(rng);
+      p[1] += step(rng);
+    }
+    moved += hash.update(points);
+  }
+  BOOST_CHECK_GT(moved, 0);
+  BOOST_CHECK_LT(moved, 10 * points.size() / 2); // most points stay in their cell
+  SpatialHash<2> fresh(2.0);
+  fresh.build(points);
+  for (std::size_t q = 0; q < points.size(); q += 17) {
+    std::vector<std::uint32_t> a, b;
+    hash.for_each_in_radius(points[q], 3.0, [&](std::uint32_t j, double) { a.push_back(j); });
+    fresh.for_each_in_radius(points[q], 3.0, [&](std::uint32_t j, double) { b.push_back(j); });
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    BOOST_CHECK(a == b);
+  }
+}
+BOOST_AUTO_TEST_CASE(SpatialHashCompactTest) {
+  // The swarm drifts away, leaving a trail of empty cells behind
+  auto points = random_points<2>(500, 4);
+  SpatialHash<2> hash(2.0);
+  hash.build(points);
+  const std::size_t cells = hash.cells();
+  for (int s = 0; s < 50; ++s) {
+    for (auto &p : points)
+      p[0] += 3.0;
+    hash.update(points);
+  }
+  BOOST_CHECK_LE(hash.cells(), cells + cells / 3);
+  SpatialHash<2> fresh(2.0);
+  fresh.build(points);
+  std::vector<std::pair<double, std::uint32_t>> a, b;
+  for (std::size_t q = 0; q < points.size(); q += 13) {
+    hash.k_nearest(points[q], 5, a);
+    fresh.k_nearest(points[q], 5, b);
+    BOOST_CHECK(a == b);
+  }
+}
+BOOST_AUTO_TEST_CASE(VerletNeighborListsTest) {
+  using Index = UnitSpatialIndex<SpatialHash<2>>;
+  auto points = random_points<2>(800, 9);
+  Index space{SpatialHash<2>(3.0)};
+  for (const auto &p : points)
+    space.add(p);
+  space.track_neighbors(2.0, 1.0);
+  space.rebuild();
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> step(-0.05, 0.05);
+  constexpr int steps = 30;
+  for (int s = 0; s < steps; ++s) {
+    for (std::uint32_t i = 0; i < points.size(); ++i) {
+      points[i][0] += step(rng);
+      points[i][1] += step(rng);
+      space.set_position(i, points[i]);
+    }
+    space.end_step();
+    for (std::uint32_t i = 0; i < points.size(); i += 13) {
+      std::vector<std::uint32_t> found, expected;
+      space.for_each_neighbor(i, [&](std::uint32_t j, double) { found.push_back(j); });
+      for (std::uint32_t j = 0; j < points.size(); ++j)
+        if (j != i && detail::squared_distance(points[i], points[j]) <= 4.0)
+          expected.push_back(j);
+      std::sort(found.begin(), found.end());
+      BOOST_CHECK(found == expected);
+    }
+  }
+  // 0.07 per step at most, skin / 2 = 0.5: rebuilt every 7 steps or so
+  BOOST_CHECK_LT(space.neighbor_lists().builds(), steps / 3);
+}
+BOOST_AUTO_TEST_CASE(SpatialIndexEmptyTest) {
+  UniformGrid<2> grid;
+  KdTree<2> tree;
+  grid.build({});
+  tree.build({});
+  std::vector<std::pair<double, std::uint32_t>> nearest{{1.0, 1}};
+  grid.k_nearest({0, 0}, 3, nearest);
+  BOOST_CHECK(nearest.empty());
+  tree.k_nearest({0, 0}, 3, nearest);
+  BOOST_CHECK(nearest.empty());
+  int calls = 0;
+  grid.for_each_in_radius({0, 0}, 1.0, [&](auto, auto) { ++calls; });
+  tree.for_each_in_radius({0, 0}, 1.0, [&](auto, auto) { ++calls; });
+  BOOST_CHECK_EQUAL(calls, 0);
+}
+BOOST_AUTO_TEST_CASE(ParallelNeighborListsTest) {
+  const auto points = random_points<2>(3000, 11);
+  UniformGrid<2> grid(5.0);
+  grid.build(points);
+  KdTree<2> tree;
+  tree.build(points);
+  ThreadPool pool(4);
+  const auto by_grid = radius_neighbors(grid, std::span(points), 5.0, pool);
+  const auto by_tree = radius_neighbors(tree, std::span(points), 5.0, pool);
+  BOOST_REQUIRE_EQUAL(by_grid.size(), points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    std::vector<std::uint32_t> a(by_grid[i].begin(), by_grid[i].end());
+    std::vector<std::uint32_t> b(by_tree[i].begin(), by_tree[i].end());
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(!std::binary_search(a.begin(), a.end(), i));
+  }
+  const auto knn = k_nearest_neighbors(tree, std::span(points), 4, pool);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(knn[i].size(), 4);
+    BOOST_CHECK(std::find(knn[i].begin(), knn[i].end(), i) == knn[i].end());
+  }
+}
+BOOST_AUTO_TEST_CASE(UnitSpatialIndexSwarmTest) {
+  // Units on a line walk right; each counts the units within 1.5 of it as of
+  // the last barrier
+  using Index = UnitSpatialIndex<UniformGrid<2>>;
+  struct Walker : public ISwarmUnit {
+    Index &space;
+    Index::Id id;
+    std::size_t near = 0;
+    Walker(Index &s, double x) : space(s), id(s.add({x, 0.0})) {}
+    void init() override {}
+    void iter() override {
+      near = 0;
+      space.for_each_in_radius(space.position(id), 1.5,
+                               [this](std::uint32_t j, double) { near += j != id; });
+      auto p = space.position(id);
+      p[0] += static_cast<double>(id); // spreads the line out
+      space.set_position(id, p);
+    }
+  };
+  struct WalkSwarm : public Swarm<SwarmParallelVectorContainer, EmptyParams> {
+    Index space{UniformGrid<2>(1.5)};
+    WalkSwarm() : Swarm(10) {
+      _Units.set_threads(3);
+      for (int i = 0; i < 10; ++i)
+        _Units.add_unit(SwarmUnitLink<>(new Walker(space, i)));
+      space.rebuild();
+      attach(space);
+    }
+    std::size_t near(std::size_t i) {
+      std::size_t k = 0, result = 0;
+      for_each([&](ISwarmUnit &u) {
+        if (k++ == i)
+          result = dynamic_cast<Walker &>(u).near;
+      });
+      return result;
+    }
+  };
+  WalkSwarm swarm;
+  swarm.init();
+  swarm.iter(); // positions 0..9, spacing 1
+  BOOST_CHECK_EQUAL(swarm.near(0), 1);
+  BOOST_CHECK_EQUAL(swarm.near(5), 2);
+  swarm.iter(); // positions 2i, spacing 2: isolated, as seen by every unit
+  BOOST_CHECK_EQUAL(swarm.near(5), 0);
+}
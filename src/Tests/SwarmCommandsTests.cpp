@@ -0,0 +1,114 @@
+#include "../Swarm.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+using namespace swarm;
+namespace {
+std::atomic<int> alive_units{0};
+
+// Lives `lifespan` steps, then despawns itself and spawns two children if it
+// is even-numbered, none otherwise
+struct Mortal : public ISwarmUnit {
+  SwarmCommands<> &commands;
+  int id;
+  int lifespan;
+  int age = 0;
+  bool initialized = false;
+  Mortal(SwarmCommands<> &c, int i, int life) : commands(c), id(i), lifespan(life) {
+    ++alive_units;
+  }
+  ~Mortal() override { --alive_units; }
+  void init() override { initialized = true; }
+  void iter() override {
+    BOOST_ASSERT(initialized);
+    if (++age < lifespan)
+      return;
+    commands.despawn(this);
+    if (id % 2 == 0) {
+      commands.spawn<Mortal>(commands, 2 * id + 1, lifespan);
+      commands.spawn<Mortal>(commands, 2 * id + 2, lifespan);
+    }
+  }
+};
+
+template <template <class> class ContainerT>
+struct Population : public Swarm<ContainerT, EmptyParams> {
+  Population(int size, int lifespan)
+      : Swarm<ContainerT, EmptyParams>(static_cast<std::size_t>(size)) {
+    for (int i = 0; i < size; ++i)
+      this->_Units.add_unit(SwarmUnitLink<>(new Mortal(this->commands(), i, lifespan)));
+  }
+  std::size_t reserved() const { return this->_Units.reserved_size(); }
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SwarmCommandsChurnTest) {
+  {
+    Population<SwarmParallelVectorContainer> swarm(1000, 1);
+    swarm.init();
+    // Every step half the units die childless and half split in two: the
+    // population stays at 1000 and the slots are recycled
+    for (int step = 0; step < 20; ++step) {
+      swarm.iter();
+      BOOST_CHECK_EQUAL(swarm.size(), 1000);
+      BOOST_CHECK_EQUAL(swarm.commands().pending(), 0);
+      BOOST_CHECK_EQUAL(alive_units, 1000);
+    }
+    BOOST_CHECK_EQUAL(swarm.reserved(), 1000);
+    std::vector<int> ids;
+    swarm.for_each([&ids](ISwarmUnit &u) { ids.push_back(static_cast<Mortal &>(u).id); });
+    BOOST_CHECK_EQUAL(ids.size(), 1000);
+    BOOST_CHECK(std::all_of(ids.begin(), ids.end(), [](int id) { return id >= 1000; }));
+  }
+  BOOST_CHECK_EQUAL(alive_units, 0);
+
+  Population<SwarmUnorderedSetContainer> set(100, 3);
+  set.init();
+  for (int step = 0; step < 2; ++step)
+    set.iter();
+  BOOST_CHECK_EQUAL(set.size(), 100);
+  set.iter(); // all 100 die, 50 of them with two children
+  BOOST_CHECK_EQUAL(set.size(), 100);
+  BOOST_CHECK_EQUAL(alive_units, 100);
+  BOOST_CHECK_EQUAL(set.reserved(), 100);
+}
+BOOST_AUTO_TEST_CASE(SwarmCommandsDeferTest) {
+  SwarmVectorContainer<> units;
+  SwarmCommands<> commands(4);
+  MessageBus bus;
+  const auto a = bus.add_group(), b = bus.add_group();
+  std::vector<MessageBus::EndpointId> endpoints;
+  for (int i = 0; i < 6; ++i) {
+    endpoints.push_back(bus.add_endpoint());
+    bus.join(a, endpoints.back());
+  }
+  Mortal *first = nullptr;
+  for (int i = 0; i < 3; ++i) {
+    auto *m = new Mortal(commands, i, 100);
+    first = first ? first : m;
+    units.add_unit(SwarmUnitLink<>(m));
+  }
+  // Move the odd endpoints to group b, despawn one unit twice
+  for (std::size_t i = 1; i < endpoints.size(); i += 2)
+    commands.defer([&bus, a, b, e = endpoints[i]] {
+      bus.leave(a, e);
+      bus.join(b, e);
+    });
+  commands.despawn(first);
+  commands.despawn(first);
+  commands.spawn<Mortal>(commands, 10, 100);
+  BOOST_CHECK_EQUAL(commands.pending(), 6);
+  commands.apply(units);
+  BOOST_CHECK_EQUAL(commands.pending(), 0);
+  BOOST_CHECK_EQUAL(units.size(), 3);
+  BOOST_CHECK_EQUAL(bus.group(a).size(), 3);
+  BOOST_CHECK_EQUAL(bus.group(b).size(), 3);
+  std::vector<int> ids;
+  units.for_each([&ids](ISwarmUnit &u) {
+    BOOST_CHECK(static_cast<Mortal &>(u).initialized || static_cast<Mortal &>(u).id != 10);
+    ids.push_back(static_cast<Mortal &>(u).id);
+  });
+  BOOST_CHECK(ids == (std::vector<int>{10, 1, 2})); // took the freed slot
+}
@@ -11,4 +11,30 @@ BOOST_AUTO_TEST_CASE(VectorContTest) {
   }
   BOOST_CHECK_EQUAL(svc.size(), size);
 }
-BOOST_AUTO_TEST_CASE(SetContTest) {}
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(SetContTest) {}
+BOOST_AUTO_TEST_CASE(ParallelVectorContTest) {
+  struct CountingUnit : public ISwarmUnit {
+    int inits = 0;
+    int iters = 0;
+    void init() override { ++inits; }
+    void iter() override { ++iters; }
+  };
+  constexpr auto size = 100;
+  SwarmParallelVectorContainer svc(size);
+  svc.set_threads(4);
+  BOOST_CHECK_EQUAL(svc.pool().size(), 4);
+  for (auto i = 0; i < size; i++) {
+    svc.add_unit(SwarmUnitLink(new CountingUnit()));
+  }
+  svc.init();
+  svc.iter();
+  svc.iter();
+  int units = 0;
+  svc.for_each([&units](ISwarmUnit &u) {
+    const auto &c = dynamic_cast<const CountingUnit &>(u);
+    BOOST_CHECK_EQUAL(c.inits, 1);
+    BOOST_CHECK_EQUAL(c.iters, 2);
+    ++units;
+  });
+  BOOST_CHECK_EQUAL(units, size);
+}
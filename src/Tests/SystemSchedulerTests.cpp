@@ -0,0 +1,143 @@
+#include "../Swarm.hpp"
+#include "../SystemScheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <vector>
+
+using namespace swarm;
+namespace {
+struct Position {
+  double x = 0.0;
+};
+struct Velocity {
+  double dx = 0.0;
+};
+struct Heading {
+  double angle = 0.0;
+};
+struct Heard {};
+struct Moved {};
+
+template <class U> class ListenC : public ICommunicationUnitC<EmptyParams, U> {
+public:
+  using Reads = swarm::Reads<>;
+  using Writes = swarm::Writes<Heard>;
+  ListenC(U *u) : ICommunicationUnitC<EmptyParams, U>(u) {}
+  void init() final {}
+  void iter() final { ++this->_U->heard; }
+};
+template <class U> class MoveC : public IExecutorUnitC<EmptyParams, U> {
+public:
+  using Reads = swarm::Reads<>;
+  using Writes = swarm::Writes<Moved>;
+  MoveC(U *u) : IExecutorUnitC<EmptyParams, U>(u) {}
+  void init() final {}
+  void iter() final { ++this->_U->moved; }
+};
+struct Walker : public BasicSwarmUnit<Walker, EmptyParams, EmptyTaskManagerC, ListenC, MoveC> {
+  int heard = 0, moved = 0;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SystemSchedulerStagesTest) {
+  SystemScheduler s;
+  auto none = [] { return std::size_t(0); };
+  auto nop = [](std::size_t, std::size_t, std::size_t) {};
+  const auto a = s.add_system<Reads<>, Writes<Position>>("a", none, nop);
+  const auto b = s.add_system<Reads<Velocity>, Writes<Heading>>("b", none, nop);
+  const auto c = s.add_system<Reads<Position>, Writes<Velocity>>("c", none, nop);
+  const auto d = s.add_system<Reads<Heading, Position>, Writes<>>("d", none, nop);
+  const auto e = s.add_system("e", SystemAccess::all(), none, nop);
+  const auto f = s.add_system<Reads<Position>, Writes<>>("f", none, nop);
+  BOOST_CHECK_EQUAL(s.systems(), 6);
+  BOOST_CHECK_EQUAL(s.name(c), "c");
+  BOOST_CHECK(s.dependencies(a).empty());
+  BOOST_CHECK(s.dependencies(b).empty());
+  BOOST_CHECK(s.dependencies(c) == (std::vector<std::size_t>{a, b}));
+  BOOST_CHECK(s.dependencies(d) == (std::vector<std::size_t>{a, b}));
+  BOOST_CHECK(s.dependencies(e) == (std::vector<std::size_t>{a, b, c, d}));
+  BOOST_CHECK(s.dependencies(f) == (std::vector<std::size_t>{a, e}));
+  const std::vector<std::vector<std::size_t>> stages{{a, b}, {c, d}, {e}, {f}};
+  BOOST_CHECK(s.stages() == stages);
+}
+BOOST_AUTO_TEST_CASE(SystemSchedulerEntityTest) {
+  // The same systems, serial and on a pool, give the same world
+  auto build = [](EntityRegistry &world, SystemScheduler &s, std::atomic<int> &steps) {
+    for (int i = 0; i < 5000; ++i) {
+      const Entity e = world.create();
+      world.emplace<Position>(e, static_cast<double>(i));
+      world.emplace<Velocity>(e, 1.0);
+      if (i % 4 == 0)
+        world.emplace<Heading>(e, 0.0);
+    }
+    s.add_each<Reads<Velocity>, Writes<Position>, Position, Velocity>(
+        "move", world, [](Entity, Position &p, Velocity &v) { p.x += v.dx; });
+    s.add_each<Reads<Position>, Writes<Heading>, Heading, Position>(
+        "turn", world, [](Entity, Heading &h, Position &p) { h.angle = p.x * 0.5; });
+    s.add_each<Reads<>, Writes<Velocity>, Velocity>("accelerate", world,
+                                                   [](Entity, Velocity &v) { v.dx *= 1.5; });
+    s.add_task<Reads<>, Writes<>>("count", [&steps] { ++steps; });
+  };
+  EntityRegistry serial_world, parallel_world;
+  SystemScheduler serial, parallel;
+  std::atomic<int> serial_steps{0}, parallel_steps{0};
+  build(serial_world, serial, serial_steps);
+  build(parallel_world, parallel, parallel_steps);
+  // move and count first, then turn and accelerate together
+  BOOST_CHECK_EQUAL(parallel.stages().size(), 2);
+  BOOST_CHECK_EQUAL(parallel.stages()[1].size(), 2);
+
+  ThreadPool pool(4);
+  for (int step = 0; step < 10; ++step) {
+    serial.run();
+    parallel.run(&pool);
+  }
+  BOOST_CHECK_EQUAL(serial_steps, 10);
+  BOOST_CHECK_EQUAL(parallel_steps, 10);
+  const auto expected = serial_world.pool<Position>().values();
+  const auto actual = parallel_world.pool<Position>().values();
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (std::size_t i = 0; i < expected.size(); ++i)
+    BOOST_CHECK_EQUAL(expected[i].x, actual[i].x);
+  const auto headings = parallel_world.pool<Heading>().values();
+  const auto serial_headings = serial_world.pool<Heading>().values();
+  for (std::size_t i = 0; i < headings.size(); ++i)
+    BOOST_CHECK_EQUAL(headings[i].angle, serial_headings[i].angle);
+}
+BOOST_AUTO_TEST_CASE(SystemSchedulerUnitTest) {
+  std::vector<std::unique_ptr<Walker>> owned;
+  std::vector<Walker *> units;
+  for (int i = 0; i < 100; ++i) {
+    owned.push_back(std::make_unique<Walker>());
+    units.push_back(owned.back().get());
+  }
+  SystemScheduler s;
+  s.add_component_passes(units);
+  int total = 0;
+  std::atomic<int> mismatched{0};
+  s.add_unit_pass<Reads<Heard, Moved>, Writes<>>("check", units, [&mismatched](Walker &w) {
+    if (w.heard != w.moved)
+      ++mismatched;
+  });
+  s.add_task<Reads<Heard>, Writes<>>("sum", [&] {
+    total = 0;
+    for (auto *w : units)
+      total += w->heard;
+  });
+  // The empty task manager declares nothing, so it runs alone; listening and
+  // moving run together, the checks after them
+  BOOST_REQUIRE_EQUAL(s.stages().size(), 3);
+  BOOST_CHECK_EQUAL(s.stages()[1].size(), 2);
+  BOOST_CHECK_EQUAL(s.stages()[2].size(), 2);
+
+  ThreadPool pool(3);
+  s.run(&pool);
+  s.run(&pool);
+  s.run();
+  BOOST_CHECK_EQUAL(total, 300);
+  BOOST_CHECK_EQUAL(mismatched, 0);
+  for (auto *w : units)
+    BOOST_CHECK_EQUAL(w->moved, 3);
+}
@@ -0,0 +1,172 @@
+#include "../Swarm.hpp"
+#include "../TaskAllocation.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace swarm;
+namespace {
+AllocationGraph random_graph(std::size_t units, std::size_t tasks, unsigned seed,
+                             ThreadPool &pool) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> value(-3, 20); // ties, and some infeasible
+  std::vector<double> scores(units * tasks);
+  for (auto &s : scores) {
+    const int v = value(rng);
+    s = v < 0 ? -std::numeric_limits<double>::infinity() : v;
+  }
+  return score_all_pairs(units, tasks, [&](std::uint32_t u, std::uint32_t t) {
+    return scores[u * tasks + t];
+  }, pool);
+}
+// Best total of one-to-one assignments with the most pairs, by brute force
+std::pair<std::size_t, double> best_assignment(const AllocationGraph &g) {
+  std::vector<std::size_t> order(g.tasks);
+  std::iota(order.begin(), order.end(), 0);
+  std::pair<std::size_t, double> best{0, 0.0};
+  do {
+    std::pair<std::size_t, double> value{0, 0.0};
+    for (std::size_t u = 0; u < std::min(g.units(), g.tasks); ++u) {
+      const double s = g.score[g.offsets[u] + order[u]];
+      if (AllocationGraph::feasible(s)) {
+        ++value.first;
+        value.second += s;
+      }
+    }
+    best = std::max(best, value);
+  } while (std::next_permutation(order.begin(), order.end()));
+  return best;
+}
+void check_consistent(const Allocation &a, const AllocationGraph &g, std::size_t capacity) {
+  BOOST_REQUIRE_EQUAL(a.bundles.size(), g.units());
+  double total = 0.0;
+  std::size_t bundled = 0;
+  for (std::size_t u = 0; u < g.units(); ++u) {
+    BOOST_CHECK_LE(a.bundles[u].size(), capacity);
+    for (const auto t : a.bundles[u]) {
+      BOOST_CHECK_EQUAL(a.unit[t], u);
+      const auto k = std::find(g.task.begin() + static_cast<std::ptrdiff_t>(g.offsets[u]),
+                               g.task.begin() + static_cast<std::ptrdiff_t>(g.offsets[u + 1]), t) -
+                     g.task.begin();
+      BOOST_REQUIRE(static_cast<std::size_t>(k) < g.offsets[u + 1]);
+      BOOST_CHECK(AllocationGraph::feasible(g.score[static_cast<std::size_t>(k)]));
+      total += g.score[static_cast<std::size_t>(k)];
+      ++bundled;
+    }
+  }
+  BOOST_CHECK_EQUAL(bundled, a.assigned());
+  BOOST_CHECK_CLOSE(total + 1.0, a.total + 1.0, 1e-9);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(HungarianAllocationTest) {
+  ThreadPool pool(2);
+  for (unsigned seed = 0; seed < 20; ++seed) {
+    // Square, more tasks than units, more units than tasks
+    const std::size_t units = 3 + seed % 5, tasks = seed % 3 == 0 ? units : 7;
+    const auto g = random_graph(units, tasks, seed, pool);
+    const auto a = hungarian_allocation(g);
+    check_consistent(a, g, 1);
+    if (units <= tasks) {
+      const auto [pairs, total] = best_assignment(g);
+      BOOST_CHECK_EQUAL(a.assigned(), pairs);
+      BOOST_CHECK_EQUAL(a.total, total);
+    }
+    const auto greedy = greedy_allocation(g);
+    check_consistent(greedy, g, 1);
+    BOOST_CHECK_LE(greedy.assigned(), a.assigned());
+    if (greedy.assigned() == a.assigned())
+      BOOST_CHECK_LE(greedy.total, a.total);
+  }
+}
+BOOST_AUTO_TEST_CASE(GreedyAllocationTest) {
+  ThreadPool pool(1);
+  // Unit 0 is best at both tasks; with room for two it takes both
+  const auto g = score_all_pairs(2, 2, [](std::uint32_t u, std::uint32_t t) {
+    return u == 0 ? 10.0 - t : 5.0;
+  }, pool);
+  const auto one = greedy_allocation(g);
+  BOOST_CHECK((one.unit == std::vector<std::uint32_t>{0, 1}));
+  BOOST_CHECK_EQUAL(one.total, 15.0);
+  const auto two = greedy_allocation(g, 2);
+  BOOST_CHECK((two.unit == std::vector<std::uint32_t>{0, 0}));
+  BOOST_CHECK((std::vector<std::uint32_t>(two.bundles[0].begin(), two.bundles[0].end()) ==
+               std::vector<std::uint32_t>{0, 1}));
+}
+BOOST_AUTO_TEST_CASE(CbbaAllocationTest) {
+  // Units and tasks on a plane, each unit bidding on its nearest tasks
+  std::mt19937 rng(4);
+  std::uniform_real_distribution<double> coord(0.0, 100.0);
+  std::vector<SpatialPoint<2>> units(600), tasks(900);
+  for (auto *set : {&units, &tasks})
+    for (auto &p : *set)
+      p = {coord(rng), coord(rng)};
+  auto score = [&](std::uint32_t u, std::uint32_t t) {
+    return 100.0 - std::sqrt(detail::squared_distance(units[u], tasks[t]));
+  };
+  UniformGrid<2> grid(5.0);
+  grid.build(tasks);
+  ThreadPool serial(1), parallel(4);
+  const auto candidates = k_nearest_of(grid, std::span<const SpatialPoint<2>>(units), 12, parallel);
+  const auto g = score_pairs(candidates, tasks.size(), score, parallel);
+  BOOST_CHECK_EQUAL(g.pairs(), units.size() * 12);
+
+  for (const std::size_t capacity : {std::size_t{1}, std::size_t{3}}) {
+    const auto a = cbba_allocation(g, capacity, serial);
+    check_consistent(a, g, capacity);
+    BOOST_CHECK_LT(a.rounds, 10000);
+    const auto b = cbba_allocation(g, capacity, parallel);
+    BOOST_CHECK(a.unit == b.unit);
+    BOOST_CHECK(a.bundles.indices == b.bundles.indices);
+    // Converged: no unit with room could outbid the winner of a candidate
+    for (std::size_t u = 0; u < g.units(); ++u) {
+      if (a.bundles[u].size() == capacity)
+        continue;
+      for (std::size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+        const auto t = g.task[k];
+        if (a.unit[t] == u)
+          continue;
+        BOOST_REQUIRE(a.unit[t] != Allocation::None);
+        const auto w = a.unit[t];
+        const auto slot = std::find(g.task.begin() + static_cast<std::ptrdiff_t>(g.offsets[w]),
+                                    g.task.begin() + static_cast<std::ptrdiff_t>(g.offsets[w + 1]), t);
+        const double won = g.score[static_cast<std::size_t>(slot - g.task.begin())];
+        BOOST_CHECK(won > g.score[k] || (!(won < g.score[k]) && !(g.score[k] < won) && w < u));
+      }
+    }
+    if (capacity == 1) {
+      const auto greedy = greedy_allocation(g);
+      BOOST_CHECK_EQUAL(a.assigned(), greedy.assigned());
+      BOOST_CHECK_CLOSE(a.total, greedy.total, 1e-9);
+    }
+  }
+}
+BOOST_AUTO_TEST_CASE(AllocationDeliveryTest) {
+  struct Worker : public BasicSwarmUnit<Worker, EmptyParams, PriorityTaskManagerC> {};
+  using Job = ITask<0, Worker>;
+  ThreadPool pool(3);
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<Worker *> units;
+  for (int i = 0; i < 10; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+    units.push_back(workers.back().get());
+  }
+  const auto g = score_all_pairs(10, 25, [](std::uint32_t u, std::uint32_t t) {
+    return t % 10 == u ? 1.0 : 0.0;
+  }, pool);
+  const auto a = greedy_allocation(g, 3);
+  BOOST_CHECK_EQUAL(a.assigned(), 25);
+  deliver(a, std::span<Worker *const>(units), [](Worker &w, std::uint32_t) {
+    return PtrTask<Worker>(new Job(&w));
+  }, pool);
+  std::size_t delivered = 0;
+  for (std::size_t u = 0; u < units.size(); ++u) {
+    BOOST_CHECK_EQUAL(units[u]->task_manager().size(), a.bundles[u].size());
+    delivered += units[u]->task_manager().size();
+    BOOST_CHECK(units[u]->task_manager().top().unit() == units[u]);
+  }
+  BOOST_CHECK_EQUAL(delivered, 25);
+}
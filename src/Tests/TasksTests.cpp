@@ -1,9 +1,295 @@
+#include "../Parallel.hpp"
 #include "../SwarmUnit.hpp"
+#include <algorithm>
+#include <atomic>
 #include <boost/test/unit_test.hpp>
+#include <random>
+#include <stdexcept>
+#include <vector>
 
 using namespace swarm;
+namespace {
+struct PlannerUnit : public BasicSwarmUnit<PlannerUnit, EmptyParams,
+                                           PriorityTaskManagerC> {
+  PriorityTaskManagerC<PlannerUnit> &tasks() { return _taskManagerC; }
+};
+struct Goal : public ITask<2, PlannerUnit> {
+  int id;
+  int *destroyed;
+  Goal(PlannerUnit *u, int i, int *d = nullptr) : ITask(u), id(i), destroyed(d) {}
+  ~Goal() override {
+    if (destroyed)
+      ++*destroyed;
+  }
+};
+struct BigGoal : public Goal {
+  char payload[5000]; // bigger than any size class of the pool
+  using Goal::Goal;
+};
+// ITask is not the primary base, so an ITask * is not the start of the block
+struct Tagged {
+  virtual ~Tagged() = default;
+  long tag = 7;
+};
+struct TaggedGoal : public Tagged, public Goal {
+  using Goal::Goal;
+};
+struct BigTaggedGoal : public Tagged, public Goal {
+  char payload[5000];
+  using Goal::Goal;
+};
+int top_id(PriorityTaskManagerC<PlannerUnit> &tasks) {
+  return dynamic_cast<Goal &>(tasks.top()).id;
+}
+
+// Patrol (2) -> Visit (1) of each waypoint -> Move (0) steps
+struct PatrolParams : public ITaskParams {
+  int waypoints = 0;
+  explicit PatrolParams(int w = 0) : waypoints(w) {}
+  bool operator==(const PatrolParams &o) const { return waypoints == o.waypoints; }
+};
+struct PointParams : public ITaskParams {
+  int x = 0;
+  explicit PointParams(int v = 0) : x(v) {}
+  bool operator==(const PointParams &o) const { return x == o.x; }
+};
+} // namespace
+template <> struct std::hash<PatrolParams> {
+  std::size_t operator()(const PatrolParams &p) const {
+    return static_cast<std::size_t>(p.waypoints);
+  }
+};
+template <> struct std::hash<PointParams> {
+  std::size_t operator()(const PointParams &p) const { return std::hash<int>{}(p.x); }
+};
+namespace {
+using Patrol = ITask<2, PlannerUnit, PatrolParams>;
+using Visit = ITask<1, PlannerUnit, PointParams>;
+using Move = ITask<0, PlannerUnit, PointParams>;
+
+std::atomic<int> rule_calls{0};
+void add_patrol_rules(TaskDecomposer<PlannerUnit> &d) {
+  d.add_rule<Patrol>([](const PatrolParams &p, TaskPlanBuilder<PlannerUnit> &out) {
+    ++rule_calls;
+    for (int i = 0; i < p.waypoints; ++i)
+      out.add<Visit>(PointParams(i % 3));
+  });
+  d.add_rule<Visit>([](const PointParams &p, TaskPlanBuilder<PlannerUnit> &out) {
+    ++rule_calls;
+    out.add<Move>(PointParams(p.x));
+    out.add<Move>(PointParams(p.x + 100));
+  });
+}
+std::vector<int> move_targets(const std::vector<PtrTask<PlannerUnit>> &tasks) {
+  std::vector<int> xs;
+  for (const auto &t : tasks)
+    xs.push_back(dynamic_cast<const Move &>(*t).params().x);
+  return xs;
+}
+} // namespace
+
 BOOST_AUTO_TEST_CASE(TasksTest) {
   constexpr auto l = 5;
   ITask<l, EmptySwarmUnit> t(nullptr);
   BOOST_CHECK_EQUAL(t.get_lvl(), l);
 }
+BOOST_AUTO_TEST_CASE(IndexedDaryHeapTest) {
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> value(0, 1000);
+  IndexedDaryHeap<int> heap;
+  std::vector<int> keys(500);
+  for (std::uint32_t i = 0; i < keys.size(); ++i)
+    heap.push(i, keys[i] = value(rng));
+  for (std::uint32_t i = 0; i < keys.size(); i += 3)
+    heap.update(i, keys[i] = value(rng));
+  for (std::uint32_t i = 1; i < keys.size(); i += 5) {
+    heap.erase(i);
+    keys[i] = -1;
+  }
+  BOOST_CHECK(!heap.contains(1));
+  std::vector<int> expected, popped;
+  std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected),
+               [](int k) { return k >= 0; });
+  std::sort(expected.begin(), expected.end());
+  while (!heap.empty()) {
+    popped.push_back(heap.top_key());
+    BOOST_CHECK_EQUAL(keys[heap.top()], heap.top_key());
+    heap.pop();
+  }
+  BOOST_CHECK(popped == expected);
+}
+BOOST_AUTO_TEST_CASE(PriorityTaskManagerTest) {
+  PlannerUnit unit;
+  auto &tasks = unit.tasks();
+  int destroyed = 0;
+  const auto low = tasks.emplace_task<Goal>(1.0, 10.0, 1, &destroyed);
+  const auto urgent = tasks.emplace_task<Goal>(1.0, 5.0, 2, &destroyed);
+  const auto high = tasks.emplace_task<Goal>(3.0, 50.0, 3, &destroyed);
+  tasks.emplace_task<BigGoal>(0.5, 1.0, 4, &destroyed);
+  BOOST_CHECK_EQUAL(tasks.size(), 4);
+  BOOST_CHECK_EQUAL(top_id(tasks), 3);
+  BOOST_CHECK_EQUAL(tasks.top().get_lvl(), 2);
+
+  BOOST_CHECK(tasks.reprioritize(low, 5.0, 10.0));
+  BOOST_CHECK_EQUAL(top_id(tasks), 1);
+  BOOST_CHECK(tasks.cancel(low));
+  BOOST_CHECK_EQUAL(destroyed, 1);
+  BOOST_CHECK(!tasks.cancel(low)); // stale handle
+  BOOST_CHECK(!tasks.reprioritize(low, 9.0, 0.0));
+  BOOST_CHECK_EQUAL(top_id(tasks), 3);
+  tasks.pop();
+  BOOST_CHECK(!tasks.contains(high));
+  BOOST_CHECK_EQUAL(top_id(tasks), 2); // same priority, earlier deadline first
+  BOOST_CHECK(tasks.contains(urgent));
+
+  // A reused slot does not answer to the handle of its old task
+  const auto again = tasks.emplace_task<Goal>(0.0, 0.0, 5, &destroyed);
+  BOOST_CHECK_EQUAL(again.slot, high.slot);
+  BOOST_CHECK(!tasks.contains(low) && !tasks.contains(high));
+
+  tasks.add_task_in_front(PtrTask<PlannerUnit>(new Goal(&unit, 6)));
+  BOOST_CHECK_EQUAL(top_id(tasks), 6);
+  tasks.add_task_in_back(PtrTask<PlannerUnit>(new Goal(&unit, 7)));
+  std::vector<int> order;
+  for (; !tasks.empty(); tasks.pop())
+    order.push_back(top_id(tasks));
+  BOOST_CHECK((order == std::vector<int>{6, 2, 4, 5, 7}));
+  BOOST_CHECK_EQUAL(destroyed, 5);
+}
+BOOST_AUTO_TEST_CASE(PriorityTaskManagerPoolTest) {
+  // Thousands of tasks added and cancelled in random order; every pooled task
+  // is destroyed exactly once, the rest with the manager
+  int destroyed = 0;
+  {
+    PlannerUnit unit;
+    auto &tasks = unit.tasks();
+    std::mt19937 rng(8);
+    std::uniform_real_distribution<double> priority(0.0, 100.0);
+    std::vector<TaskHandle> handles;
+    for (int i = 0; i < 5000; ++i)
+      handles.push_back(tasks.emplace_task<Goal>(priority(rng), 0.0, i, &destroyed));
+    std::shuffle(handles.begin(), handles.end(), rng);
+    for (std::size_t i = 0; i < handles.size() / 2; ++i)
+      BOOST_CHECK(tasks.cancel(handles[i]));
+    BOOST_CHECK_EQUAL(destroyed, 2500);
+    double last = 100.0;
+    for (int i = 0; i < 1000; ++i) {
+      const double p = tasks.key(tasks.top_handle()).priority;
+      BOOST_CHECK_LE(p, last);
+      last = p;
+      tasks.pop();
+    }
+    BOOST_CHECK_EQUAL(tasks.size(), 1500);
+  }
+  BOOST_CHECK_EQUAL(destroyed, 5000);
+}
+BOOST_AUTO_TEST_CASE(TaskDecompositionTest) {
+  TaskDecomposer<PlannerUnit> decomposer;
+  add_patrol_rules(decomposer);
+  PlannerUnit unit;
+  auto &tasks = unit.tasks();
+  BOOST_CHECK_THROW(tasks.decomposer(), std::logic_error);
+  BOOST_CHECK_THROW(tasks.full_decompose_task(Patrol(&unit, PatrolParams(1))), std::logic_error);
+  tasks.set_decomposer(decomposer);
+  rule_calls = 0;
+
+  const Patrol patrol(&unit, PatrolParams(4));
+  const auto visits = tasks.decompose_task(patrol);
+  BOOST_REQUIRE_EQUAL(visits.size(), 4);
+  BOOST_CHECK_EQUAL(visits[3]->get_lvl(), 1);
+  BOOST_CHECK_EQUAL(rule_calls, 1);
+  const auto moves = tasks.full_decompose_task(patrol);
+  BOOST_CHECK((move_targets(moves) == std::vector<int>{0, 100, 1, 101, 2, 102, 0, 100}));
+  BOOST_CHECK(moves[0]->unit() == &unit);
+  BOOST_CHECK_EQUAL(rule_calls, 2 + 3); // decompose_task() is not cached
+  BOOST_CHECK_EQUAL(decomposer.plans<Patrol>(), 1);
+  BOOST_CHECK_EQUAL(decomposer.plans<Visit>(), 3);
+
+  // Equal parameters reuse the plan, other parameters reuse the plans of
+  // their subtasks
+  const auto plan = decomposer.plan(patrol);
+  BOOST_CHECK(decomposer.plan(Patrol(&unit, PatrolParams(4))) == plan);
+  decomposer.plan(Patrol(&unit, PatrolParams(6)));
+  BOOST_CHECK_EQUAL(rule_calls, 6);
+  BOOST_CHECK(decomposer.plan(Move(&unit))->empty());
+  BOOST_CHECK(tasks.full_decompose_task(Move(&unit)).empty());
+
+  // Decomposition in the unit's task managers
+  tasks.add_task(PtrTask<PlannerUnit>(new Patrol(&unit, PatrolParams(2))), 1.0);
+  tasks.add_task(PtrTask<PlannerUnit>(new Move(&unit, PointParams(7))), 1.0);
+  const auto handles = tasks.decompose_top();
+  BOOST_CHECK_EQUAL(handles.size(), 4);
+  std::vector<int> order;
+  for (; !tasks.empty(); tasks.pop())
+    order.push_back(dynamic_cast<const Move &>(tasks.top()).params().x);
+  BOOST_CHECK((order == std::vector<int>{0, 100, 1, 101, 7}));
+
+  struct DequeUnit : public BasicSwarmUnit<DequeUnit> {};
+  TaskDecomposer<DequeUnit> no_rules;
+  EmptyTaskManagerC<DequeUnit> deque(nullptr);
+  deque.set_decomposer(no_rules);
+  deque.add_task_in_back(PtrTask<DequeUnit>(new ITask<3, DequeUnit>(nullptr)));
+  BOOST_CHECK_THROW(deque.decompose_front(), std::logic_error);
+}
+BOOST_AUTO_TEST_CASE(TaskDecompositionDequeTest) {
+  TaskDecomposer<PlannerUnit> decomposer;
+  add_patrol_rules(decomposer);
+  EmptyTaskManagerC<PlannerUnit> tasks(nullptr);
+  tasks.set_decomposer(decomposer);
+  tasks.add_task_in_back(PtrTask<PlannerUnit>(new Patrol(nullptr, PatrolParams(2))));
+  tasks.add_task_in_back(PtrTask<PlannerUnit>(new Move(nullptr, PointParams(9))));
+  const auto [first, last] = tasks.decompose_front();
+  BOOST_CHECK_EQUAL(last - first, 4);
+  BOOST_CHECK(first == tasks.task_deque().cbegin());
+  BOOST_CHECK_EQUAL(tasks.task_deque().size(), 5);
+  const auto [same, next] = tasks.decompose_front(); // level 0 stays
+  BOOST_CHECK_EQUAL(next - same, 1);
+  BOOST_CHECK_EQUAL(tasks.task_deque().size(), 5);
+}
+BOOST_AUTO_TEST_CASE(TaskDecompositionParallelTest) {
+  // Many units decompose a few kinds of missions at once and end up with the
+  // same plans
+  TaskDecomposer<PlannerUnit> decomposer;
+  add_patrol_rules(decomposer);
+  ThreadPool pool(4);
+  std::vector<std::size_t> sizes(4000);
+  std::vector<TaskDecomposer<PlannerUnit>::PlanPtr> plans(sizes.size());
+  pool.parallel_for(sizes.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin; i < end; ++i) {
+      const Patrol patrol(nullptr, PatrolParams(static_cast<int>(i % 10)));
+      plans[i] = decomposer.plan(patrol);
+      sizes[i] = plans[i]->size();
+    }
+  });
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    BOOST_CHECK_EQUAL(sizes[i], 2 * (i % 10));
+    BOOST_CHECK(plans[i] == plans[i % 10]);
+  }
+  BOOST_CHECK_EQUAL(decomposer.plans<Patrol>(), 10);
+}
+BOOST_AUTO_TEST_CASE(SlabPoolBaseClassTest) {
+  PlannerUnit unit;
+  SlabPool pool;
+  int destroyed = 0;
+  auto [small, c] = pool.create<TaggedGoal>(&unit, 1, &destroyed);
+  IBaseTask<PlannerUnit> *base = small;
+  BOOST_CHECK(static_cast<void *>(base) != static_cast<void *>(small));
+  pool.destroy(base, c);
+  // The block freed is the one handed out, so it comes back first
+  auto [again, c2] = pool.create<TaggedGoal>(&unit, 2, &destroyed);
+  BOOST_CHECK_EQUAL(static_cast<void *>(again), static_cast<void *>(small));
+  pool.destroy(static_cast<IBaseTask<PlannerUnit> *>(again), c2);
+
+  auto [big, heap] = pool.create<BigTaggedGoal>(&unit, 3, &destroyed);
+  BOOST_CHECK_EQUAL(heap, SlabPool::Heap);
+  pool.destroy(static_cast<IBaseTask<PlannerUnit> *>(big), heap);
+  BOOST_CHECK_EQUAL(destroyed, 3);
+
+  {
+    PlannerUnit owner;
+    owner.tasks().emplace_task<TaggedGoal>(1.0, 0.0, 4, &destroyed);
+    owner.tasks().emplace_task<BigTaggedGoal>(2.0, 0.0, 5, &destroyed);
+    owner.tasks().pop();
+  }
+  BOOST_CHECK_EQUAL(destroyed, 5);
+}
@@ -1,13 +1,15 @@
 #pragma once
+#include "../MessageBus.hpp"
 #include "IUnitComponent.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
 namespace swarm {
 template <class ParamsT, class SwarmUnitT> class IUnitComponent;
-class ICommunicationMessage {};
+using ICommunicationMessage = Message;
 /**
  * @brief Interface of the communication swarm unit component. In this component
  * unit communicate with other units and swarm.
- *
- * TODO matvey
  */
 template <class ParamsT, class SwarmUnitT>
 class ICommunicationUnitC : public IUnitComponent<ParamsT, SwarmUnitT> {
@@ -26,4 +28,60 @@ public:
   void init() final {};
   void iter() final {};
 };
-} // namespace swarm
\ No newline at end of file
+
+/**
+ * @brief Communication component over a MessageBus. iter() empties the unit's
+ * mailbox into received(), which the executor reads in the same unit
+ * iteration. With a MessageDelivery::StepSynchronous bus, received() holds
+ * exactly the messages sent to the unit in the previous step.
+ *
+ * The unit (or its swarm) must connect() the component to a bus before the
+ * swarm runs.
+ */
+template <class SwarmUnitT>
+class MailboxCommunicationC
+    : public ICommunicationUnitC<EmptyParams, SwarmUnitT> {
+  MessageBus *_bus = nullptr;
+  MessageBus::EndpointId _id = 0;
+  std::vector<Message> _received;
+
+public:
+  MailboxCommunicationC(SwarmUnitT *u)
+      : ICommunicationUnitC<EmptyParams, SwarmUnitT>(u) {}
+  ~MailboxCommunicationC() override = default;
+
+  /**
+   * @brief Register the unit as a new endpoint of `bus`
+   */
+  void connect(MessageBus &bus) {
+    _bus = &bus;
+    _id = bus.add_endpoint();
+  }
+  MessageBus::EndpointId id() const { return _id; }
+  MessageBus &bus() const { return *_bus; }
+
+  void init() final { _received.clear(); }
+  void iter() final {
+    _received.clear();
+    _bus->receive(_id, [this](const Message &m) { _received.push_back(m); });
+  }
+
+  /**
+   * @brief messages collected by the last iter()
+   */
+  std::span<const Message> received() const { return _received; }
+
+  template <class T>
+  bool send(MessageBus::EndpointId to, std::uint32_t tag, const T &value) {
+    return _bus->send(_id, to, tag, value);
+  }
+  template <class T>
+  std::size_t multicast(MessageBus::GroupId group, std::uint32_t tag,
+                        const T &value) {
+    return _bus->multicast(_id, group, tag, value);
+  }
+  template <class T> std::size_t broadcast(std::uint32_t tag, const T &value) {
+    return _bus->broadcast(_id, tag, value);
+  }
+};
+} // namespace swarm
@@ -1,6 +1,10 @@
 #pragma once
+#include "../BatchExecutor.hpp"
 #include "../Tasks/ITask.hpp"
 #include "IUnitComponent.hpp"
+#include <cstdint>
+#include <typeindex>
+#include <typeinfo>
 namespace swarm {
 template <class ParamsT, class SwarmUnitT> class IUnitComponent;
 
@@ -26,4 +30,64 @@ public:
   void iter() final {};
 };
 
+/**
+ * @brief Executor that does not run tasks itself: iter() hands the current
+ * task of the unit's task manager to a BatchExecutor, if it is a level 0 task
+ * with a kernel there. The task is executed with the same tasks of the other
+ * units at the end of the step.
+ */
+template <class SwarmUnitT>
+class BatchedExecutorC : public IExecutorUnitC<EmptyParams, SwarmUnitT> {
+  using Batch = BatchExecutor<SwarmUnitT>;
+  Batch *_batch = nullptr;
+  typename Batch::Submission *_submission = nullptr;
+  std::type_index _known = typeid(void); // task type of the kernel below
+  std::uint32_t _kernel = Batch::NoKernel;
+
+public:
+  BatchedExecutorC(SwarmUnitT *u) : IExecutorUnitC<EmptyParams, SwarmUnitT>(u) {}
+  BatchedExecutorC(const BatchedExecutorC &) = delete;
+  BatchedExecutorC &operator=(const BatchedExecutorC &) = delete;
+  ~BatchedExecutorC() override { disconnect(); }
+  void connect(Batch &batch) {
+    disconnect();
+    _batch = &batch;
+    _submission = &batch.connect(*this);
+    _known = typeid(void);
+  }
+  /**
+   * @brief Give the slot back to the batch, between steps; the unit's tasks
+   * stay with it from then on
+   */
+  void disconnect() {
+    if (_batch)
+      _batch->disconnect(*_submission);
+    detach();
+  }
+  void init() final {}
+  void iter() final {
+    if (!_submission)
+      return;
+    _submission->task = nullptr;
+    auto *task = this->_U->task_manager().current_task();
+    if (!task || !task->is_full_decomposed())
+      return;
+    const std::type_index type = typeid(*task);
+    if (type != _known) { // mostly the type of the last step
+      _known = type;
+      _kernel = _batch->kernel_of(*task);
+    }
+    _submission->kernel = _kernel;
+    if (_kernel != Batch::NoKernel)
+      _submission->task = task;
+  }
+
+private:
+  void detach() {
+    _batch = nullptr;
+    _submission = nullptr;
+  }
+  friend Batch;
+};
+
 } // namespace swarm
\ No newline at end of file
@@ -1,15 +1,24 @@
 #pragma once
 #include "../Tasks/ITask.hpp"
+#include "../Tasks/TaskDecomposition.hpp"
+#include "../Tasks/TaskQueue.hpp"
 #include "IUnitComponent.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace swarm {
 
 template <class SwarmUnitT>
-class PtrTask : public std::shared_ptr<IBaseTask<SwarmUnitT>> {};
+class PtrTask : public std::shared_ptr<IBaseTask<SwarmUnitT>> {
+public:
+  using std::shared_ptr<IBaseTask<SwarmUnitT>>::shared_ptr;
+};
 /**
  * @brief TaskDeque. Task on front exucute first, on back last
  *
@@ -26,6 +35,7 @@ class TaskDeque : public std::deque<PtrTask<SwarmUnitT>> {}; // TODO rb tree ?
 template <class ParamsT, class SwarmUnitT>
 class ITaskManagerUnitC : public IUnitComponent<ParamsT, SwarmUnitT> {
   TaskDeque<SwarmUnitT> _taskDeque;
+  const TaskDecomposer<SwarmUnitT> *_decomposer = nullptr;
 
 public:
   ITaskManagerUnitC(SwarmUnitT *u) : IUnitComponent<ParamsT, SwarmUnitT>(u) {}
@@ -44,40 +54,77 @@ public:
   virtual void add_task_in_front(PtrTask<SwarmUnitT> t) {
     _taskDeque.push_front(t);
   }
+  const TaskDeque<SwarmUnitT> &task_deque() const { return _taskDeque; }
+  /**
+   * @brief The task to work on now, nullptr if there is none
+   */
+  virtual IBaseTask<SwarmUnitT> *current_task() {
+    return _taskDeque.empty() ? nullptr : _taskDeque.front().get();
+  }
+  /**
+   * @brief Remove the current task when it is completed
+   */
+  virtual void finish_current_task() { _taskDeque.pop_front(); }
+
+  /**
+   * @brief Set the decomposer, usually one shared by all units of the swarm
+   */
+  void set_decomposer(const TaskDecomposer<SwarmUnitT> &d) { _decomposer = &d; }
+  /**
+   * @throws std::logic_error if no decomposer is set
+   */
+  const TaskDecomposer<SwarmUnitT> &decomposer() const {
+    if (!_decomposer)
+      throw std::logic_error("no TaskDecomposer set");
+    return *_decomposer;
+  }
+
   /**
-   * @brief decompose task on front and add subtasks to front of deque
+   * @brief replace the task on front by its level 0 subtasks
    *
    * @return std::pair<typename TaskDeque<SwarmUnitT>::const_iterator,
    * typename TaskDeque<SwarmUnitT>::const_iterator> - pair of const iterators
-   * in deque, first iterator - the initial task(was it the front), second
-   * iterator - the last task in decomposed subtasks
+   * in deque, the range of the subtasks; the front task itself if it has
+   * level 0
    */
   std::pair<typename TaskDeque<SwarmUnitT>::const_iterator,
             typename TaskDeque<SwarmUnitT>::const_iterator>
   decompose_front() {
-    std::pair<typename TaskDeque<SwarmUnitT>::const_iterator,
-              typename TaskDeque<SwarmUnitT>::const_iterator>
-        res;
-    auto initial_task = _taskDeque.front();
-    auto task_to_decompose = initial_task;
-    res.first = _taskDeque.begin();
-    full_decompose_task(initial_task);
-    res.second = _taskDeque.begin();
-    return res;
-  }
-  PtrTask<SwarmUnitT> decompose_task(PtrTask<SwarmUnitT> &task) const;
-
-  template <uint32_t Lvl, class TaskParamsT, class ReturnTaskParamsT>
-  const ITask<Lvl - 1, SwarmUnitT, ReturnTaskParamsT> &
-  decompose_task(const ITask<Lvl, SwarmUnitT, TaskParamsT>) const;
-
-  void full_decompose_task(PtrTask<SwarmUnitT> task) {
-    while (task.is_full_decomposed) {
-      // decomposfe
-    }
+    if (_taskDeque.front()->is_full_decomposed())
+      return {_taskDeque.cbegin(), _taskDeque.cbegin() + 1};
+    auto subtasks = full_decompose_task(*_taskDeque.front());
+    _taskDeque.pop_front();
+    _taskDeque.insert(_taskDeque.begin(), subtasks.begin(), subtasks.end());
+    return {_taskDeque.cbegin(),
+            _taskDeque.cbegin() + static_cast<std::ptrdiff_t>(subtasks.size())};
+  }
+  /**
+   * @brief The direct subtasks of the task, for this unit
+   */
+  std::vector<PtrTask<SwarmUnitT>>
+  decompose_task(const IBaseTask<SwarmUnitT> &task) const {
+    return instantiate(decomposer().decompose(task));
+  }
+  /**
+   * @brief The level 0 subtasks of the task, for this unit, from the plan
+   * cached by the decomposer
+   */
+  std::vector<PtrTask<SwarmUnitT>>
+  full_decompose_task(const IBaseTask<SwarmUnitT> &task) const {
+    return instantiate(*decomposer().plan(task));
   }
 
   virtual ~ITaskManagerUnitC() = default;
+
+private:
+  std::vector<PtrTask<SwarmUnitT>>
+  instantiate(const TaskPlan<SwarmUnitT> &plan) const {
+    std::vector<PtrTask<SwarmUnitT>> tasks;
+    tasks.reserve(plan.size());
+    for (const auto &step : plan)
+      tasks.push_back(step.instantiate(this->_U));
+    return tasks;
+  }
 };
 
 template <class SwarmUnitT>
@@ -89,4 +136,207 @@ public:
   void init() final {};
   void iter() final {};
 };
+
+/**
+ * @brief Place of a task in PriorityTaskManagerC: higher priority first, then
+ * earlier deadline, then the order of adding
+ */
+struct TaskKey {
+  double priority = 0.0;
+  double deadline = std::numeric_limits<double>::infinity();
+  std::int64_t sequence = 0;
+  /**
+   * @brief true if this task goes before `o`
+   */
+  bool operator<(const TaskKey &o) const {
+    if (priority > o.priority || priority < o.priority)
+      return priority > o.priority;
+    if (deadline < o.deadline || deadline > o.deadline)
+      return deadline < o.deadline;
+    return sequence < o.sequence;
+  }
+};
+
+/**
+ * @brief Handle of a task in PriorityTaskManagerC. Stays valid until the task
+ * is popped or cancelled, after that the manager ignores it.
+ */
+struct TaskHandle {
+  std::uint32_t slot = std::numeric_limits<std::uint32_t>::max();
+  std::uint32_t generation = 0;
+};
+
+/**
+ * @brief Task manager on a 4-ary heap keyed by TaskKey instead of TaskDeque.
+ * Adding, reprioritizing and cancelling a task by its handle are O(log n);
+ * top() is O(1). Tasks made by emplace_task() live in a pool owned by the
+ * component, so a unit with thousands of tasks does not allocate per task;
+ * tasks passed as PtrTask are kept alive by their shared pointer.
+ *
+ * add_task_in_back() and add_task_in_front() keep their meaning among the
+ * tasks of equal priority: back is after all tasks with priority 0, front is
+ * right before the current top.
+ */
+template <class SwarmUnitT>
+class PriorityTaskManagerC : public ITaskManagerUnitC<EmptyParams, SwarmUnitT> {
+  using Task = IBaseTask<SwarmUnitT>;
+  struct Slot {
+    Task *task = nullptr;
+    PtrTask<SwarmUnitT> shared; // empty for pooled tasks
+    std::uint32_t generation = 0;
+    std::uint8_t size_class = 0;
+  };
+  SlabPool _pool;
+  std::vector<Slot> _slots;
+  std::vector<std::uint32_t> _freeSlots;
+  IndexedDaryHeap<TaskKey> _queue;
+  std::int64_t _back = 0;  // sequence of the next task added in back
+  std::int64_t _front = 0; // sequence of the last task added in front
+
+public:
+  PriorityTaskManagerC(SwarmUnitT *u)
+      : ITaskManagerUnitC<EmptyParams, SwarmUnitT>(u) {}
+  PriorityTaskManagerC(const PriorityTaskManagerC &) = delete;
+  PriorityTaskManagerC &operator=(const PriorityTaskManagerC &) = delete;
+  ~PriorityTaskManagerC() override { clear(); }
+
+  void init() override {}
+  void iter() override {}
+
+  /**
+   * @brief Construct a task of type TaskT in the unit's pool, as
+   * TaskT(unit, args...)
+   */
+  template <class TaskT, class... Args>
+  TaskHandle emplace_task(double priority, double deadline, Args &&...args) {
+    static_assert(std::is_base_of<Task, TaskT>::value,
+                  "TaskT must be derived from IBaseTask");
+    auto [task, size_class] =
+        _pool.create<TaskT>(this->_U, std::forward<Args>(args)...);
+    return insert(task, {}, size_class, {priority, deadline, _back++});
+  }
+  TaskHandle add_task(PtrTask<SwarmUnitT> t, double priority,
+                      double deadline = std::numeric_limits<double>::infinity()) {
+    Task *task = t.get();
+    return insert(task, std::move(t), 0, {priority, deadline, _back++});
+  }
+  void add_task_in_back(PtrTask<SwarmUnitT> t) override {
+    add_task(std::move(t), 0.0);
+  }
+  void add_task_in_front(PtrTask<SwarmUnitT> t) override {
+    TaskKey key = empty() ? TaskKey{} : _queue.top_key();
+    key.sequence = --_front;
+    Task *task = t.get();
+    insert(task, std::move(t), 0, key);
+  }
+
+  /**
+   * @brief Change the priority and deadline of a task, keeping its place
+   * among equal keys
+   *
+   * @return false if the task is no longer in the manager
+   */
+  bool reprioritize(TaskHandle h, double priority, double deadline) {
+    if (!contains(h))
+      return false;
+    TaskKey key = _queue.key(h.slot);
+    key.priority = priority;
+    key.deadline = deadline;
+    _queue.update(h.slot, key);
+    return true;
+  }
+  /**
+   * @brief Remove a task and destroy it if it is pooled
+   *
+   * @return false if the task is no longer in the manager
+   */
+  bool cancel(TaskHandle h) {
+    if (!contains(h))
+      return false;
+    _queue.erase(h.slot);
+    release(h.slot);
+    return true;
+  }
+  bool contains(TaskHandle h) const {
+    return h.slot < _slots.size() && _slots[h.slot].generation == h.generation &&
+           _queue.contains(h.slot);
+  }
+  const TaskKey &key(TaskHandle h) const { return _queue.key(h.slot); }
+
+  std::size_t size() const { return _queue.size(); }
+  bool empty() const { return _queue.empty(); }
+  /**
+   * @brief The task to complete first. The manager must not be empty.
+   */
+  Task &top() const { return *_slots[_queue.top()].task; }
+  TaskHandle top_handle() const {
+    const auto slot = _queue.top();
+    return {slot, _slots[slot].generation};
+  }
+  /**
+   * @brief Remove the top task, when it is completed
+   */
+  void pop() {
+    const auto slot = _queue.top();
+    _queue.pop();
+    release(slot);
+  }
+  void clear() {
+    while (!empty())
+      pop();
+  }
+  Task *current_task() override { return empty() ? nullptr : &top(); }
+  void finish_current_task() override { pop(); }
+  /**
+   * @brief Replace the top task by its level 0 subtasks, which take its
+   * priority and deadline and go before other tasks with the same ones
+   *
+   * @return handles of the subtasks in order of execution
+   */
+  std::vector<TaskHandle> decompose_top() {
+    if (top().is_full_decomposed())
+      return {top_handle()};
+    TaskKey key = _queue.top_key();
+    auto subtasks = this->full_decompose_task(top());
+    pop();
+    _front -= static_cast<std::int64_t>(subtasks.size());
+    std::vector<TaskHandle> handles;
+    handles.reserve(subtasks.size());
+    for (std::size_t i = 0; i < subtasks.size(); ++i) {
+      key.sequence = _front + static_cast<std::int64_t>(i);
+      Task *task = subtasks[i].get();
+      handles.push_back(insert(task, std::move(subtasks[i]), 0, key));
+    }
+    return handles;
+  }
+
+private:
+  TaskHandle insert(Task *task, PtrTask<SwarmUnitT> shared,
+                    std::uint8_t size_class, const TaskKey &key) {
+    std::uint32_t slot;
+    if (_freeSlots.empty()) {
+      slot = static_cast<std::uint32_t>(_slots.size());
+      _slots.emplace_back();
+    } else {
+      slot = _freeSlots.back();
+      _freeSlots.pop_back();
+    }
+    Slot &s = _slots[slot];
+    s.task = task;
+    s.shared = std::move(shared);
+    s.size_class = size_class;
+    _queue.push(slot, key);
+    return {slot, s.generation};
+  }
+  void release(std::uint32_t slot) {
+    Slot &s = _slots[slot];
+    if (s.shared)
+      s.shared.reset();
+    else
+      _pool.destroy(s.task, s.size_class);
+    s.task = nullptr;
+    ++s.generation;
+    _freeSlots.push_back(slot);
+  }
+};
 } // namespace swarm
\ No newline at end of file